@@ -0,0 +1,125 @@
+#include "AssetRegistry.h"
+#include "ThreadPool.h"
+#include <iostream>
+#include <chrono>
+
+AssetRegistry::State AssetRegistry::request(const std::string& path)
+{
+    auto found = entries.find(path);
+    if (found != entries.end()) return found->second.state;
+
+    // Assimp, vertex conversion and texture decoding run on the worker pool; update() does the upload
+    Entry& entry = entries[path];
+    entry.pendingImport = ThreadPool::shared().enqueue([path]() { return Model::import(path); });
+    return entry.state;
+}
+
+std::shared_ptr<Model> AssetRegistry::add(std::unique_ptr<ModelData> data)
+{
+    std::string path = data->path;
+    Entry& entry = entries[path];
+    if (entry.state == State::READY) return entry.model;
+
+    // An import of the same file may still be running; its result is dropped
+    entry.pendingImport = std::future<std::unique_ptr<ModelData>>();
+    entry.model = upload(std::move(data));
+    entry.state = entry.model ? State::READY : State::FAILED;
+    return entry.model;
+}
+
+bool AssetRegistry::reload(const std::string& path)
+{
+    auto found = entries.find(path);
+    if (found == entries.end()) return false;
+
+    // A reload still in flight read the file before this change; its result is dropped
+    found->second.pendingImport = ThreadPool::shared().enqueue([path]() { return Model::import(path); });
+    return true;
+}
+
+std::shared_ptr<Model> AssetRegistry::get(const std::string& path) const
+{
+    auto found = entries.find(path);
+    return found != entries.end() ? found->second.model : nullptr;
+}
+
+AssetRegistry::State AssetRegistry::getState(const std::string& path) const
+{
+    auto found = entries.find(path);
+    return found != entries.end() ? found->second.state : State::FAILED;
+}
+
+std::vector<std::string> AssetRegistry::update(size_t maxUploads)
+{
+    std::vector<std::string> finished;
+    for (auto& item : entries) {
+        if (finished.size() >= maxUploads) break;
+        Entry& entry = item.second;
+        if (!entry.pendingImport.valid()) continue;
+        if (entry.pendingImport.wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+
+        // The model is published only once it is fully uploaded, so a frame never sees it half built
+        std::shared_ptr<Model> model = upload(entry.pendingImport.get());
+        if (model) {
+            entry.model = model;
+            entry.state = State::READY;
+        } else if (entry.state == State::LOADING) {
+            entry.state = State::FAILED;
+        } else {
+            std::cout << "ERROR::ASSET_REGISTRY:: Reload of " << item.first << " failed, keeping the previous model" << std::endl;
+            continue;
+        }
+        finished.push_back(item.first);
+    }
+    return finished;
+}
+
+size_t AssetRegistry::releaseUnused()
+{
+    size_t released = 0;
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->second.state == State::READY && it->second.model.use_count() == 1) {
+            it = entries.erase(it);
+            released++;
+        } else {
+            ++it;
+        }
+    }
+    return released;
+}
+
+bool AssetRegistry::release(const std::string& path)
+{
+    auto found = entries.find(path);
+    if (found == entries.end()) return true;
+    if (found->second.model && found->second.model.use_count() > 1) return false;
+    entries.erase(found);
+    return true;
+}
+
+AssetRegistry::Stats AssetRegistry::getStats() const
+{
+    Stats stats;
+    for (const auto& item : entries) {
+        const Entry& entry = item.second;
+        if (entry.state == State::LOADING) stats.loading++;
+        if (entry.model) {
+            stats.models++;
+            stats.handles += entry.model.use_count() - 1;
+        }
+    }
+    return stats;
+}
+
+std::shared_ptr<Model> AssetRegistry::upload(std::unique_ptr<ModelData> data)
+{
+    std::string path = data ? data->path : std::string();
+    try {
+        if (data && (!data->meshes.empty() || data->meshCache)) {
+            return std::make_shared<Model>(std::move(data));
+        }
+    } catch (const std::exception& e) {
+        std::cout << "Failed to load model: " << path << " - " << e.what() << std::endl;
+    }
+    return nullptr;
+}
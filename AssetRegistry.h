@@ -0,0 +1,69 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <memory>
+#include <future>
+#include "Model.h"
+
+// Loads each model file once and hands out shared handles to it, so an exhibit placed several
+// times keeps one copy of its meshes and textures on the GPU (and can be drawn instanced, see
+// MuseumObjectManager::drawAll). Imports run on the worker pool; update() uploads them on the
+// GL thread. Not thread-safe: use it from the GL thread only.
+class AssetRegistry {
+public:
+    enum class State { LOADING, READY, FAILED };
+
+    AssetRegistry() = default;
+    AssetRegistry(const AssetRegistry&) = delete;
+    AssetRegistry& operator=(const AssetRegistry&) = delete;
+
+    // Starts importing the model unless it is already loading or loaded. Returns its state.
+    State request(const std::string& path);
+
+    // Uploads an already imported model under data->path. If that path is already resident the
+    // data is dropped and the resident model returned. Null if the upload fails.
+    std::shared_ptr<Model> add(std::unique_ptr<ModelData> data);
+
+    // Re-imports a known model in the background, e.g. after its file changed on disk. update()
+    // swaps the new model in once it is uploaded and keeps the old one if the import fails.
+    // Returns false for paths that were never requested.
+    bool reload(const std::string& path);
+
+    // Whether the path has been requested or added (and not released since)
+    bool contains(const std::string& path) const { return entries.count(path) != 0; }
+
+    // The shared model, or null while it is loading or after its import failed
+    std::shared_ptr<Model> get(const std::string& path) const;
+    State getState(const std::string& path) const;
+
+    // Uploads at most maxUploads finished imports. Returns the paths that became READY or FAILED
+    // and those whose model was replaced by a reload.
+    std::vector<std::string> update(size_t maxUploads = 1);
+
+    // Frees the models no handle outside the registry refers to. Returns how many were freed.
+    size_t releaseUnused();
+
+    // Forgets one model if no handle outside the registry refers to it; the result of an import
+    // still running is discarded. Returns false if the model is still in use.
+    bool release(const std::string& path);
+
+    struct Stats {
+        size_t models = 0;      // Resident
+        size_t loading = 0;
+        size_t handles = 0;     // Outside references to resident models
+    };
+    Stats getStats() const;
+
+private:
+    struct Entry {
+        State state = State::LOADING;
+        std::future<std::unique_ptr<ModelData>> pendingImport;
+        std::shared_ptr<Model> model;
+    };
+    std::map<std::string, Entry> entries;
+
+    // Creates the GL objects on the calling thread; null on failure
+    static std::shared_ptr<Model> upload(std::unique_ptr<ModelData> data);
+};
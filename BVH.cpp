@@ -0,0 +1,214 @@
+#include "BVH.h"
+#include <cmath>
+
+namespace {
+    const int SAH_BIN_COUNT = 12;
+    const int MAX_TREE_DEPTH = 60; // Traversal stack holds 64 entries
+
+    AABB nodeBounds(const BVH::Node& node)
+    {
+        return AABB{ node.boundsMin, node.boundsMax };
+    }
+}
+
+void BVH::build(const std::vector<AABB>& primitiveBounds, unsigned int maxLeafSize)
+{
+    nodes.clear();
+    primitiveIndices.clear();
+    if (primitiveBounds.empty()) return;
+
+    unsigned int count = static_cast<unsigned int>(primitiveBounds.size());
+    primitiveIndices.resize(count);
+    std::vector<glm::vec3> centroids(count);
+    for (unsigned int i = 0; i < count; ++i) {
+        primitiveIndices[i] = i;
+        centroids[i] = primitiveBounds[i].center();
+    }
+
+    // A binary tree with N leaves has at most 2N - 1 nodes
+    nodes.reserve(2 * count);
+
+    Node root;
+    root.leftFirst = 0;
+    root.count = count;
+    AABB bounds;
+    for (const AABB& box : primitiveBounds) bounds.grow(box);
+    root.boundsMin = bounds.min;
+    root.boundsMax = bounds.max;
+    nodes.push_back(root);
+
+    subdivide(0, primitiveBounds, centroids, std::max(1u, maxLeafSize), 0);
+}
+
+void BVH::subdivide(unsigned int nodeIndex, const std::vector<AABB>& primitiveBounds,
+                    const std::vector<glm::vec3>& centroids, unsigned int maxLeafSize, int depth)
+{
+    Node& node = nodes[nodeIndex];
+    if (node.count <= maxLeafSize || depth >= MAX_TREE_DEPTH) return;
+
+    unsigned int first = node.leftFirst;
+    unsigned int count = node.count;
+
+    // Bin by centroid along every axis and keep the cheapest SAH split
+    AABB centroidBounds;
+    for (unsigned int i = first; i < first + count; ++i) {
+        centroidBounds.grow(centroids[primitiveIndices[i]]);
+    }
+
+    int bestAxis = -1;
+    int bestSplit = 0;
+    float bestCost = FLT_MAX;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        float axisMin = centroidBounds.min[axis];
+        float axisMax = centroidBounds.max[axis];
+        if (axisMax - axisMin < 1e-7f) continue;
+
+        AABB binBounds[SAH_BIN_COUNT];
+        unsigned int binCounts[SAH_BIN_COUNT] = {};
+        float scale = SAH_BIN_COUNT / (axisMax - axisMin);
+
+        for (unsigned int i = first; i < first + count; ++i) {
+            unsigned int primitive = primitiveIndices[i];
+            int bin = std::min(SAH_BIN_COUNT - 1, static_cast<int>((centroids[primitive][axis] - axisMin) * scale));
+            binCounts[bin]++;
+            binBounds[bin].grow(primitiveBounds[primitive]);
+        }
+
+        // Sweep from both sides to get the area/count of every split plane
+        float leftArea[SAH_BIN_COUNT - 1], rightArea[SAH_BIN_COUNT - 1];
+        unsigned int leftCount[SAH_BIN_COUNT - 1], rightCount[SAH_BIN_COUNT - 1];
+        AABB leftBox, rightBox;
+        unsigned int leftSum = 0, rightSum = 0;
+        for (int i = 0; i < SAH_BIN_COUNT - 1; ++i) {
+            leftSum += binCounts[i];
+            leftCount[i] = leftSum;
+            leftBox.grow(binBounds[i]);
+            leftArea[i] = leftBox.isValid() ? leftBox.surfaceArea() : 0.0f;
+
+            rightSum += binCounts[SAH_BIN_COUNT - 1 - i];
+            rightCount[SAH_BIN_COUNT - 2 - i] = rightSum;
+            rightBox.grow(binBounds[SAH_BIN_COUNT - 1 - i]);
+            rightArea[SAH_BIN_COUNT - 2 - i] = rightBox.isValid() ? rightBox.surfaceArea() : 0.0f;
+        }
+
+        for (int i = 0; i < SAH_BIN_COUNT - 1; ++i) {
+            if (leftCount[i] == 0 || rightCount[i] == 0) continue;
+            float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i;
+            }
+        }
+    }
+
+    // Splitting must beat testing every primitive in this node
+    float leafCost = static_cast<float>(count) * nodeBounds(node).surfaceArea();
+    if (bestAxis < 0 || bestCost >= leafCost) return;
+
+    // Partition primitives around the chosen bin boundary
+    float axisMin = centroidBounds.min[bestAxis];
+    float scale = SAH_BIN_COUNT / (centroidBounds.max[bestAxis] - axisMin);
+    unsigned int* begin = primitiveIndices.data() + first;
+    unsigned int* middle = std::partition(begin, begin + count, [&](unsigned int primitive) {
+        int bin = std::min(SAH_BIN_COUNT - 1, static_cast<int>((centroids[primitive][bestAxis] - axisMin) * scale));
+        return bin <= bestSplit;
+    });
+    unsigned int leftCount = static_cast<unsigned int>(middle - begin);
+    if (leftCount == 0 || leftCount == count) return;
+
+    // Children are allocated as a pair so the right child is always leftFirst + 1
+    unsigned int leftIndex = static_cast<unsigned int>(nodes.size());
+    for (int child = 0; child < 2; ++child) {
+        Node childNode;
+        childNode.leftFirst = child == 0 ? first : first + leftCount;
+        childNode.count = child == 0 ? leftCount : count - leftCount;
+        AABB childBounds;
+        for (unsigned int i = childNode.leftFirst; i < childNode.leftFirst + childNode.count; ++i) {
+            childBounds.grow(primitiveBounds[primitiveIndices[i]]);
+        }
+        childNode.boundsMin = childBounds.min;
+        childNode.boundsMax = childBounds.max;
+        nodes.push_back(childNode);
+    }
+
+    // 'node' may have been invalidated by push_back
+    nodes[nodeIndex].leftFirst = leftIndex;
+    nodes[nodeIndex].count = 0;
+
+    subdivide(leftIndex, primitiveBounds, centroids, maxLeafSize, depth + 1);
+    subdivide(leftIndex + 1, primitiveBounds, centroids, maxLeafSize, depth + 1);
+}
+
+AABB BVH::getBounds() const
+{
+    if (nodes.empty()) return AABB();
+    return nodeBounds(nodes[0]);
+}
+
+bool intersectTriangle(const glm::vec3& origin, const glm::vec3& direction,
+                       const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2,
+                       float tMin, float tMax, float& t, float& u, float& v)
+{
+    glm::vec3 edge1 = v1 - v0;
+    glm::vec3 edge2 = v2 - v0;
+    glm::vec3 p = glm::cross(direction, edge2);
+    float determinant = glm::dot(edge1, p);
+    if (std::abs(determinant) < 1e-12f) return false; // Ray parallel to triangle
+
+    float invDeterminant = 1.0f / determinant;
+    glm::vec3 s = origin - v0;
+    u = glm::dot(s, p) * invDeterminant;
+    if (u < 0.0f || u > 1.0f) return false;
+
+    glm::vec3 q = glm::cross(s, edge1);
+    v = glm::dot(direction, q) * invDeterminant;
+    if (v < 0.0f || u + v > 1.0f) return false;
+
+    t = glm::dot(edge2, q) * invDeterminant;
+    return t > tMin && t < tMax;
+}
+
+void TriangleBVH::build(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices)
+{
+    size_t triangleCount = indices.size() / 3;
+    std::vector<AABB> bounds(triangleCount);
+    for (size_t i = 0; i < triangleCount; ++i) {
+        bounds[i].grow(positions[indices[i * 3 + 0]]);
+        bounds[i].grow(positions[indices[i * 3 + 1]]);
+        bounds[i].grow(positions[indices[i * 3 + 2]]);
+    }
+
+    bvh.build(bounds);
+
+    // Store triangles in leaf order so traversal reads them sequentially
+    const std::vector<unsigned int>& order = bvh.getPrimitiveIndices();
+    triangles.resize(order.size());
+    for (size_t slot = 0; slot < order.size(); ++slot) {
+        unsigned int original = order[slot];
+        Triangle& triangle = triangles[slot];
+        triangle.v0 = positions[indices[original * 3 + 0]];
+        triangle.v1 = positions[indices[original * 3 + 1]];
+        triangle.v2 = positions[indices[original * 3 + 2]];
+        triangle.originalIndex = original;
+    }
+}
+
+bool TriangleBVH::intersect(const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax, TriangleHit& hit) const
+{
+    return bvh.traverse(origin, direction, tMin, tMax, [&](unsigned int slot, float& closest) {
+        const Triangle& triangle = triangles[slot];
+        float t, u, v;
+        if (!intersectTriangle(origin, direction, triangle.v0, triangle.v1, triangle.v2, tMin, closest, t, u, v)) {
+            return false;
+        }
+        closest = t;
+        hit.t = t;
+        hit.triangle = triangle.originalIndex;
+        hit.u = u;
+        hit.v = v;
+        hit.normal = glm::normalize(glm::cross(triangle.v1 - triangle.v0, triangle.v2 - triangle.v0));
+        return true;
+    });
+}
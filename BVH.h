@@ -0,0 +1,185 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cfloat>
+#include <algorithm>
+
+// Axis-aligned bounding box
+struct AABB {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    void grow(const glm::vec3& point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void grow(const AABB& other) {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    bool isValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    glm::vec3 size() const { return max - min; }
+
+    float surfaceArea() const {
+        glm::vec3 e = max - min;
+        return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+
+    // Slab test. invDirection is 1 / ray direction; returns the entry distance in tNear.
+    bool intersectRay(const glm::vec3& origin, const glm::vec3& invDirection, float tMin, float tMax, float& tNear) const {
+        glm::vec3 t0 = (min - origin) * invDirection;
+        glm::vec3 t1 = (max - origin) * invDirection;
+        glm::vec3 tSmall = glm::min(t0, t1);
+        glm::vec3 tLarge = glm::max(t0, t1);
+        tNear = std::max(std::max(tSmall.x, tSmall.y), std::max(tSmall.z, tMin));
+        float tFar = std::min(std::min(tLarge.x, tLarge.y), std::min(tLarge.z, tMax));
+        return tNear <= tFar;
+    }
+
+    // Bounds of this box after an affine transform
+    AABB transformed(const glm::mat4& matrix) const {
+        AABB result;
+        for (int i = 0; i < 8; ++i) {
+            glm::vec3 corner((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+            result.grow(glm::vec3(matrix * glm::vec4(corner, 1.0f)));
+        }
+        return result;
+    }
+};
+
+// Bounding volume hierarchy over arbitrary primitives, built with binned SAH.
+// The tree only stores bounds and a primitive permutation; callers test the primitives in a leaf
+// themselves, so the same structure serves as top level (objects) and bottom level (triangles).
+class BVH {
+public:
+    // 32-byte node. Leaves have count > 0 and leftFirst = first primitive; inner nodes have
+    // count == 0 and leftFirst = left child (the right child is leftFirst + 1).
+    struct Node {
+        glm::vec3 boundsMin;
+        unsigned int leftFirst;
+        glm::vec3 boundsMax;
+        unsigned int count;
+
+        bool isLeaf() const { return count > 0; }
+    };
+
+    void build(const std::vector<AABB>& primitiveBounds, unsigned int maxLeafSize = 4);
+    void clear() { nodes.clear(); primitiveIndices.clear(); }
+
+    // Visit leaves front-to-back along the ray. leafTest(slot, tMax) is called for every primitive
+    // in a reached leaf, where slot indexes getPrimitiveIndices() (leaf order). It must return true
+    // and shrink tMax when it records a closer hit. Returns true if any primitive was hit.
+    template<class LeafTest>
+    bool traverse(const glm::vec3& origin, const glm::vec3& direction, float tMin, float& tMax, LeafTest&& leafTest) const
+    {
+        if (nodes.empty()) return false;
+        return traverseNodes(nodes.data(), origin, direction, tMin, tMax, leafTest);
+    }
+
+    // Same traversal over an external node array laid out like getNodes() (root at index 0),
+    // e.g. nodes read straight from a memory-mapped file
+    template<class LeafTest>
+    static bool traverseNodes(const Node* nodes, const glm::vec3& origin, const glm::vec3& direction,
+                              float tMin, float& tMax, LeafTest&& leafTest);
+
+    bool empty() const { return nodes.empty(); }
+    AABB getBounds() const;
+    const std::vector<Node>& getNodes() const { return nodes; }
+    const std::vector<unsigned int>& getPrimitiveIndices() const { return primitiveIndices; }
+    size_t getMemoryBytes() const { return nodes.capacity() * sizeof(Node) + primitiveIndices.capacity() * sizeof(unsigned int); }
+
+private:
+    std::vector<Node> nodes;
+    std::vector<unsigned int> primitiveIndices;
+
+    void subdivide(unsigned int nodeIndex, const std::vector<AABB>& primitiveBounds,
+                   const std::vector<glm::vec3>& centroids, unsigned int maxLeafSize, int depth);
+};
+
+template<class LeafTest>
+bool BVH::traverseNodes(const Node* nodes, const glm::vec3& origin, const glm::vec3& direction,
+                        float tMin, float& tMax, LeafTest&& leafTest)
+{
+    glm::vec3 invDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+    bool hitAnything = false;
+
+    unsigned int stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const Node& node = nodes[stack[--stackSize]];
+        float tNear;
+        AABB box{ node.boundsMin, node.boundsMax };
+        if (!box.intersectRay(origin, invDirection, tMin, tMax, tNear)) continue;
+
+        if (node.isLeaf()) {
+            for (unsigned int i = 0; i < node.count; ++i) {
+                if (leafTest(node.leftFirst + i, tMax)) {
+                    hitAnything = true;
+                }
+            }
+            continue;
+        }
+
+        // Push the far child first so the near child is visited first
+        unsigned int left = node.leftFirst;
+        unsigned int right = node.leftFirst + 1;
+        float tLeft, tRight;
+        bool hitLeft = AABB{ nodes[left].boundsMin, nodes[left].boundsMax }.intersectRay(origin, invDirection, tMin, tMax, tLeft);
+        bool hitRight = AABB{ nodes[right].boundsMin, nodes[right].boundsMax }.intersectRay(origin, invDirection, tMin, tMax, tRight);
+
+        if (hitLeft && hitRight) {
+            if (tLeft > tRight) std::swap(left, right);
+            stack[stackSize++] = right;
+            stack[stackSize++] = left;
+        } else if (hitLeft) {
+            stack[stackSize++] = left;
+        } else if (hitRight) {
+            stack[stackSize++] = right;
+        }
+    }
+
+    return hitAnything;
+}
+
+// Result of a ray/triangle query
+struct TriangleHit {
+    float t = FLT_MAX;
+    unsigned int triangle = 0;
+    float u = 0.0f, v = 0.0f;
+    glm::vec3 normal = glm::vec3(0.0f);
+};
+
+// Triangle mesh with its own BVH (bottom level). Triangles are stored in BVH leaf order so a
+// leaf's triangles are contiguous in memory.
+class TriangleBVH {
+public:
+    void build(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices);
+
+    bool intersect(const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax, TriangleHit& hit) const;
+
+    size_t getTriangleCount() const { return triangles.size(); }
+    AABB getBounds() const { return bvh.getBounds(); }
+    const BVH& getHierarchy() const { return bvh; }
+
+    struct Triangle {
+        glm::vec3 v0, v1, v2;
+        unsigned int originalIndex;
+    };
+    const std::vector<Triangle>& getTriangles() const { return triangles; }
+    size_t getMemoryBytes() const { return bvh.getMemoryBytes() + triangles.capacity() * sizeof(Triangle); }
+
+private:
+    BVH bvh;
+    std::vector<Triangle> triangles;
+};
+
+// Möller-Trumbore ray/triangle test
+bool intersectTriangle(const glm::vec3& origin, const glm::vec3& direction,
+                       const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2,
+                       float tMin, float tMax, float& t, float& u, float& v);
@@ -0,0 +1,532 @@
+#include "CompressedTexture.h"
+#include "ThreadPool.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <thread>
+#include <functional>
+
+// S3TC enums come from EXT_texture_compression_s3tc, which GLAD was not generated with
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+std::atomic<bool> CompressedTexture::s3tcSupported(false);
+
+namespace {
+    const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+    struct Ktx2Header {
+        unsigned char identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+
+    struct Ktx2LevelIndex {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    static_assert(sizeof(Ktx2Header) == 80, "KTX2 header layout");
+
+    // VkFormat values used by KTX2
+    const uint32_t VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131;
+    const uint32_t VK_FORMAT_BC3_UNORM_BLOCK = 137;
+    const uint32_t VK_FORMAT_BC4_UNORM_BLOCK = 139;
+    const uint32_t VK_FORMAT_BC5_UNORM_BLOCK = 141;
+
+    const uint64_t LEVEL_ALIGNMENT = 16;
+
+    uint32_t vkFormatOf(CompressedTexture::Format format)
+    {
+        switch (format) {
+        case CompressedTexture::Format::BC1: return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        case CompressedTexture::Format::BC3: return VK_FORMAT_BC3_UNORM_BLOCK;
+        case CompressedTexture::Format::BC4: return VK_FORMAT_BC4_UNORM_BLOCK;
+        default: return VK_FORMAT_BC5_UNORM_BLOCK;
+        }
+    }
+
+    bool formatFromVk(uint32_t vkFormat, CompressedTexture::Format& format)
+    {
+        switch (vkFormat) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK: format = CompressedTexture::Format::BC1; return true;
+        case VK_FORMAT_BC3_UNORM_BLOCK: format = CompressedTexture::Format::BC3; return true;
+        case VK_FORMAT_BC4_UNORM_BLOCK: format = CompressedTexture::Format::BC4; return true;
+        case VK_FORMAT_BC5_UNORM_BLOCK: format = CompressedTexture::Format::BC5; return true;
+        default: return false;
+        }
+    }
+
+    size_t blockBytes(CompressedTexture::Format format)
+    {
+        return (format == CompressedTexture::Format::BC1 || format == CompressedTexture::Format::BC4) ? 8 : 16;
+    }
+
+    size_t levelBytes(CompressedTexture::Format format, int width, int height)
+    {
+        return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+    }
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // ---- Encoders. Blocks are 4x4 RGBA texels; edge blocks repeat the last row/column. ----
+
+    typedef unsigned char Block[16][4];
+
+    void loadBlock(const unsigned char* pixels, int width, int height, int components, int blockX, int blockY, Block block)
+    {
+        for (int y = 0; y < 4; ++y) {
+            int sy = std::min(blockY * 4 + y, height - 1);
+            for (int x = 0; x < 4; ++x) {
+                int sx = std::min(blockX * 4 + x, width - 1);
+                const unsigned char* texel = pixels + (static_cast<size_t>(sy) * width + sx) * components;
+                unsigned char* out = block[y * 4 + x];
+                out[0] = texel[0];
+                out[1] = components > 1 ? texel[1] : 0;
+                out[2] = components > 2 ? texel[2] : 0;
+                out[3] = components > 3 ? texel[3] : 255;
+            }
+        }
+    }
+
+    uint16_t packRGB565(const float color[3])
+    {
+        int r = static_cast<int>(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+        int g = static_cast<int>(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+        int b = static_cast<int>(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void unpackRGB565(uint16_t packed, int color[3])
+    {
+        int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    // Picks the nearest of the four palette colours for every texel; returns the squared error
+    int chooseColorIndices(const Block block, uint16_t c0, uint16_t c1, uint32_t& indices)
+    {
+        int palette[4][3];
+        unpackRGB565(c0, palette[0]);
+        unpackRGB565(c1, palette[1]);
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        indices = 0;
+        int totalError = 0;
+        for (int i = 0; i < 16; ++i) {
+            int bestIndex = 0, bestError = INT_MAX;
+            for (int p = 0; p < 4; ++p) {
+                int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError) {
+                    bestError = error;
+                    bestIndex = p;
+                }
+            }
+            indices |= static_cast<uint32_t>(bestIndex) << (2 * i);
+            totalError += bestError;
+        }
+        return totalError;
+    }
+
+    void writeColorBlock(unsigned char* out, uint16_t c0, uint16_t c1, uint32_t indices)
+    {
+        out[0] = static_cast<unsigned char>(c0 & 0xFF);
+        out[1] = static_cast<unsigned char>(c0 >> 8);
+        out[2] = static_cast<unsigned char>(c1 & 0xFF);
+        out[3] = static_cast<unsigned char>(c1 >> 8);
+        for (int i = 0; i < 4; ++i) out[4 + i] = static_cast<unsigned char>(indices >> (8 * i));
+    }
+
+    // Orders the endpoints for the 4-colour mode (c0 > c1) and encodes; returns the squared error
+    int encodeWithEndpoints(const Block block, uint16_t c0, uint16_t c1, unsigned char* out)
+    {
+        if (c0 < c1) std::swap(c0, c1);
+        // Equal endpoints select the 3-colour mode, but then every palette entry matches and all
+        // indices come out as 0, which is the endpoint colour in both modes
+        uint32_t indices = 0;
+        int error = chooseColorIndices(block, c0, c1, indices);
+        writeColorBlock(out, c0, c1, indices);
+        return error;
+    }
+
+    // BC1 colour block: endpoints along the principal axis of the texels, then one least-squares refinement
+    void encodeColorBlock(const Block block, unsigned char* out)
+    {
+        float mean[3] = { 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < 3; ++c) mean[c] += block[i][c];
+        }
+        for (int c = 0; c < 3; ++c) mean[c] /= 16.0f;
+
+        float covariance[6] = { 0.0f };   // xx, xy, xz, yy, yz, zz
+        for (int i = 0; i < 16; ++i) {
+            float r = block[i][0] - mean[0], g = block[i][1] - mean[1], b = block[i][2] - mean[2];
+            covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+            covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+        }
+
+        // Power iteration for the dominant eigenvector
+        float axis[3] = { 1.0f, 1.0f, 1.0f };
+        for (int iteration = 0; iteration < 4; ++iteration) {
+            float next[3] = {
+                covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+                covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+                covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]
+            };
+            float length = std::max({ std::abs(next[0]), std::abs(next[1]), std::abs(next[2]) });
+            if (length < 1e-6f) break;
+            for (int c = 0; c < 3; ++c) axis[c] = next[c] / length;
+        }
+
+        float minProjection = FLT_MAX, maxProjection = -FLT_MAX;
+        int minIndex = 0, maxIndex = 0;
+        for (int i = 0; i < 16; ++i) {
+            float projection = block[i][0] * axis[0] + block[i][1] * axis[1] + block[i][2] * axis[2];
+            if (projection < minProjection) { minProjection = projection; minIndex = i; }
+            if (projection > maxProjection) { maxProjection = projection; maxIndex = i; }
+        }
+
+        // Pull the endpoints in slightly; the extremes are rarely the best palette ends
+        float maxColor[3], minColor[3];
+        for (int c = 0; c < 3; ++c) {
+            float inset = (block[maxIndex][c] - block[minIndex][c]) / 16.0f;
+            maxColor[c] = block[maxIndex][c] - inset;
+            minColor[c] = block[minIndex][c] + inset;
+        }
+
+        unsigned char best[8];
+        int bestError = encodeWithEndpoints(block, packRGB565(maxColor), packRGB565(minColor), best);
+
+        // Least-squares fit of both endpoints to the chosen indices
+        uint32_t indices = static_cast<uint32_t>(best[4]) | (static_cast<uint32_t>(best[5]) << 8) |
+                           (static_cast<uint32_t>(best[6]) << 16) | (static_cast<uint32_t>(best[7]) << 24);
+        static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        float aa = 0.0f, bb = 0.0f, ab = 0.0f, ax[3] = { 0.0f }, bx[3] = { 0.0f };
+        for (int i = 0; i < 16; ++i) {
+            float a = weights[(indices >> (2 * i)) & 3], b = 1.0f - a;
+            aa += a * a; bb += b * b; ab += a * b;
+            for (int c = 0; c < 3; ++c) {
+                ax[c] += a * block[i][c];
+                bx[c] += b * block[i][c];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) > 1e-6f) {
+            float refined0[3], refined1[3];
+            for (int c = 0; c < 3; ++c) {
+                refined0[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+                refined1[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+            }
+            unsigned char candidate[8];
+            if (encodeWithEndpoints(block, packRGB565(refined0), packRGB565(refined1), candidate) < bestError) {
+                std::memcpy(best, candidate, sizeof(best));
+            }
+        }
+        std::memcpy(out, best, sizeof(best));
+    }
+
+    // BC4 block for one channel, using the 8-value interpolation mode
+    void encodeChannelBlock(const Block block, int channel, unsigned char* out)
+    {
+        int lo = 255, hi = 0;
+        for (int i = 0; i < 16; ++i) {
+            lo = std::min<int>(lo, block[i][channel]);
+            hi = std::max<int>(hi, block[i][channel]);
+        }
+
+        out[0] = static_cast<unsigned char>(hi);
+        out[1] = static_cast<unsigned char>(lo);
+        uint64_t indices = 0;
+        if (hi > lo) {
+            for (int i = 0; i < 16; ++i) {
+                // Step 0 is the low endpoint, 7 the high one; remap to the BC4 index order
+                int step = ((block[i][channel] - lo) * 14 + (hi - lo)) / (2 * (hi - lo));
+                uint64_t index = step == 7 ? 0 : step == 0 ? 1 : static_cast<uint64_t>(8 - step);
+                indices |= index << (3 * i);
+            }
+        }
+        for (int i = 0; i < 6; ++i) out[2 + i] = static_cast<unsigned char>(indices >> (8 * i));
+    }
+
+    // Next mip level with a 2x2 box filter (odd edges reuse the last texel)
+    std::vector<unsigned char> downsample(const unsigned char* pixels, int width, int height, int components,
+                                          int& nextWidth, int& nextHeight)
+    {
+        nextWidth = std::max(1, width / 2);
+        nextHeight = std::max(1, height / 2);
+        std::vector<unsigned char> next(static_cast<size_t>(nextWidth) * nextHeight * components);
+        for (int y = 0; y < nextHeight; ++y) {
+            int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+            for (int x = 0; x < nextWidth; ++x) {
+                int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+                for (int c = 0; c < components; ++c) {
+                    int sum = pixels[(static_cast<size_t>(y0) * width + x0) * components + c] +
+                              pixels[(static_cast<size_t>(y0) * width + x1) * components + c] +
+                              pixels[(static_cast<size_t>(y1) * width + x0) * components + c] +
+                              pixels[(static_cast<size_t>(y1) * width + x1) * components + c];
+                    next[(static_cast<size_t>(y) * nextWidth + x) * components + c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+        return next;
+    }
+
+    void encodeLevel(CompressedTexture::Format format, const unsigned char* pixels, int width, int height,
+                     int components, unsigned char* out)
+    {
+        int blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4;
+        size_t bytesPerBlock = blockBytes(format);
+
+        auto encodeRows = [&](size_t begin, size_t end) {
+            Block block;
+            for (size_t by = begin; by < end; ++by) {
+                for (int bx = 0; bx < blocksWide; ++bx) {
+                    loadBlock(pixels, width, height, components, bx, static_cast<int>(by), block);
+                    unsigned char* target = out + (by * blocksWide + bx) * bytesPerBlock;
+                    switch (format) {
+                    case CompressedTexture::Format::BC1:
+                        encodeColorBlock(block, target);
+                        break;
+                    case CompressedTexture::Format::BC3:
+                        encodeChannelBlock(block, 3, target);
+                        encodeColorBlock(block, target + 8);
+                        break;
+                    case CompressedTexture::Format::BC4:
+                        encodeChannelBlock(block, 0, target);
+                        break;
+                    case CompressedTexture::Format::BC5:
+                        encodeChannelBlock(block, 0, target);
+                        encodeChannelBlock(block, 1, target + 8);
+                        break;
+                    }
+                }
+            }
+        };
+
+        // Model imports already decode their textures one per pool task, so a worker encodes its
+        // image itself rather than fanning rows out to a pool whose workers are busy with the other images
+        if (ThreadPool::isWorkerThread()) {
+            encodeRows(0, static_cast<size_t>(blocksHigh));
+        } else {
+            ThreadPool::shared().parallelFor(static_cast<size_t>(blocksHigh), 4, encodeRows);
+        }
+    }
+}
+
+std::shared_ptr<CompressedTexture> CompressedTexture::encode(const unsigned char* pixels, int width, int height, int components,
+                                                             bool normalMap)
+{
+    if (!pixels || width <= 0 || height <= 0 || components < 1 || components > 4) return nullptr;
+
+    Format format;
+    if (components == 1) {
+        format = Format::BC4;
+    } else if (components == 2 || normalMap) {
+        format = Format::BC5;
+    } else {
+        bool opaque = true;
+        if (components == 4) {
+            size_t texelCount = static_cast<size_t>(width) * height;
+            for (size_t i = 0; i < texelCount && opaque; ++i) opaque = pixels[i * 4 + 3] == 255;
+        }
+        format = opaque ? Format::BC1 : Format::BC3;
+        if (!s3tcSupported) return nullptr;
+    }
+
+    // Lay out every level first so the levels can point into one buffer
+    std::shared_ptr<CompressedTexture> texture(new CompressedTexture());
+    texture->format = format;
+    size_t totalBytes = 0;
+    for (int w = width, h = height; ; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+        texture->levels.push_back({ w, h, nullptr, levelBytes(format, w, h) });
+        totalBytes += texture->levels.back().size;
+        if (w == 1 && h == 1) break;
+    }
+    texture->storage.resize(totalBytes);
+
+    std::vector<unsigned char> mip;
+    const unsigned char* source = pixels;
+    int sourceWidth = width, sourceHeight = height;
+    size_t offset = 0;
+    for (size_t i = 0; i < texture->levels.size(); ++i) {
+        Level& level = texture->levels[i];
+        if (i > 0) {
+            mip = downsample(source, sourceWidth, sourceHeight, components, sourceWidth, sourceHeight);
+            source = mip.data();
+        }
+        encodeLevel(format, source, level.width, level.height, components, texture->storage.data() + offset);
+        level.data = texture->storage.data() + offset;
+        offset += level.size;
+    }
+    return texture;
+}
+
+std::shared_ptr<CompressedTexture> CompressedTexture::load(const std::string& path)
+{
+    std::shared_ptr<CompressedTexture> texture(new CompressedTexture());
+    if (!texture->file.open(path) || texture->file.size() < sizeof(Ktx2Header)) return nullptr;
+    texture->view = texture->file.mapAll();
+    if (!texture->view) return nullptr;
+
+    const unsigned char* base = texture->view->data();
+    Ktx2Header header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0 ||
+        !formatFromVk(header.vkFormat, texture->format) || header.levelCount == 0 || header.levelCount > 32 ||
+        header.pixelWidth == 0 || header.pixelHeight == 0 || header.supercompressionScheme != 0 ||
+        sizeof(Ktx2Header) + header.levelCount * sizeof(Ktx2LevelIndex) > texture->file.size()) {
+        std::cout << "ERROR::COMPRESSED_TEXTURE:: Invalid container: " << path << std::endl;
+        return nullptr;
+    }
+
+    const unsigned char* levelIndex = base + sizeof(Ktx2Header);
+    for (uint32_t i = 0; i < header.levelCount; ++i) {
+        Ktx2LevelIndex entry;
+        std::memcpy(&entry, levelIndex + i * sizeof(Ktx2LevelIndex), sizeof(entry));
+        int w = std::max(1, static_cast<int>(header.pixelWidth >> i));
+        int h = std::max(1, static_cast<int>(header.pixelHeight >> i));
+        if (entry.byteLength != levelBytes(texture->format, w, h) || entry.byteOffset + entry.byteLength > texture->file.size()) {
+            std::cout << "ERROR::COMPRESSED_TEXTURE:: Corrupt level table: " << path << std::endl;
+            return nullptr;
+        }
+        texture->levels.push_back({ w, h, base + entry.byteOffset, static_cast<size_t>(entry.byteLength) });
+    }
+    return texture;
+}
+
+bool CompressedTexture::save(const std::string& path) const
+{
+    if (levels.empty()) return false;
+
+    Ktx2Header header = {};
+    std::memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    header.vkFormat = vkFormatOf(format);
+    header.typeSize = 1;
+    header.pixelWidth = static_cast<uint32_t>(levels[0].width);
+    header.pixelHeight = static_cast<uint32_t>(levels[0].height);
+    header.faceCount = 1;
+    header.levelCount = static_cast<uint32_t>(levels.size());
+
+    // KTX2 stores the smallest level first
+    std::vector<Ktx2LevelIndex> index(levels.size());
+    uint64_t offset = sizeof(Ktx2Header) + levels.size() * sizeof(Ktx2LevelIndex);
+    for (size_t i = levels.size(); i-- > 0;) {
+        offset = alignUp(offset, LEVEL_ALIGNMENT);
+        index[i].byteOffset = offset;
+        index[i].byteLength = levels[i].size;
+        index[i].uncompressedByteLength = levels[i].size;
+        offset += levels[i].size;
+    }
+
+    // Concurrent writers of the same texture each use their own temporary file
+    std::string tempPath = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cout << "ERROR::COMPRESSED_TEXTURE:: Cannot write " << tempPath << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(Ktx2LevelIndex));
+
+        static const char zeros[LEVEL_ALIGNMENT] = {};
+        uint64_t written = sizeof(Ktx2Header) + levels.size() * sizeof(Ktx2LevelIndex);
+        for (size_t i = levels.size(); i-- > 0;) {
+            out.write(zeros, static_cast<std::streamsize>(index[i].byteOffset - written));
+            out.write(reinterpret_cast<const char*>(levels[i].data), static_cast<std::streamsize>(levels[i].size));
+            written = index[i].byteOffset + levels[i].size;
+        }
+
+        if (!out) {
+            std::cout << "ERROR::COMPRESSED_TEXTURE:: Write failed: " << tempPath << std::endl;
+            out.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    std::remove(path.c_str());
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+unsigned int CompressedTexture::upload() const
+{
+    GLenum glFormat;
+    switch (format) {
+    case Format::BC1: glFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT; break;
+    case Format::BC3: glFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+    case Format::BC4: glFormat = GL_COMPRESSED_RED_RGTC1; break;
+    default: glFormat = GL_COMPRESSED_RG_RGTC2; break;
+    }
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), glFormat, levels[i].width, levels[i].height, 0,
+                               static_cast<GLsizei>(levels[i].size), levels[i].data);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels.size() - 1));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return textureID;
+}
+
+size_t CompressedTexture::getByteSize() const
+{
+    size_t total = 0;
+    for (const Level& level : levels) total += level.size;
+    return total;
+}
+
+void CompressedTexture::detectSupport()
+{
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount; ++i) {
+        const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+        if (name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0) {
+            s3tcSupported = true;
+            return;
+        }
+    }
+    std::cout << "S3TC texture compression not supported; colour textures stay uncompressed" << std::endl;
+}
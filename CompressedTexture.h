@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include "MappedFile.h"
+
+// Block-compressed (BCn) texture with a precomputed mip chain.
+// Encoding happens once on a worker thread; the result is saved in a KTX2-style container
+// (KTX2 identifier, header and level index, without the data format descriptor) that later
+// runs map and hand straight to glCompressedTexImage2D, skipping image decoding entirely.
+// Formats: BC1 for opaque colour, BC3 for colour with alpha, BC4 for one channel and BC5 for two,
+// or for the X and Y of a tangent-space normal map (Z is rebuilt in the shader).
+class CompressedTexture {
+public:
+    enum class Format { BC1, BC3, BC4, BC5 };
+
+    struct Level {
+        int width;
+        int height;
+        const unsigned char* data;
+        size_t size;
+    };
+
+    // Encodes 8-bit pixels with 1-4 channels and all of their mip levels. A normal map with at
+    // least two channels keeps only X and Y, as BC5. Returns null if the GPU cannot sample the
+    // chosen format (S3TC support is known only after detectSupport()).
+    static std::shared_ptr<CompressedTexture> encode(const unsigned char* pixels, int width, int height, int components,
+                                                     bool normalMap = false);
+
+    // Maps a container written by save(). Returns null if it is missing or invalid.
+    static std::shared_ptr<CompressedTexture> load(const std::string& path);
+
+    bool save(const std::string& path) const;
+
+    // Creates the GL texture with every level. Must run on the GL thread.
+    unsigned int upload() const;
+
+    Format getFormat() const { return format; }
+    int getWidth() const { return levels.empty() ? 0 : levels[0].width; }
+    int getHeight() const { return levels.empty() ? 0 : levels[0].height; }
+    const std::vector<Level>& getLevels() const { return levels; }
+    size_t getByteSize() const;
+
+    // Checks the context for S3TC (BC1/BC3); BC4/BC5 are core. Call on the GL thread after
+    // loading GLAD and before textures are loaded; colour textures stay uncompressed otherwise.
+    static void detectSupport();
+
+private:
+    Format format = Format::BC1;
+    std::vector<Level> levels;
+    std::vector<unsigned char> storage;   // Encoded data when built in memory
+    MappedFile file;                      // Or the mapped container when loaded from disk
+    std::unique_ptr<MappedView> view;
+
+    static std::atomic<bool> s3tcSupported;
+};
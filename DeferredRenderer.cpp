@@ -0,0 +1,120 @@
+#include "DeferredRenderer.h"
+#include <iostream>
+
+namespace {
+    unsigned int createAttachment(int width, int height, GLint internalFormat, GLenum format, GLenum type, GLenum attachment)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+        return texture;
+    }
+}
+
+DeferredRenderer::DeferredRenderer(int width, int height)
+    : width(width), height(height),
+      geometryShader("shader.vert", "deferred.frag", { "HAS_TEXTURE", "HAS_SPECULAR_MAP", "HAS_NORMAL_MAP" }),
+      lightingShader("lighting.vert", "lighting.frag")
+{
+    glGenVertexArrays(1, &emptyVAO);
+    create();
+}
+
+DeferredRenderer::~DeferredRenderer()
+{
+    destroy();
+    glDeleteVertexArrays(1, &emptyVAO);
+}
+
+void DeferredRenderer::resize(int newWidth, int newHeight)
+{
+    if (newWidth == width && newHeight == height) return;
+    if (newWidth <= 0 || newHeight <= 0) return; // Minimized window
+
+    destroy();
+    width = newWidth;
+    height = newHeight;
+    create();
+}
+
+void DeferredRenderer::create()
+{
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+    normalTexture = createAttachment(width, height, GL_RG16F, GL_RG, GL_FLOAT, GL_COLOR_ATTACHMENT0);
+    albedoTexture = createAttachment(width, height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT1);
+    specularTexture = createAttachment(width, height, GL_RG8, GL_RG, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT2);
+    // Same format as the default framebuffer's depth, which glBlitFramebuffer requires
+    depthTexture = createAttachment(width, height, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8,
+                                    GL_DEPTH_STENCIL_ATTACHMENT);
+
+    unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+    glDrawBuffers(3, attachments);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::DEFERRED:: Framebuffer is not complete (" << width << "x" << height << ")" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void DeferredRenderer::destroy()
+{
+    unsigned int textures[] = { normalTexture, albedoTexture, specularTexture, depthTexture };
+    glDeleteTextures(4, textures);
+    glDeleteFramebuffers(1, &FBO);
+    normalTexture = albedoTexture = specularTexture = depthTexture = 0;
+    FBO = 0;
+}
+
+Shader& DeferredRenderer::beginGeometryPass()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glViewport(0, 0, width, height);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    geometryShader.use();
+    return geometryShader;
+}
+
+void DeferredRenderer::renderLighting(const glm::mat4& view, const glm::mat4& projection, const LightClusters& clusters)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    GLboolean depthTestWasEnabled = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+
+    lightingShader.use();
+    lightingShader.setMat4("inverseViewProjection", glm::inverse(projection * view));
+    unsigned int textures[] = { normalTexture, albedoTexture, specularTexture, depthTexture };
+    const char* samplers[] = { "gNormal", "gAlbedo", "gSpecular", "gDepth" };
+    for (int i = 0; i < 4; ++i) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        lightingShader.setInt(samplers[i], i);
+    }
+    clusters.bind(lightingShader);
+
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    for (int i = 3; i >= 0; --i) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    glDepthMask(GL_TRUE);
+    if (depthTestWasEnabled) glEnable(GL_DEPTH_TEST);
+
+    // Later passes (the hybrid composite, future forward geometry) test against the scene depth
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
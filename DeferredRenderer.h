@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "Shader.h"
+#include "LightClusters.h"
+
+// Deferred shading path. The scene is drawn once into a compact G-buffer (deferred.frag): an
+// octahedral normal, the diffuse colour with the ambient ratio, and the specular intensity and
+// shininess, 14 bytes per pixel with depth. A full-screen pass (lighting.frag) then lights each
+// visible pixel exactly once with the directional light and the lights of its cluster, so the
+// lighting cost no longer grows with overdraw. The depth is copied to the default framebuffer
+// afterwards, so later passes can depth test against the scene.
+class DeferredRenderer {
+public:
+    DeferredRenderer(int width, int height);
+    ~DeferredRenderer();
+
+    DeferredRenderer(const DeferredRenderer&) = delete;
+    DeferredRenderer& operator=(const DeferredRenderer&) = delete;
+
+    // Recreate the attachments when the framebuffer size changes
+    void resize(int width, int height);
+
+    // Binds and clears the G-buffer and activates the geometry program, which takes the same
+    // uniforms as shader.vert/shader.frag, so the usual draw calls can be issued with it
+    Shader& beginGeometryPass();
+
+    // Lights the G-buffer into the default framebuffer and copies the depth there
+    void renderLighting(const glm::mat4& view, const glm::mat4& projection, const LightClusters& clusters);
+
+    std::vector<Shader*> getShaders() { return { &geometryShader, &lightingShader }; }
+
+    // Bytes per pixel of the G-buffer attachments, depth included
+    static int getBytesPerPixel() { return 14; }
+
+private:
+    int width, height;
+    unsigned int FBO = 0;
+    unsigned int normalTexture = 0, albedoTexture = 0, specularTexture = 0, depthTexture = 0;
+    unsigned int emptyVAO = 0;   // Core profile draws need a VAO even without attributes
+
+    Shader geometryShader;
+    Shader lightingShader;
+
+    void create();
+    void destroy();
+};
@@ -0,0 +1,185 @@
+#include "FileWatcher.h"
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // Longest the thread sleeps between scans; also bounds how long the destructor waits
+    const int WAKE_INTERVAL_MS = 250;
+}
+
+FileWatcher::FileWatcher()
+{
+    thread = std::thread(&FileWatcher::run, this);
+}
+
+FileWatcher::~FileWatcher()
+{
+    stopping = true;
+    if (thread.joinable()) thread.join();
+}
+
+void FileWatcher::watch(const std::string& path, Callback onChange)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto inserted = files.emplace(path, WatchedFile());
+    if (inserted.second) {
+        inserted.first->second.stamp = stampFile(path);
+        if (directories.insert(directoryOf(path)).second) directoriesChanged = true;
+    }
+    inserted.first->second.callbacks.push_back(std::move(onChange));
+}
+
+size_t FileWatcher::poll()
+{
+    std::vector<std::pair<std::string, std::vector<Callback>>> changed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto now = std::chrono::steady_clock::now();
+        for (auto& item : files) {
+            WatchedFile& file = item.second;
+            if (!file.pending || now - file.changedAt < debounce) continue;
+            file.pending = false;
+
+            // A save that replaces the file shows up as a deletion first; wait for the new file
+            if (file.stamp.exists) changed.emplace_back(item.first, file.callbacks);
+        }
+    }
+
+    // Outside the lock, so callbacks may watch further files
+    for (const auto& file : changed) {
+        std::cout << "File changed: " << file.first << std::endl;
+        for (const Callback& callback : file.second) {
+            callback(file.first);
+        }
+    }
+    return changed.size();
+}
+
+void FileWatcher::scan()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto now = std::chrono::steady_clock::now();
+    for (auto& item : files) {
+        Stamp stamp = stampFile(item.first);
+        if (stamp != item.second.stamp) {
+            item.second.stamp = stamp;
+            item.second.pending = true;
+            item.second.changedAt = now;
+        }
+    }
+}
+
+#ifdef _WIN32
+void FileWatcher::run()
+{
+    std::vector<HANDLE> handles;
+    while (!stopping) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (directoriesChanged) {
+                for (HANDLE handle : handles) FindCloseChangeNotification(handle);
+                handles.clear();
+                for (const std::string& directory : directories) {
+                    if (handles.size() == MAXIMUM_WAIT_OBJECTS) break;   // The rest is caught by the timed scans
+                    HANDLE handle = FindFirstChangeNotificationA(directory.c_str(), FALSE,
+                        FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE);
+                    if (handle != INVALID_HANDLE_VALUE) handles.push_back(handle);
+                }
+                directoriesChanged = false;
+            }
+        }
+
+        if (handles.empty()) {
+            Sleep(WAKE_INTERVAL_MS);
+        } else {
+            DWORD result = WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), FALSE, WAKE_INTERVAL_MS);
+            if (result >= WAIT_OBJECT_0 && result < WAIT_OBJECT_0 + handles.size()) {
+                FindNextChangeNotification(handles[result - WAIT_OBJECT_0]);
+            }
+        }
+        scan();
+    }
+    for (HANDLE handle : handles) FindCloseChangeNotification(handle);
+}
+
+FileWatcher::Stamp FileWatcher::stampFile(const std::string& path)
+{
+    Stamp stamp;
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes)) {
+        stamp.exists = true;
+        stamp.modified = (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+        stamp.size = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+    }
+    return stamp;
+}
+#else
+void FileWatcher::run()
+{
+    int descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (descriptor < 0) {
+        std::cout << "ERROR::FILE_WATCHER:: inotify unavailable, falling back to timed scans" << std::endl;
+    }
+
+    std::set<std::string> watchedDirectories;
+    while (!stopping) {
+        if (descriptor >= 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (directoriesChanged) {
+                for (const std::string& directory : directories) {
+                    if (!watchedDirectories.insert(directory).second) continue;
+                    inotify_add_watch(descriptor, directory.c_str(),
+                                      IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+                }
+                directoriesChanged = false;
+            }
+        }
+
+        if (descriptor >= 0) {
+            pollfd request = { descriptor, POLLIN, 0 };
+            if (::poll(&request, 1, WAKE_INTERVAL_MS) > 0) {
+                // The events only wake us up; the stamps decide which watched files changed
+                char events[4096];
+                while (read(descriptor, events, sizeof(events)) > 0) {}
+            }
+        } else {
+            usleep(WAKE_INTERVAL_MS * 1000);
+        }
+        scan();
+    }
+    if (descriptor >= 0) close(descriptor);
+}
+
+FileWatcher::Stamp FileWatcher::stampFile(const std::string& path)
+{
+    Stamp stamp;
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0) {
+        stamp.exists = true;
+        stamp.modified = static_cast<uint64_t>(info.st_mtim.tv_sec) * 1000000000ull + static_cast<uint64_t>(info.st_mtim.tv_nsec);
+        stamp.size = static_cast<uint64_t>(info.st_size);
+    }
+    return stamp;
+}
+#endif
+
+std::string FileWatcher::directoryOf(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    if (slash == std::string::npos) return ".";
+    return slash == 0 ? path.substr(0, 1) : path.substr(0, slash);
+}
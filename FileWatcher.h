@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Watches individual files for changes on a background thread and runs their callbacks on the
+// thread that calls poll() (the GL thread, between frames). The thread sleeps on inotify (Linux)
+// or directory change notifications (Windows) for the watched files' directories; a file counts
+// as changed when its modification time or size differs, and is reported once it has been quiet
+// for a short debounce so an editor's multi-step save triggers a single reload.
+class FileWatcher {
+public:
+    using Callback = std::function<void(const std::string& path)>;
+
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Runs onChange from poll() whenever the file changes. A file may have several callbacks.
+    void watch(const std::string& path, Callback onChange);
+
+    // Runs the callbacks of the files that changed and have settled. Returns how many files.
+    size_t poll();
+
+    // Quiet time before a change is reported
+    std::chrono::milliseconds debounce = std::chrono::milliseconds(150);
+
+private:
+    struct Stamp {
+        bool exists = false;
+        uint64_t modified = 0;   // Platform time units; only compared for equality
+        uint64_t size = 0;
+        bool operator!=(const Stamp& other) const {
+            return exists != other.exists || modified != other.modified || size != other.size;
+        }
+    };
+
+    struct WatchedFile {
+        Stamp stamp;
+        bool pending = false;
+        std::chrono::steady_clock::time_point changedAt;
+        std::vector<Callback> callbacks;
+    };
+
+    std::mutex mutex;                         // Guards files and directories
+    std::map<std::string, WatchedFile> files;
+    std::set<std::string> directories;        // Parents of the watched files
+    bool directoriesChanged = false;
+
+    std::thread thread;
+    std::atomic<bool> stopping{ false };
+
+    void run();
+
+    // Compares every watched file with its last stamp and marks the changed ones pending
+    void scan();
+
+    static Stamp stampFile(const std::string& path);
+    static std::string directoryOf(const std::string& path);
+};
@@ -0,0 +1,51 @@
+#include "FrameUniforms.h"
+
+namespace {
+    unsigned int createBuffer(size_t size, unsigned int binding)
+    {
+        unsigned int buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        return buffer;
+    }
+
+    void writeBuffer(unsigned int buffer, const void* data, size_t size)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        // Orphan the previous contents so the write never waits for draws still reading them
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+}
+
+FrameUniforms::FrameUniforms()
+{
+    cameraUBO = createBuffer(sizeof(Camera), CAMERA_BINDING);
+    lightsUBO = createBuffer(sizeof(Lights), LIGHTS_BINDING);
+}
+
+FrameUniforms::~FrameUniforms()
+{
+    glDeleteBuffers(1, &cameraUBO);
+    glDeleteBuffers(1, &lightsUBO);
+}
+
+void FrameUniforms::attach(Shader& shader) const
+{
+    shader.bindUniformBlock("Camera", CAMERA_BINDING);
+    shader.bindUniformBlock("Lights", LIGHTS_BINDING);
+}
+
+void FrameUniforms::setCamera(const Camera& camera)
+{
+    writeBuffer(cameraUBO, &camera, sizeof(Camera));
+}
+
+void FrameUniforms::setLights(const Lights& lights)
+{
+    writeBuffer(lightsUBO, &lights, sizeof(Lights));
+}
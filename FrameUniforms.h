@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Shader.h"
+
+// Uniform buffers written once per frame and shared by every program: the camera matrices and
+// the directional light with the light cluster grid. The structs mirror the std140 blocks in
+// shader.vert, shader.frag and gbuffer.vert member for member; each vec3 is followed by a float
+// to fill its 16-byte slot.
+class FrameUniforms {
+public:
+    // Binding points of the blocks
+    static const unsigned int CAMERA_BINDING = 0;
+    static const unsigned int LIGHTS_BINDING = 1;
+
+    struct Camera {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec3 viewPos;
+        float padding;
+    };
+
+    struct DirLight {
+        glm::vec3 direction; float padding0;
+        glm::vec3 ambient;   float padding1;
+        glm::vec3 diffuse;   float padding2;
+        glm::vec3 specular;  float padding3;
+    };
+
+    // The directional light and the cluster grid; point and spot lights are in LightClusters
+    struct Lights {
+        DirLight dirLight;
+        glm::vec4 clusterScale;   // Tiles per pixel (x, y), depth slice scale and bias (z, w)
+        glm::ivec4 clusterCount;  // Tiles in x and y, depth slices
+    };
+
+    FrameUniforms();
+    ~FrameUniforms();
+
+    FrameUniforms(const FrameUniforms&) = delete;
+    FrameUniforms& operator=(const FrameUniforms&) = delete;
+
+    // Binds the program's Camera and Lights blocks (whichever it declares) to the buffers
+    void attach(Shader& shader) const;
+
+    // One buffer write each; call before drawing the frame
+    void setCamera(const Camera& camera);
+    void setLights(const Lights& lights);
+
+private:
+    unsigned int cameraUBO = 0;
+    unsigned int lightsUBO = 0;
+};
+
+static_assert(sizeof(FrameUniforms::Camera) == 144, "Camera must match the std140 block");
+static_assert(sizeof(FrameUniforms::DirLight) == 64, "DirLight must match the std140 struct");
+static_assert(sizeof(FrameUniforms::Lights) == 96, "Lights must match the std140 block");
@@ -0,0 +1,95 @@
+#include "Frustum.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_SSE 1
+#endif
+
+Frustum::Frustum()
+{
+    for (glm::vec4& plane : planes) plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+    // Gribb and Hartmann: each plane is the last row of the matrix plus or minus another row
+    glm::mat4 m = glm::transpose(viewProjection);
+    planes[0] = m[3] + m[0];   // Left
+    planes[1] = m[3] - m[0];   // Right
+    planes[2] = m[3] + m[1];   // Bottom
+    planes[3] = m[3] - m[1];   // Top
+    planes[4] = m[3] + m[2];   // Near
+    planes[5] = m[3] - m[2];   // Far
+    for (glm::vec4& plane : planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+bool Frustum::intersects(const AABB& box) const
+{
+    glm::vec3 center = box.center();
+    glm::vec3 extent = box.size() * 0.5f;
+    for (const glm::vec4& plane : planes) {
+        glm::vec3 normal(plane);
+        if (glm::dot(normal, center) + plane.w < -glm::dot(glm::abs(normal), extent)) return false;
+    }
+    return true;
+}
+
+size_t Frustum::cullTransformedBox(const AABB& box, const glm::vec4* rows, size_t rowStride, size_t count, uint8_t* visible) const
+{
+    glm::vec3 center = box.center();
+    glm::vec3 extent = box.size() * 0.5f;
+    size_t visibleCount = 0;
+    size_t i = 0;
+#ifdef FRUSTUM_SSE
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+    const __m128 ex = _mm_set1_ps(extent.x), ey = _mm_set1_ps(extent.y), ez = _mm_set1_ps(extent.z);
+    for (; i + 4 <= count; i += 4) {
+        // World-space centre and extent of the box under four transforms, one per lane
+        __m128 worldCenter[3], worldExtent[3];
+        for (int r = 0; r < 3; ++r) {
+            __m128 x = _mm_loadu_ps(&rows[(i + 0) * rowStride + r][0]);
+            __m128 y = _mm_loadu_ps(&rows[(i + 1) * rowStride + r][0]);
+            __m128 z = _mm_loadu_ps(&rows[(i + 2) * rowStride + r][0]);
+            __m128 w = _mm_loadu_ps(&rows[(i + 3) * rowStride + r][0]);
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+            worldCenter[r] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, cx), _mm_mul_ps(y, cy)), _mm_add_ps(_mm_mul_ps(z, cz), w));
+            worldExtent[r] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, x), ex), _mm_mul_ps(_mm_andnot_ps(signMask, y), ey)),
+                                        _mm_mul_ps(_mm_andnot_ps(signMask, z), ez));
+        }
+
+        __m128 outside = _mm_setzero_ps();
+        for (const glm::vec4& plane : planes) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), worldCenter[0]),
+                                                    _mm_mul_ps(_mm_set1_ps(plane.y), worldCenter[1])),
+                                         _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), worldCenter[2]), _mm_set1_ps(plane.w)));
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::fabs(plane.x)), worldExtent[0]),
+                                                  _mm_mul_ps(_mm_set1_ps(std::fabs(plane.y)), worldExtent[1])),
+                                       _mm_mul_ps(_mm_set1_ps(std::fabs(plane.z)), worldExtent[2]));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_sub_ps(_mm_setzero_ps(), radius)));
+        }
+
+        int mask = _mm_movemask_ps(outside);
+        for (int j = 0; j < 4; ++j) {
+            visible[i + j] = (mask >> j) & 1 ? 0 : 1;
+            visibleCount += visible[i + j];
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        const glm::vec4* row = rows + i * rowStride;
+        AABB world;
+        for (int r = 0; r < 3; ++r) {
+            float c = glm::dot(glm::vec3(row[r]), center) + row[r].w;
+            float e = glm::dot(glm::abs(glm::vec3(row[r])), extent);
+            world.min[r] = c - e;
+            world.max[r] = c + e;
+        }
+        visible[i] = intersects(world) ? 1 : 0;
+        visibleCount += visible[i];
+    }
+    return visibleCount;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include "BVH.h"
+
+// View frustum for culling bounding boxes. The six planes are taken from a view-projection matrix;
+// a box is tested as centre and extent against each of them. Batches of transformed boxes are
+// tested four transforms at a time with SSE.
+class Frustum {
+public:
+    // Contains everything, so nothing is culled until a camera is set
+    Frustum();
+    explicit Frustum(const glm::mat4& viewProjection);
+
+    // Whether a world-space box is at least partly inside
+    bool intersects(const AABB& box) const;
+
+    // Tests a model-space box under count affine transforms, each given as its first three matrix
+    // rows (e.g. ModelInstance::modelRows) with consecutive transforms rowStride vec4s apart.
+    // Writes 1 (visible) or 0 (culled) to visible[i] and returns the number visible.
+    size_t cullTransformedBox(const AABB& box, const glm::vec4* rows, size_t rowStride, size_t count, uint8_t* visible) const;
+
+private:
+    glm::vec4 planes[6];   // Inward normal and offset: inside where dot(normal, p) + w >= 0
+};
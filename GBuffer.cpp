@@ -0,0 +1,200 @@
+#include "GBuffer.h"
+#include <iostream>
+#include <algorithm>
+
+GBuffer::GBuffer(int width, int height) : width(width), height(height)
+{
+    create();
+}
+
+GBuffer::~GBuffer()
+{
+    destroy();
+}
+
+void GBuffer::resize(int newWidth, int newHeight)
+{
+    if (newWidth == width && newHeight == height) return;
+    if (newWidth <= 0 || newHeight <= 0) return; // Minimized window
+
+    destroy();
+    width = newWidth;
+    height = newHeight;
+    create();
+}
+
+void GBuffer::create()
+{
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+    // Octahedral normal (2 channels is enough for a unit vector)
+    glGenTextures(1, &normalTexture);
+    glBindTexture(GL_TEXTURE_2D, normalTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, width, height, 0, GL_RG, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, normalTexture, 0);
+
+    // Material ID (0 = plain diffuse surface, never traced)
+    glGenTextures(1, &materialTexture);
+    glBindTexture(GL_TEXTURE_2D, materialTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, width, height, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, materialTexture, 0);
+
+    // Depth is a texture so world positions can be reconstructed from it
+    glGenTextures(1, &depthTexture);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+
+    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, attachments);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::GBUFFER:: Framebuffer is not complete (" << width << "x" << height << ")" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Readback buffers sized for one full frame of each attachment, once per frame in flight
+    size_t pixelCount = static_cast<size_t>(width) * height;
+    for (ReadbackSlot& slot : slots) {
+        glGenBuffers(1, &slot.normalPBO);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.normalPBO);
+        glBufferData(GL_PIXEL_PACK_BUFFER, pixelCount * sizeof(glm::vec2), nullptr, GL_STREAM_READ);
+
+        glGenBuffers(1, &slot.materialPBO);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.materialPBO);
+        glBufferData(GL_PIXEL_PACK_BUFFER, pixelCount * sizeof(unsigned char), nullptr, GL_STREAM_READ);
+
+        glGenBuffers(1, &slot.depthPBO);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.depthPBO);
+        glBufferData(GL_PIXEL_PACK_BUFFER, pixelCount * sizeof(float), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // Copies queued at the old size are gone
+    nextSlot = 0;
+    queuedReadbacks = 0;
+}
+
+void GBuffer::destroy()
+{
+    if (mappedSlot >= 0) unmapReadback();
+
+    glDeleteFramebuffers(1, &FBO);
+    glDeleteTextures(1, &normalTexture);
+    glDeleteTextures(1, &materialTexture);
+    glDeleteTextures(1, &depthTexture);
+    for (ReadbackSlot& slot : slots) {
+        glDeleteBuffers(1, &slot.normalPBO);
+        glDeleteBuffers(1, &slot.materialPBO);
+        glDeleteBuffers(1, &slot.depthPBO);
+    }
+}
+
+void GBuffer::bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glViewport(0, 0, width, height);
+
+    const float clearNormal[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const unsigned int clearMaterial[4] = { 0, 0, 0, 0 };
+    glClearBufferfv(GL_COLOR, 0, clearNormal);
+    glClearBufferuiv(GL_COLOR, 1, clearMaterial);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void GBuffer::unbind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+int GBuffer::readback(int x, int y, int regionWidth, int regionHeight)
+{
+    int slotIndex = nextSlot;
+    nextSlot = (nextSlot + 1) % READBACK_FRAMES;
+    queuedReadbacks = std::min(queuedReadbacks + 1, READBACK_FRAMES);
+
+    // Clamp to the attachments; anything left empty queues no copy at all
+    ReadbackSlot& slot = slots[slotIndex];
+    slot.x = std::max(0, x);
+    slot.y = std::max(0, y);
+    slot.width = std::max(0, std::min(width, x + regionWidth) - slot.x);
+    slot.height = std::max(0, std::min(height, y + regionHeight) - slot.y);
+    if (slot.width == 0 || slot.height == 0) {
+        slot.width = slot.height = 0;
+        return slotIndex;
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.normalPBO);
+    glReadPixels(slot.x, slot.y, slot.width, slot.height, GL_RG, GL_FLOAT, nullptr);
+
+    glReadBuffer(GL_COLOR_ATTACHMENT1);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.materialPBO);
+    glReadPixels(slot.x, slot.y, slot.width, slot.height, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.depthPBO);
+    glReadPixels(slot.x, slot.y, slot.width, slot.height, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    return slotIndex;
+}
+
+bool GBuffer::mapReadback(Readback& result)
+{
+    if (queuedReadbacks < 2) return false;
+
+    // nextSlot - 1 was queued this frame, nextSlot - 2 the frame before
+    int slotIndex = (nextSlot + 2 * READBACK_FRAMES - 2) % READBACK_FRAMES;
+    const ReadbackSlot& slot = slots[slotIndex];
+    result = Readback();
+    result.x = slot.x;
+    result.y = slot.y;
+    result.width = slot.width;
+    result.height = slot.height;
+    result.slot = slotIndex;
+    if (slot.width == 0 || slot.height == 0) return true;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.normalPBO);
+    result.normals = static_cast<const glm::vec2*>(glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.materialPBO);
+    result.materialIds = static_cast<const unsigned char*>(glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.depthPBO);
+    result.depths = static_cast<const float*>(glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    mappedSlot = slotIndex;
+    if (!result.normals || !result.materialIds || !result.depths) {
+        std::cout << "ERROR::GBUFFER:: Failed to map readback buffers" << std::endl;
+        unmapReadback();
+        return false;
+    }
+    return true;
+}
+
+void GBuffer::unmapReadback()
+{
+    if (mappedSlot < 0) return;
+
+    const ReadbackSlot& slot = slots[mappedSlot];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.normalPBO);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.materialPBO);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.depthPBO);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    mappedSlot = -1;
+}
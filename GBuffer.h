@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Off-screen geometry buffer: octahedral-encoded world normals, an 8-bit material ID and depth.
+// The contents can be copied back to the CPU through pixel buffer objects so that worker threads
+// can trace secondary rays for selected pixels only.
+class GBuffer {
+public:
+    GBuffer(int width, int height);
+    ~GBuffer();
+
+    GBuffer(const GBuffer&) = delete;
+    GBuffer& operator=(const GBuffer&) = delete;
+
+    // Recreate the attachments when the framebuffer size changes
+    void resize(int width, int height);
+
+    // Bind for writing and clear all attachments
+    void bind();
+    void unbind();
+
+    // Number of frames the readback buffers rotate through
+    static const int READBACK_FRAMES = 2;
+
+    // One queued copy of a rectangle of every attachment, tightly packed row by row
+    struct Readback {
+        const glm::vec2* normals = nullptr;
+        const unsigned char* materialIds = nullptr;
+        const float* depths = nullptr;
+        int x = 0, y = 0, width = 0, height = 0;
+        int slot = 0;
+    };
+
+    // Queue asynchronous copies of a rectangle of every attachment into the next readback slot and
+    // return that slot. An empty rectangle still advances the ring so the frames stay in step.
+    int readback(int x, int y, int regionWidth, int regionHeight);
+
+    // Map the copy queued one frame before the latest readback(), which the GPU has normally
+    // finished by now, so mapping does not wait on the frame still being rendered. Returns false
+    // when no such copy exists yet (first frame, after a resize) or mapping fails.
+    bool mapReadback(Readback& result);
+    void unmapReadback();
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    unsigned int getNormalTexture() const { return normalTexture; }
+    unsigned int getMaterialTexture() const { return materialTexture; }
+    unsigned int getDepthTexture() const { return depthTexture; }
+
+private:
+    int width, height;
+    unsigned int FBO = 0;
+    unsigned int normalTexture = 0, materialTexture = 0, depthTexture = 0;
+
+    // Readback buffers of one frame and the rectangle copied into them
+    struct ReadbackSlot {
+        unsigned int normalPBO = 0, materialPBO = 0, depthPBO = 0;
+        int x = 0, y = 0, width = 0, height = 0;
+    };
+    ReadbackSlot slots[READBACK_FRAMES];
+    int nextSlot = 0;
+    int queuedReadbacks = 0;
+    int mappedSlot = -1;
+
+    void create();
+    void destroy();
+};
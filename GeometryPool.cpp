@@ -0,0 +1,195 @@
+#include "GeometryPool.h"
+#include "Mesh.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+    // Initial sizes in elements; arenas double when full
+    const size_t INITIAL_VERTICES = 1 << 18;
+    const size_t INITIAL_INDICES = 1 << 20;
+}
+
+GeometryPool::GeometryPool()
+{
+    vertexArena.elementSize = sizeof(PackedVertex);
+    shortIndexArena.elementSize = sizeof(uint16_t);
+    indexArena.elementSize = sizeof(unsigned int);
+}
+
+GeometryPool::Range GeometryPool::allocate(const PackedVertex* vertices, size_t vertexCount,
+                                           const unsigned int* indices, size_t indexCount)
+{
+    Range range = reserve(vertexCount, indexCount);
+    uploadVertices(range, 0, vertices, vertexCount);
+    uploadIndices(range, 0, indices, indexCount);
+    return range;
+}
+
+GeometryPool::Range GeometryPool::reserve(size_t vertexCount, size_t indexCount)
+{
+    Range range;
+    range.vertexCount = static_cast<uint32_t>(vertexCount);
+    range.indexCount = static_cast<uint32_t>(indexCount);
+    range.shortIndices = vertexCount <= 65536;
+
+    range.firstVertex = static_cast<uint32_t>(allocateIn(vertexArena, vertexCount));
+    range.firstIndex = static_cast<uint32_t>(allocateIn(range.shortIndices ? shortIndexArena : indexArena, indexCount));
+    rangeCount++;
+    return range;
+}
+
+void GeometryPool::uploadVertices(const Range& range, size_t first, const PackedVertex* vertices, size_t count)
+{
+    if (count == 0) return;
+
+    // The copy-write target leaves the element array binding of whatever VAO is bound alone
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexArena.buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (range.firstVertex + first) * vertexArena.elementSize,
+                    count * vertexArena.elementSize, vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GeometryPool::uploadIndices(const Range& range, size_t first, const unsigned int* indices, size_t count)
+{
+    if (count == 0) return;
+
+    if (range.shortIndices) {
+        std::vector<uint16_t> shortIndices(indices, indices + count);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, shortIndexArena.buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (range.firstIndex + first) * sizeof(uint16_t),
+                        count * sizeof(uint16_t), shortIndices.data());
+    } else {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, indexArena.buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (range.firstIndex + first) * sizeof(unsigned int),
+                        count * sizeof(unsigned int), indices);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GeometryPool::release(const Range& range)
+{
+    releaseIn(vertexArena, range.firstVertex, range.vertexCount);
+    releaseIn(range.shortIndices ? shortIndexArena : indexArena, range.firstIndex, range.indexCount);
+    rangeCount--;
+}
+
+void GeometryPool::bind(bool shortIndices)
+{
+    if (!shortIndexVAO) setupVertexArrays();
+    glBindVertexArray(shortIndices ? shortIndexVAO : indexVAO);
+}
+
+GeometryPool::Stats GeometryPool::getStats() const
+{
+    Stats stats;
+    for (const Arena* arena : { &vertexArena, &shortIndexArena, &indexArena }) {
+        stats.usedBytes += arena->used * arena->elementSize;
+        stats.capacityBytes += arena->capacity * arena->elementSize;
+    }
+    stats.ranges = rangeCount;
+    return stats;
+}
+
+GeometryPool& GeometryPool::shared()
+{
+    static GeometryPool pool;
+    return pool;
+}
+
+size_t GeometryPool::allocateIn(Arena& arena, size_t count)
+{
+    if (count == 0) return 0;
+
+    for (auto free = arena.freeRanges.begin(); free != arena.freeRanges.end(); ++free) {
+        if (free->second < count) continue;
+
+        size_t offset = free->first, length = free->second;
+        arena.freeRanges.erase(free);
+        if (length > count) arena.freeRanges[offset + count] = length - count;
+        arena.used += count;
+        return offset;
+    }
+
+    size_t initial = &arena == &vertexArena ? INITIAL_VERTICES : INITIAL_INDICES;
+    grow(arena, std::max(arena.capacity * 2, std::max(initial, arena.capacity + count)));
+    return allocateIn(arena, count);
+}
+
+void GeometryPool::releaseIn(Arena& arena, size_t offset, size_t count)
+{
+    if (count == 0) return;
+    arena.used -= count;
+
+    // Merge with the neighbouring free ranges
+    auto next = arena.freeRanges.lower_bound(offset);
+    if (next != arena.freeRanges.end() && offset + count == next->first) {
+        count += next->second;
+        next = arena.freeRanges.erase(next);
+    }
+    if (next != arena.freeRanges.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            previous->second += count;
+            return;
+        }
+    }
+    arena.freeRanges[offset] = count;
+}
+
+void GeometryPool::grow(Arena& arena, size_t minimumCapacity)
+{
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, minimumCapacity * arena.elementSize, nullptr, GL_STATIC_DRAW);
+
+    if (arena.buffer) {
+        glBindBuffer(GL_COPY_READ_BUFFER, arena.buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, arena.capacity * arena.elementSize);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glDeleteBuffers(1, &arena.buffer);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    // The new tail is free; it may extend a free range at the old end
+    size_t oldCapacity = arena.capacity;
+    arena.buffer = buffer;
+    arena.capacity = minimumCapacity;
+    arena.used += minimumCapacity - oldCapacity;
+    releaseIn(arena, oldCapacity, minimumCapacity - oldCapacity);
+
+    // The vertex arrays still reference the old buffer
+    setupVertexArrays();
+}
+
+void GeometryPool::setupVertexArrays()
+{
+    if (!shortIndexVAO) {
+        glGenVertexArrays(1, &shortIndexVAO);
+        glGenVertexArrays(1, &indexVAO);
+    }
+
+    for (GLuint vao : { shortIndexVAO, indexVAO }) {
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexArena.buffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vao == shortIndexVAO ? shortIndexArena.buffer : indexArena.buffer);
+
+        // Vertex positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+
+        // Vertex normals (octahedral)
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+
+        // Vertex texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords));
+
+        // Tangent frame quaternion; the bitangent is derived from it in the shader
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_BYTE, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, tangentFrame));
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
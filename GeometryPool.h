@@ -0,0 +1,74 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <map>
+#include <cstddef>
+#include <cstdint>
+
+struct PackedVertex;
+
+// Process-wide vertex and index buffers shared by every model mesh. Each mesh owns a range of
+// one PackedVertex buffer and of a 16- or 32-bit index buffer; its indices stay relative to its
+// first vertex and are drawn with a base vertex. All meshes therefore share two vertex array
+// objects, and a model is submitted with one glMultiDrawElementsBaseVertex per material instead
+// of a VAO bind and draw call per mesh. Must be used on the GL thread.
+class GeometryPool {
+public:
+    GeometryPool();
+
+    struct Range {
+        uint32_t firstVertex = 0;
+        uint32_t vertexCount = 0;
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        bool shortIndices = false;   // Indices are 16-bit (the mesh has at most 65536 vertices)
+    };
+
+    // Copies the mesh into the pool, growing the buffers if needed
+    Range allocate(const PackedVertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+
+    // Reserves a range without filling it, for meshes uploaded piecewise (see Mesh::refine)
+    Range reserve(size_t vertexCount, size_t indexCount);
+
+    // Fill part of a range; first is relative to the range's start
+    void uploadVertices(const Range& range, size_t first, const PackedVertex* vertices, size_t count);
+    void uploadIndices(const Range& range, size_t first, const unsigned int* indices, size_t count);
+
+    // Returns the range to the pool; its contents may be overwritten by later allocations
+    void release(const Range& range);
+
+    // Binds the vertex array that draws ranges with 16-bit or 32-bit indices
+    void bind(bool shortIndices);
+
+    struct Stats {
+        size_t usedBytes = 0;
+        size_t capacityBytes = 0;
+        size_t ranges = 0;
+    };
+    Stats getStats() const;
+
+    static GeometryPool& shared();
+
+private:
+    // One GL buffer handed out in element-sized ranges, first fit from a free list
+    struct Arena {
+        size_t elementSize = 0;
+        GLuint buffer = 0;
+        size_t capacity = 0;                 // In elements
+        size_t used = 0;
+        std::map<size_t, size_t> freeRanges; // Offset -> length, both in elements, never adjacent
+    };
+
+    Arena vertexArena;
+    Arena shortIndexArena;
+    Arena indexArena;
+    GLuint shortIndexVAO = 0, indexVAO = 0;
+    size_t rangeCount = 0;
+
+    // Returns the offset of count free elements, growing the buffer (and thus recreating the
+    // vertex arrays) when no free range is large enough
+    size_t allocateIn(Arena& arena, size_t count);
+    void releaseIn(Arena& arena, size_t offset, size_t count);
+    void grow(Arena& arena, size_t minimumCapacity);
+    void setupVertexArrays();
+};
@@ -0,0 +1,455 @@
+#include "GlbLoader.h"
+#include "Json.h"
+#include "Model.h"
+#include <iostream>
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <map>
+#include <algorithm>
+
+namespace {
+    const uint32_t GLB_MAGIC = 0x46546C67;    // "glTF"
+    const uint32_t CHUNK_JSON = 0x4E4F534A;   // "JSON"
+    const uint32_t CHUNK_BIN = 0x004E4942;    // "BIN\0"
+    const int MAX_NODE_DEPTH = 256;
+
+    enum ComponentType {
+        BYTE = 5120, UNSIGNED_BYTE = 5121, SHORT = 5122, UNSIGNED_SHORT = 5123, UNSIGNED_INT = 5125, FLOAT = 5126
+    };
+
+    uint32_t readU32(const unsigned char* bytes)
+    {
+        uint32_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    size_t componentSize(int componentType)
+    {
+        switch (componentType) {
+        case BYTE: case UNSIGNED_BYTE: return 1;
+        case SHORT: case UNSIGNED_SHORT: return 2;
+        case UNSIGNED_INT: case FLOAT: return 4;
+        default: return 0;
+        }
+    }
+
+    int componentCount(const std::string& type)
+    {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        return 0;
+    }
+
+    // Non-negative integer stored as a JSON number, or fallback if absent
+    bool readSize(const JsonValue& value, uint64_t fallback, uint64_t& size)
+    {
+        if (value.isNull()) {
+            size = fallback;
+            return true;
+        }
+        double number = value.asNumber(-1.0);
+        if (!(number >= 0.0 && number < 9.0e15) || number != std::floor(number)) return false;
+        size = static_cast<uint64_t>(number);
+        return true;
+    }
+
+    // Elements of an accessor, read in place from the binary chunk
+    struct Accessor {
+        const unsigned char* data = nullptr;
+        size_t count = 0;
+        size_t stride = 0;
+        int componentType = 0;
+        int components = 0;
+        bool normalized = false;
+
+        // Component c of element i, as a float (normalized integers map to [0, 1] or [-1, 1])
+        float read(size_t i, int c) const
+        {
+            const unsigned char* p = data + i * stride + c * componentSize(componentType);
+            switch (componentType) {
+            case FLOAT: { float v; std::memcpy(&v, p, 4); return v; }
+            case UNSIGNED_BYTE: return normalized ? *p / 255.0f : *p;
+            case BYTE: { int8_t v; std::memcpy(&v, p, 1); return normalized ? std::max(v / 127.0f, -1.0f) : v; }
+            case UNSIGNED_SHORT: { uint16_t v; std::memcpy(&v, p, 2); return normalized ? v / 65535.0f : v; }
+            case SHORT: { int16_t v; std::memcpy(&v, p, 2); return normalized ? std::max(v / 32767.0f, -1.0f) : v; }
+            default: { uint32_t v; std::memcpy(&v, p, 4); return static_cast<float>(v); }
+            }
+        }
+
+        uint32_t readIndex(size_t i) const
+        {
+            const unsigned char* p = data + i * stride;
+            switch (componentType) {
+            case UNSIGNED_BYTE: return *p;
+            case UNSIGNED_SHORT: { uint16_t v; std::memcpy(&v, p, 2); return v; }
+            default: { uint32_t v; std::memcpy(&v, p, 4); return v; }
+            }
+        }
+    };
+
+    bool resolveAccessor(const JsonValue& gltf, int index, const unsigned char* binary, size_t binarySize,
+                         Accessor& accessor, std::string& problem)
+    {
+        const JsonValue& description = gltf["accessors"][static_cast<size_t>(index)];
+        if (!description.isObject()) {
+            problem = "missing accessor";
+            return false;
+        }
+        if (description.has("sparse")) {
+            problem = "sparse accessors";
+            return false;
+        }
+        const JsonValue& view = gltf["bufferViews"][static_cast<size_t>(description["bufferView"].asInt())];
+        if (!view.isObject()) {
+            problem = "accessors without a buffer view";
+            return false;
+        }
+        const JsonValue& buffer = gltf["buffers"][static_cast<size_t>(view["buffer"].asInt())];
+        if (view["buffer"].asInt() != 0 || buffer.has("uri") || !binary) {
+            problem = "buffers outside the GLB binary chunk";
+            return false;
+        }
+
+        accessor.componentType = description["componentType"].asInt();
+        accessor.components = componentCount(description["type"].asString());
+        accessor.normalized = description["normalized"].asBool();
+        size_t elementSize = componentSize(accessor.componentType) * accessor.components;
+
+        uint64_t viewOffset, viewLength, stride, offset, count;
+        if (!readSize(view["byteOffset"], 0, viewOffset) || !readSize(view["byteLength"], UINT64_MAX, viewLength) ||
+            !readSize(view["byteStride"], elementSize, stride) || !readSize(description["byteOffset"], 0, offset) ||
+            !readSize(description["count"], UINT64_MAX, count) || elementSize == 0 || stride < elementSize) {
+            problem = "malformed accessor";
+            return false;
+        }
+        if (viewLength > binarySize || viewOffset > binarySize - viewLength ||
+            (count > 0 && (offset > viewLength || (count - 1) > (viewLength - offset - std::min<uint64_t>(elementSize, viewLength - offset)) / stride ||
+                           offset + (count - 1) * stride + elementSize > viewLength))) {
+            problem = "accessor outside its buffer view";
+            return false;
+        }
+
+        accessor.data = binary + viewOffset + offset;
+        accessor.count = static_cast<size_t>(count);
+        accessor.stride = static_cast<size_t>(stride);
+        return true;
+    }
+
+    // Decodes %XX escapes of a relative URI into a file name
+    std::string decodeUri(const std::string& uri)
+    {
+        std::string decoded;
+        for (size_t i = 0; i < uri.size(); ++i) {
+            if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(static_cast<unsigned char>(uri[i + 1])) &&
+                std::isxdigit(static_cast<unsigned char>(uri[i + 2]))) {
+                decoded += static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+                i += 2;
+            } else {
+                decoded += uri[i];
+            }
+        }
+        return decoded;
+    }
+
+    // Area-weighted vertex normals, as aiProcess_GenSmoothNormals gives meshes without normals
+    void generateNormals(std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+    {
+        for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+            Vertex& a = vertices[indices[t]];
+            Vertex& b = vertices[indices[t + 1]];
+            Vertex& c = vertices[indices[t + 2]];
+            glm::vec3 normal = glm::cross(b.Position - a.Position, c.Position - a.Position);
+            a.Normal += normal;
+            b.Normal += normal;
+            c.Normal += normal;
+        }
+        for (Vertex& vertex : vertices) {
+            float length = glm::length(vertex.Normal);
+            if (length > 0.0f) vertex.Normal /= length;
+        }
+    }
+
+    // Per-vertex tangent frames from the UV gradients, orthogonalized against the normals like
+    // aiProcess_CalcTangentSpace
+    void generateTangents(std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+    {
+        for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+            Vertex& a = vertices[indices[t]];
+            Vertex& b = vertices[indices[t + 1]];
+            Vertex& c = vertices[indices[t + 2]];
+            glm::vec3 edge1 = b.Position - a.Position, edge2 = c.Position - a.Position;
+            glm::vec2 uv1 = b.TexCoords - a.TexCoords, uv2 = c.TexCoords - a.TexCoords;
+            float determinant = uv1.x * uv2.y - uv2.x * uv1.y;
+            if (std::abs(determinant) < 1e-12f) continue;
+
+            float inverse = 1.0f / determinant;
+            glm::vec3 tangent = (edge1 * uv2.y - edge2 * uv1.y) * inverse;
+            glm::vec3 bitangent = (edge2 * uv1.x - edge1 * uv2.x) * inverse;
+            for (Vertex* vertex : { &a, &b, &c }) {
+                vertex->Tangent += tangent;
+                vertex->Bitangent += bitangent;
+            }
+        }
+        for (Vertex& vertex : vertices) {
+            for (glm::vec3* axis : { &vertex.Tangent, &vertex.Bitangent }) {
+                *axis -= vertex.Normal * glm::dot(*axis, vertex.Normal);
+                float length = glm::length(*axis);
+                if (length > 0.0f) *axis /= length;
+            }
+        }
+    }
+}
+
+bool GlbLoader::load(const std::string& path, ModelData& data)
+{
+    view.reset();
+    images.clear();
+    binary = nullptr;
+    binarySize = 0;
+
+    if (!file.open(path) || file.size() < 20) return false;
+    view = file.mapAll();
+    if (!view) return false;
+
+    const unsigned char* bytes = view->data();
+    if (readU32(bytes) != GLB_MAGIC) {
+        view.reset();
+        return false;
+    }
+
+    auto reject = [&](const std::string& problem) {
+        std::cout << "Model " << path << ": " << problem << " not supported by the GLB loader, importing with Assimp" << std::endl;
+        view.reset();
+        images.clear();
+        return false;
+    };
+
+    // 12-byte header, then the JSON chunk and an optional binary chunk, each with an 8-byte header
+    uint64_t length = readU32(bytes + 8);
+    uint64_t jsonLength = readU32(bytes + 12);
+    if (readU32(bytes + 4) != 2) return reject("glTF version other than 2");
+    if (length > view->size() || readU32(bytes + 16) != CHUNK_JSON || 20 + jsonLength > length) {
+        return reject("corrupt GLB header");
+    }
+    uint64_t binaryChunk = 20 + ((jsonLength + 3) & ~uint64_t(3));
+    if (binaryChunk + 8 <= length && readU32(bytes + binaryChunk + 4) == CHUNK_BIN) {
+        uint64_t chunkLength = readU32(bytes + binaryChunk);
+        if (binaryChunk + 8 + chunkLength > length) return reject("corrupt GLB binary chunk");
+        binary = bytes + binaryChunk + 8;
+        binarySize = static_cast<size_t>(chunkLength);
+    }
+
+    JsonValue gltf;
+    std::string error;
+    if (!JsonValue::parse(reinterpret_cast<const char*>(bytes + 20), static_cast<size_t>(jsonLength), gltf, error)) {
+        return reject("malformed JSON (" + error + ")");
+    }
+    const JsonValue& required = gltf["extensionsRequired"];
+    if (required.size() > 0) return reject("required extension " + required[static_cast<size_t>(0)].asString());
+
+    // Material paths of the images: "*N" for the N-th embedded one (as Assimp names them), the
+    // decoded URI for files next to the model
+    std::vector<std::string> imagePaths;
+    for (size_t i = 0; i < gltf["images"].size(); ++i) {
+        const JsonValue& image = gltf["images"][i];
+        if (image.has("bufferView")) {
+            const JsonValue& view = gltf["bufferViews"][static_cast<size_t>(image["bufferView"].asInt())];
+            uint64_t offset, size;
+            if (view["buffer"].asInt() != 0 || !binary || !readSize(view["byteOffset"], 0, offset) ||
+                !readSize(view["byteLength"], UINT64_MAX, size) || size > binarySize || offset > binarySize - size) {
+                return reject("image outside the GLB binary chunk");
+            }
+            MeshCache::EmbeddedImage embedded;
+            embedded.path = "*" + std::to_string(images.size());
+            embedded.data = binary + offset;
+            embedded.size = static_cast<size_t>(size);
+            embedded.width = static_cast<uint32_t>(size);   // Encoded file: height 0, like Assimp's aiTexture
+            embedded.height = 0;
+            images.push_back(embedded);
+            imagePaths.push_back(embedded.path);
+        } else {
+            const std::string& uri = image["uri"].asString();
+            if (uri.empty() || uri.compare(0, 5, "data:") == 0) return reject("data URI images");
+            imagePaths.push_back(decodeUri(uri));
+        }
+    }
+
+    // Root nodes of the default scene, or every node no other node lists as a child
+    std::vector<int> roots;
+    const JsonValue& nodes = gltf["nodes"];
+    const JsonValue& scene = gltf["scenes"][static_cast<size_t>(gltf["scene"].asInt(0))];
+    if (scene.isObject()) {
+        for (size_t i = 0; i < scene["nodes"].size(); ++i) roots.push_back(scene["nodes"][i].asInt());
+    } else {
+        std::vector<bool> isChild(nodes.size(), false);
+        for (size_t n = 0; n < nodes.size(); ++n) {
+            for (size_t c = 0; c < nodes[n]["children"].size(); ++c) {
+                int child = nodes[n]["children"][c].asInt();
+                if (child >= 0 && static_cast<size_t>(child) < nodes.size()) isChild[child] = true;
+            }
+        }
+        for (size_t n = 0; n < nodes.size(); ++n) {
+            if (!isChild[n]) roots.push_back(static_cast<int>(n));
+        }
+    }
+
+    // Depth-first like Model::processNode walks Assimp's node tree; a mesh placed by several
+    // nodes is converted once and copied
+    ModelData result;
+    result.path = data.path;
+    result.directory = data.directory;
+    std::map<int, std::pair<size_t, size_t>> convertedMeshes;   // Mesh -> range of result.meshes
+    std::vector<std::pair<int, int>> stack;                       // (node, depth)
+    for (auto root = roots.rbegin(); root != roots.rend(); ++root) stack.push_back({ *root, 0 });
+    while (!stack.empty()) {
+        std::pair<int, int> entry = stack.back();
+        stack.pop_back();
+        const JsonValue& node = nodes[static_cast<size_t>(entry.first)];
+        if (!node.isObject()) return reject("missing node");
+        if (entry.second > MAX_NODE_DEPTH) return reject("node hierarchy this deep (or cyclic)");
+
+        int meshIndex = node["mesh"].asInt();
+        if (meshIndex >= 0) {
+            auto converted = convertedMeshes.find(meshIndex);
+            if (converted != convertedMeshes.end()) {
+                for (size_t m = converted->second.first; m < converted->second.second; ++m) {
+                    result.meshes.push_back(result.meshes[m]);
+                }
+            } else {
+                const JsonValue& primitives = gltf["meshes"][static_cast<size_t>(meshIndex)]["primitives"];
+                if (primitives.size() == 0) return reject("mesh without primitives");
+                size_t first = result.meshes.size();
+                for (size_t p = 0; p < primitives.size(); ++p) {
+                    std::string problem;
+                    if (!convertPrimitive(gltf, primitives[p], imagePaths, result, problem)) return reject(problem);
+                }
+                convertedMeshes[meshIndex] = { first, result.meshes.size() };
+            }
+        }
+
+        const JsonValue& children = node["children"];
+        for (size_t c = children.size(); c-- > 0;) stack.push_back({ children[c].asInt(), entry.second + 1 });
+    }
+    if (result.meshes.empty()) return reject("model without meshes");
+
+    data.meshes = std::move(result.meshes);
+    data.boundingBoxMin = result.boundingBoxMin;
+    data.boundingBoxMax = result.boundingBoxMax;
+    return true;
+}
+
+bool GlbLoader::convertPrimitive(const JsonValue& gltf, const JsonValue& primitive, const std::vector<std::string>& imagePaths,
+                                 ModelData& data, std::string& problem) const
+{
+    if (primitive["mode"].asInt(4) != 4) {
+        problem = "non-triangle primitives";
+        return false;
+    }
+
+    const JsonValue& attributes = primitive["attributes"];
+    Accessor positions, normals, texCoords, tangents, indexAccessor;
+    if (!resolveAccessor(gltf, attributes["POSITION"].asInt(), binary, binarySize, positions, problem)) return false;
+    bool hasNormals = attributes.has("NORMAL");
+    bool hasTexCoords = attributes.has("TEXCOORD_0");
+    bool hasTangents = attributes.has("TANGENT");
+    bool hasIndices = primitive.has("indices");
+    if ((hasNormals && !resolveAccessor(gltf, attributes["NORMAL"].asInt(), binary, binarySize, normals, problem)) ||
+        (hasTexCoords && !resolveAccessor(gltf, attributes["TEXCOORD_0"].asInt(), binary, binarySize, texCoords, problem)) ||
+        (hasTangents && !resolveAccessor(gltf, attributes["TANGENT"].asInt(), binary, binarySize, tangents, problem)) ||
+        (hasIndices && !resolveAccessor(gltf, primitive["indices"].asInt(), binary, binarySize, indexAccessor, problem))) {
+        return false;
+    }
+
+    size_t vertexCount = positions.count;
+    if (positions.components != 3 || positions.componentType != FLOAT ||
+        (hasNormals && (normals.components != 3 || normals.componentType != FLOAT || normals.count != vertexCount)) ||
+        (hasTexCoords && (texCoords.components != 2 || texCoords.count != vertexCount ||
+                          (texCoords.componentType != FLOAT && !texCoords.normalized))) ||
+        (hasTangents && (tangents.components != 4 || tangents.componentType != FLOAT || tangents.count != vertexCount)) ||
+        (hasIndices && (indexAccessor.components != 1 || (indexAccessor.componentType != UNSIGNED_BYTE &&
+                        indexAccessor.componentType != UNSIGNED_SHORT && indexAccessor.componentType != UNSIGNED_INT)))) {
+        problem = "attribute formats like these";
+        return false;
+    }
+
+    data.meshes.emplace_back();
+    ModelData::MeshData& mesh = data.meshes.back();
+
+    // The single copy: accessor elements straight into the final vertices
+    mesh.vertices.resize(vertexCount, Vertex{});
+    for (size_t i = 0; i < vertexCount; ++i) {
+        Vertex& vertex = mesh.vertices[i];
+        vertex.Position = glm::vec3(positions.read(i, 0), positions.read(i, 1), positions.read(i, 2));
+        data.boundingBoxMin = glm::min(data.boundingBoxMin, vertex.Position);
+        data.boundingBoxMax = glm::max(data.boundingBoxMax, vertex.Position);
+
+        if (hasNormals) vertex.Normal = glm::vec3(normals.read(i, 0), normals.read(i, 1), normals.read(i, 2));
+        if (hasTexCoords) {
+            // Kept as stored: Assimp's glTF importer flips V and aiProcess_FlipUVs flips it back
+            vertex.TexCoords = glm::vec2(texCoords.read(i, 0), texCoords.read(i, 1));
+            // Tangents only matter with UVs; w holds the bitangent's handedness
+            if (hasTangents) {
+                vertex.Tangent = glm::vec3(tangents.read(i, 0), tangents.read(i, 1), tangents.read(i, 2));
+                vertex.Bitangent = glm::cross(vertex.Normal, vertex.Tangent) * (tangents.read(i, 3) < 0.0f ? -1.0f : 1.0f);
+            }
+        }
+    }
+
+    size_t indexCount = hasIndices ? indexAccessor.count : vertexCount;
+    if (indexCount % 3 != 0) {
+        data.meshes.pop_back();
+        problem = "triangle lists with a partial triangle";
+        return false;
+    }
+    mesh.indices.resize(indexCount);
+    for (size_t i = 0; i < indexCount; ++i) {
+        uint32_t index = hasIndices ? indexAccessor.readIndex(i) : static_cast<uint32_t>(i);
+        if (index >= vertexCount) {
+            data.meshes.pop_back();
+            problem = "out-of-range indices";
+            return false;
+        }
+        mesh.indices[i] = index;
+    }
+
+    if (!hasNormals) generateNormals(mesh.vertices, mesh.indices);
+    if (hasTexCoords && !hasTangents) generateTangents(mesh.vertices, mesh.indices);
+
+    // Same bindings, in the same order, as Model::processMesh reads from an Assimp glTF material
+    const JsonValue& material = gltf["materials"][static_cast<size_t>(primitive["material"].asInt())];
+    const JsonValue& pbr = material["pbrMetallicRoughness"];
+    std::pair<const char*, const JsonValue*> slots[] = {
+        { "texture_diffuse", &pbr["baseColorTexture"] },
+        { "texture_normal", &material["normalTexture"] },
+        { "texture_metallicRoughness", &pbr["metallicRoughnessTexture"] },
+        { "texture_occlusion", &material["occlusionTexture"] },
+        { "texture_emissive", &material["emissiveTexture"] },
+    };
+    for (const auto& slot : slots) {
+        if (!slot.second->isObject()) continue;
+        const JsonValue& texture = gltf["textures"][static_cast<size_t>((*slot.second)["index"].asInt())];
+        int source = texture["source"].asInt();
+        if (source < 0 || static_cast<size_t>(source) >= imagePaths.size()) {
+            data.meshes.pop_back();
+            problem = "textures without a PNG/JPEG source";
+            return false;
+        }
+        mesh.textures.push_back({ slot.first, imagePaths[source] });
+    }
+    return true;
+}
+
+bool GlbLoader::findEmbeddedImage(const std::string& path, MeshCache::EmbeddedImage& image) const
+{
+    for (const MeshCache::EmbeddedImage& embedded : images) {
+        if (embedded.path == path) {
+            image = embedded;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include "MappedFile.h"
+#include "MeshCache.h"
+
+struct ModelData;
+class JsonValue;
+
+// Reads binary glTF (.glb) models without Assimp. The file is mapped, its JSON chunk parsed, and
+// every primitive's accessors are read in place from the binary chunk and converted in one pass
+// into the final Vertex arrays, with no intermediate scene. The result matches Model's Assimp
+// import: one mesh per primitive in node order (node transforms are not applied), missing normals
+// and tangents generated, and the same texture bindings, with embedded images named "*N".
+// Covers triangle primitives, float or normalized integer attributes, embedded and external
+// images; anything else (external or data URI buffers, sparse accessors, strips, Draco, ...)
+// makes load() fail so the caller can fall back to Assimp.
+class GlbLoader {
+public:
+    // Fills data.meshes and the bounding box. Returns false, leaving data unchanged, if the file
+    // is not a GLB or uses something the loader does not cover (reported unless it is not a GLB).
+    bool load(const std::string& path, ModelData& data);
+
+    // Image embedded in the binary chunk under the path the materials use ("*N"); its data points
+    // into the mapping, which stays open for the life of the loader
+    bool findEmbeddedImage(const std::string& path, MeshCache::EmbeddedImage& image) const;
+
+private:
+    MappedFile file;
+    std::unique_ptr<MappedView> view;
+    std::vector<MeshCache::EmbeddedImage> images;
+    const unsigned char* binary = nullptr;
+    size_t binarySize = 0;
+
+    // Converts one primitive; false (with the reason) if it is not supported
+    bool convertPrimitive(const JsonValue& gltf, const JsonValue& primitive, const std::vector<std::string>& imagePaths,
+                          ModelData& data, std::string& problem) const;
+};
@@ -0,0 +1,306 @@
+#include "HybridRenderer.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <chrono>
+#include <iostream>
+
+namespace {
+    // Inverse of the octahedral encoding written by gbuffer.frag
+    glm::vec3 decodeOctahedral(const glm::vec2& e)
+    {
+        glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+        float t = glm::clamp(-n.z, 0.0f, 1.0f);
+        n.x += n.x >= 0.0f ? -t : t;
+        n.y += n.y >= 0.0f ? -t : t;
+        return glm::normalize(n);
+    }
+
+    // Grows rect (minX, minY, maxX, maxY in pixels) by the screen footprint of a world box.
+    // Returns false when the box reaches behind the camera and has no usable footprint.
+    bool growScreenRect(const AABB& box, const glm::mat4& viewProjection, int width, int height, glm::vec4& rect)
+    {
+        for (int corner = 0; corner < 8; ++corner) {
+            glm::vec3 point((corner & 1) ? box.max.x : box.min.x,
+                            (corner & 2) ? box.max.y : box.min.y,
+                            (corner & 4) ? box.max.z : box.min.z);
+            glm::vec4 clip = viewProjection * glm::vec4(point, 1.0f);
+            if (clip.w <= 1e-4f) return false;
+
+            glm::vec2 pixel = (glm::vec2(clip) / clip.w * 0.5f + 0.5f) * glm::vec2(width, height);
+            rect.x = std::min(rect.x, pixel.x);
+            rect.y = std::min(rect.y, pixel.y);
+            rect.z = std::max(rect.z, pixel.x);
+            rect.w = std::max(rect.w, pixel.y);
+        }
+        return true;
+    }
+
+    unsigned char toByte(float value)
+    {
+        return static_cast<unsigned char>(glm::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+}
+
+HybridRenderer::HybridRenderer(int width, int height)
+    : gbuffer(width, height),
+      gbufferShader("gbuffer.vert", "gbuffer.frag"),
+      compositeShader("composite.vert", "composite.frag")
+{
+    // The robot body is brushed metal
+    materials[ROBOT_MATERIAL_ID].reflectance = 0.4f;
+
+    glGenVertexArrays(1, &pointVAO);
+    glGenBuffers(1, &pointVBO);
+
+    glBindVertexArray(pointVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, pointVBO);
+
+    // Pixel coordinate (converted to float by the attribute fetch)
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(CompositePoint), (void*)0);
+
+    // Color + blend weight
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(CompositePoint), (void*)offsetof(CompositePoint, r));
+
+    glBindVertexArray(0);
+}
+
+HybridRenderer::~HybridRenderer()
+{
+    glDeleteVertexArrays(1, &pointVAO);
+    glDeleteBuffers(1, &pointVBO);
+}
+
+void HybridRenderer::resize(int width, int height)
+{
+    gbuffer.resize(width, height);
+}
+
+float HybridRenderer::getCoverage() const
+{
+    size_t pixelCount = static_cast<size_t>(gbuffer.getWidth()) * gbuffer.getHeight();
+    return pixelCount > 0 ? static_cast<float>(tracedPixels.size()) / pixelCount : 0.0f;
+}
+
+void HybridRenderer::syncMaterials(const MuseumObjectManager& objectManager)
+{
+    // Material IDs 1..254 map to museum objects, 0 is the diffuse room, 255 the robot
+    size_t count = std::min<size_t>(objectManager.getObjectCount(), ROBOT_MATERIAL_ID - 1);
+    for (size_t i = 0; i < count; ++i) {
+        const MuseumObject* obj = objectManager.getObject(i);
+        HybridMaterial& material = materials[i + 1];
+        material.reflectance = obj->reflectivity;
+        material.transparency = obj->transparency;
+        material.refractiveIndex = obj->refractiveIndex;
+    }
+}
+
+glm::ivec4 HybridRenderer::tracedScreenRect(const glm::mat4& viewProjection, const MuseumObjectManager& objectManager,
+                                            const MobileRobot& robot) const
+{
+    int width = gbuffer.getWidth();
+    int height = gbuffer.getHeight();
+    glm::ivec4 fullScreen(0, 0, width, height);
+    glm::vec4 rect(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    size_t count = std::min<size_t>(objectManager.getObjectCount(), ROBOT_MATERIAL_ID - 1);
+    for (size_t i = 0; i < count; ++i) {
+        const MuseumObject* obj = objectManager.getObject(i);
+        const HybridMaterial& material = materials[i + 1];
+        if (!obj->model || (material.reflectance <= 0.0f && material.transparency <= 0.0f)) continue;
+
+        AABB bounds{ obj->model->GetBoundingBoxMin(), obj->model->GetBoundingBoxMax() };
+        if (!growScreenRect(bounds.transformed(obj->getModelMatrix()), viewProjection, width, height, rect)) {
+            return fullScreen;
+        }
+    }
+
+    const HybridMaterial& robotMaterial = materials[ROBOT_MATERIAL_ID];
+    if (robotMaterial.reflectance > 0.0f || robotMaterial.transparency > 0.0f) {
+        if (!growScreenRect(robot.getBounds(), viewProjection, width, height, rect)) return fullScreen;
+    }
+
+    if (rect.x > rect.z || rect.y > rect.w) return glm::ivec4(0);
+
+    // Whole pixels touched by the footprint, clipped to the screen
+    int minX = std::max(0, static_cast<int>(std::floor(rect.x)));
+    int minY = std::max(0, static_cast<int>(std::floor(rect.y)));
+    int maxX = std::min(width, static_cast<int>(std::ceil(rect.z)));
+    int maxY = std::min(height, static_cast<int>(std::ceil(rect.w)));
+    if (minX >= maxX || minY >= maxY) return glm::ivec4(0);
+    return glm::ivec4(minX, minY, maxX - minX, maxY - minY);
+}
+
+void HybridRenderer::renderGBuffer(const glm::mat4& view, const glm::mat4& projection,
+                                   MuseumRoom& room, MuseumObjectManager& objectManager, MobileRobot& robot)
+{
+    syncMaterials(objectManager);
+    glm::mat4 viewProjection = projection * view;
+
+    GLint previousViewport[4];
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+    gbuffer.bind();
+    gbufferShader.use();   // Camera matrices come from the FrameUniforms block
+
+    // Room walls are plain diffuse
+    Mesh::setTransform(gbufferShader, glm::mat4(1.0f));
+    gbufferShader.setInt("materialId", 0);
+    room.render();
+
+    size_t count = std::min<size_t>(objectManager.getObjectCount(), ROBOT_MATERIAL_ID - 1);
+    for (size_t i = 0; i < count; ++i) {
+        MuseumObject* obj = objectManager.getObject(i);
+        if (!obj->model) continue;
+        Mesh::setTransform(gbufferShader, obj->getModelMatrix());
+        gbufferShader.setInt("materialId", static_cast<int>(i + 1));
+        obj->model->Draw(gbufferShader);
+    }
+
+    gbufferShader.setInt("materialId", ROBOT_MATERIAL_ID);
+    robot.render(gbufferShader);
+
+    glm::ivec4 rect = tracedScreenRect(viewProjection, objectManager, robot);
+    int slot = gbuffer.readback(rect.x, rect.y, rect.z, rect.w);
+    inverseViewProjections[slot] = glm::inverse(viewProjection);
+    gbuffer.unbind();
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+}
+
+void HybridRenderer::gatherTracedPixels()
+{
+    tracedPixels.clear();
+
+    GBuffer::Readback readback;
+    if (!gbuffer.mapReadback(readback)) return;   // Nothing queued a frame ago yet
+    if (readback.width == 0 || readback.height == 0) return;
+
+    // Flag which material IDs need secondary rays so the scan is a single table lookup per pixel
+    bool traced[256];
+    for (int i = 0; i < 256; ++i) {
+        traced[i] = i != 0 && (materials[i].reflectance > 0.0f || materials[i].transparency > 0.0f);
+    }
+
+    // Positions are reconstructed with the camera of the frame the copy was taken from
+    const glm::mat4& inverseViewProjection = inverseViewProjections[readback.slot];
+    int width = gbuffer.getWidth();
+    int height = gbuffer.getHeight();
+    for (int row = 0; row < readback.height; ++row) {
+        const unsigned char* materialRow = readback.materialIds + static_cast<size_t>(row) * readback.width;
+        int y = readback.y + row;
+        for (int column = 0; column < readback.width; ++column) {
+            if (!traced[materialRow[column]]) continue;
+
+            size_t index = static_cast<size_t>(row) * readback.width + column;
+            float depth = readback.depths[index];
+            if (depth >= 1.0f) continue;
+
+            // Reconstruct the world position from depth
+            int x = readback.x + column;
+            glm::vec4 ndc((x + 0.5f) / width * 2.0f - 1.0f,
+                          (y + 0.5f) / height * 2.0f - 1.0f,
+                          depth * 2.0f - 1.0f, 1.0f);
+            glm::vec4 world = inverseViewProjection * ndc;
+
+            TracedPixel pixel;
+            pixel.x = static_cast<unsigned short>(x);
+            pixel.y = static_cast<unsigned short>(y);
+            pixel.material = materialRow[column];
+            pixel.position = glm::vec3(world) / world.w;
+            pixel.normal = decodeOctahedral(readback.normals[index]);
+            tracedPixels.push_back(pixel);
+        }
+    }
+
+    gbuffer.unmapReadback();
+}
+
+void HybridRenderer::tracePixels(const RayTracer& rayTracer, const glm::vec3& cameraPosition)
+{
+    compositePoints.resize(tracedPixels.size());
+    int startDepth = std::max(0, rayTracer.getMaxDepth() - maxBounces);
+
+    ThreadPool::shared().parallelFor(tracedPixels.size(), 256, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const TracedPixel& pixel = tracedPixels[i];
+            const HybridMaterial& material = materials[pixel.material];
+            glm::vec3 viewDir = glm::normalize(pixel.position - cameraPosition);
+            glm::vec3 normal = pixel.normal;
+            if (glm::dot(viewDir, normal) > 0.0f) normal = -normal;
+
+            glm::vec3 color(0.0f);
+            float weight = 0.0f;
+
+            if (material.reflectance > 0.0f) {
+                Ray reflected(pixel.position + normal * 0.002f, glm::reflect(viewDir, normal));
+                color += rayTracer.traceRay(reflected, startDepth) * material.reflectance;
+                weight += material.reflectance;
+            }
+
+            if (material.transparency > 0.0f) {
+                glm::vec3 direction = glm::refract(viewDir, normal, 1.0f / material.refractiveIndex);
+                if (glm::dot(direction, direction) < 1e-6f) {
+                    direction = glm::reflect(viewDir, normal); // Total internal reflection
+                }
+                Ray refracted(pixel.position - normal * 0.002f, direction);
+                color += rayTracer.traceRay(refracted, startDepth) * material.transparency;
+                weight += material.transparency;
+            }
+
+            // Output the weighted average and use the total weight as blend alpha
+            if (weight > 0.0f) color /= weight;
+
+            CompositePoint& point = compositePoints[i];
+            point.x = pixel.x;
+            point.y = pixel.y;
+            point.r = toByte(color.r);
+            point.g = toByte(color.g);
+            point.b = toByte(color.b);
+            point.a = toByte(std::min(weight, 1.0f));
+        }
+    });
+}
+
+void HybridRenderer::compositePixels()
+{
+    if (compositePoints.empty()) return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, pointVBO);
+    size_t byteSize = compositePoints.size() * sizeof(CompositePoint);
+    if (compositePoints.size() > pointCapacity) {
+        pointCapacity = compositePoints.size() + compositePoints.size() / 2;
+        glBufferData(GL_ARRAY_BUFFER, pointCapacity * sizeof(CompositePoint), nullptr, GL_STREAM_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, byteSize, compositePoints.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    GLboolean depthTestWasEnabled = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    compositeShader.use();
+    compositeShader.setVec2("viewportSize", glm::vec2(gbuffer.getWidth(), gbuffer.getHeight()));
+    glBindVertexArray(pointVAO);
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(compositePoints.size()));
+    glBindVertexArray(0);
+
+    glDisable(GL_BLEND);
+    if (depthTestWasEnabled) glEnable(GL_DEPTH_TEST);
+}
+
+void HybridRenderer::traceAndComposite(const RayTracer& rayTracer, const glm::vec3& cameraPosition)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    gatherTracedPixels();
+    tracePixels(rayTracer, cameraPosition);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    lastTraceTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+
+    compositePixels();
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <vector>
+#include "GBuffer.h"
+#include "Shader.h"
+#include "RayTracer.h"
+#include "MuseumRoom.h"
+#include "MuseumObjectManager.h"
+#include "MobileRobot.h"
+
+// Per-material parameters looked up by the G-buffer material ID
+struct HybridMaterial {
+    float reflectance = 0.0f;
+    float transparency = 0.0f;
+    float refractiveIndex = 1.5f;
+};
+
+// Hybrid rasterization + ray tracing.
+// The scene is rasterized into a G-buffer, then only the pixels whose material is reflective
+// or transparent are gathered into a compact list. Secondary rays for those pixels are traced
+// by the RayTracer on the worker pool and blended back over the forward-rendered frame, so the
+// cost follows reflective screen coverage instead of resolution. Only the screen rectangle around
+// the traced objects is read back, and it is consumed one frame later so the copy never stalls
+// the GPU; the secondary rays therefore lag the raster by a frame.
+class HybridRenderer {
+public:
+    static const unsigned char ROBOT_MATERIAL_ID = 255;
+
+    HybridRenderer(int width, int height);
+    ~HybridRenderer();
+
+    void resize(int width, int height);
+
+    // Pass 1: rasterize depth, normals and material IDs and queue the readback of the traced
+    // objects' screen rectangle. The program reads the camera from the FrameUniforms block, which
+    // must hold the same view and projection.
+    void renderGBuffer(const glm::mat4& view, const glm::mat4& projection,
+                       MuseumRoom& room, MuseumObjectManager& objectManager, MobileRobot& robot);
+
+    // Pass 2: trace secondary rays for the reflective/transparent pixels of the previous frame's
+    // readback and blend them over the currently bound framebuffer
+    void traceAndComposite(const RayTracer& rayTracer, const glm::vec3& cameraPosition);
+
+    // Settings
+    void setRobotMaterial(const HybridMaterial& material) { materials[ROBOT_MATERIAL_ID] = material; }
+    void setMaxBounces(int bounces) { maxBounces = bounces; }
+    int getMaxBounces() const { return maxBounces; }
+
+    // G-buffer and composite programs, for hot reloading
+    std::vector<Shader*> getShaders() { return { &gbufferShader, &compositeShader }; }
+
+    // Statistics from the last traced frame
+    size_t getTracedPixelCount() const { return tracedPixels.size(); }
+    float getCoverage() const;
+    float getLastTraceTimeMs() const { return lastTraceTimeMs; }
+
+private:
+    // One entry of the compacted pixel list handed to the workers
+    struct TracedPixel {
+        unsigned short x, y;
+        unsigned char material;
+        glm::vec3 position;
+        glm::vec3 normal;
+    };
+
+    // Point uploaded for compositing: pixel coordinate + blended color
+    struct CompositePoint {
+        unsigned short x, y;
+        unsigned char r, g, b, a;
+    };
+
+    GBuffer gbuffer;
+    Shader gbufferShader;
+    Shader compositeShader;
+    std::array<HybridMaterial, 256> materials;
+
+    std::vector<TracedPixel> tracedPixels;
+    std::vector<CompositePoint> compositePoints;
+    std::array<glm::mat4, GBuffer::READBACK_FRAMES> inverseViewProjections;
+    int maxBounces = 3;
+    float lastTraceTimeMs = 0.0f;
+
+    unsigned int pointVAO = 0, pointVBO = 0;
+    size_t pointCapacity = 0;
+
+    void syncMaterials(const MuseumObjectManager& objectManager);
+    glm::ivec4 tracedScreenRect(const glm::mat4& viewProjection, const MuseumObjectManager& objectManager,
+                                const MobileRobot& robot) const;
+    void gatherTracedPixels();
+    void tracePixels(const RayTracer& rayTracer, const glm::vec3& cameraPosition);
+    void compositePixels();
+};
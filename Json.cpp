@@ -0,0 +1,287 @@
+#include "Json.h"
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+    // Deeper documents are rejected instead of exhausting the stack
+    const int MAX_DEPTH = 128;
+
+    const JsonValue& nullValue()
+    {
+        static const JsonValue value;
+        return value;
+    }
+
+    void appendUtf8(std::string& out, uint32_t codePoint)
+    {
+        if (codePoint < 0x80) {
+            out += static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            out += static_cast<char>(0xC0 | (codePoint >> 6));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else if (codePoint < 0x10000) {
+            out += static_cast<char>(0xE0 | (codePoint >> 12));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (codePoint >> 18));
+            out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+}
+
+// Recursive descent over the text; every parse function leaves position after what it read
+class JsonParser {
+public:
+    JsonParser(const char* text, size_t length) : text(text), end(text + length), position(text) {}
+
+    bool parseDocument(JsonValue& value, std::string& error)
+    {
+        skipWhitespace();
+        if (!parseValue(value, 0)) {
+            error = message;
+            return false;
+        }
+        skipWhitespace();
+        if (position != end) {
+            fail("unexpected data after the document");
+            error = message;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    const char* text;
+    const char* end;
+    const char* position;
+    std::string message;
+
+    bool fail(const char* what)
+    {
+        if (message.empty()) message = std::string(what) + " at offset " + std::to_string(position - text);
+        return false;
+    }
+
+    void skipWhitespace()
+    {
+        while (position < end && (*position == ' ' || *position == '\t' || *position == '\n' || *position == '\r')) ++position;
+    }
+
+    bool consume(const char* literal)
+    {
+        size_t length = std::strlen(literal);
+        if (static_cast<size_t>(end - position) < length || std::memcmp(position, literal, length) != 0) return false;
+        position += length;
+        return true;
+    }
+
+    bool parseValue(JsonValue& value, int depth)
+    {
+        if (depth > MAX_DEPTH) return fail("nesting too deep");
+        if (position == end) return fail("unexpected end of input");
+
+        switch (*position) {
+        case '{': return parseObject(value, depth);
+        case '[': return parseArray(value, depth);
+        case '"':
+            value.type = JsonValue::Type::STRING;
+            return parseString(value.text);
+        case 't':
+            if (!consume("true")) return fail("invalid literal");
+            value.type = JsonValue::Type::BOOLEAN;
+            value.boolean = true;
+            return true;
+        case 'f':
+            if (!consume("false")) return fail("invalid literal");
+            value.type = JsonValue::Type::BOOLEAN;
+            value.boolean = false;
+            return true;
+        case 'n':
+            if (!consume("null")) return fail("invalid literal");
+            value.type = JsonValue::Type::NUL;
+            return true;
+        default:
+            return parseNumber(value);
+        }
+    }
+
+    bool parseObject(JsonValue& value, int depth)
+    {
+        value.type = JsonValue::Type::OBJECT;
+        ++position;
+        skipWhitespace();
+        if (position < end && *position == '}') {
+            ++position;
+            return true;
+        }
+
+        while (true) {
+            skipWhitespace();
+            if (position == end || *position != '"') return fail("expected a member name");
+            value.members.emplace_back();
+            if (!parseString(value.members.back().first)) return false;
+
+            skipWhitespace();
+            if (position == end || *position != ':') return fail("expected ':'");
+            ++position;
+            skipWhitespace();
+            if (!parseValue(value.members.back().second, depth + 1)) return false;
+
+            skipWhitespace();
+            if (position == end) return fail("unterminated object");
+            if (*position == '}') {
+                ++position;
+                return true;
+            }
+            if (*position != ',') return fail("expected ',' or '}'");
+            ++position;
+        }
+    }
+
+    bool parseArray(JsonValue& value, int depth)
+    {
+        value.type = JsonValue::Type::ARRAY;
+        ++position;
+        skipWhitespace();
+        if (position < end && *position == ']') {
+            ++position;
+            return true;
+        }
+
+        while (true) {
+            skipWhitespace();
+            value.items.emplace_back();
+            if (!parseValue(value.items.back(), depth + 1)) return false;
+
+            skipWhitespace();
+            if (position == end) return fail("unterminated array");
+            if (*position == ']') {
+                ++position;
+                return true;
+            }
+            if (*position != ',') return fail("expected ',' or ']'");
+            ++position;
+        }
+    }
+
+    bool parseHex4(uint32_t& codeUnit)
+    {
+        if (end - position < 4) return fail("truncated \\u escape");
+        codeUnit = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = *position++;
+            codeUnit <<= 4;
+            if (c >= '0' && c <= '9') codeUnit |= c - '0';
+            else if (c >= 'a' && c <= 'f') codeUnit |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') codeUnit |= c - 'A' + 10;
+            else return fail("invalid \\u escape");
+        }
+        return true;
+    }
+
+    bool parseString(std::string& out)
+    {
+        ++position;   // Opening quote
+        while (true) {
+            const char* run = position;
+            while (position < end && *position != '"' && *position != '\\' && static_cast<unsigned char>(*position) >= 0x20) ++position;
+            out.append(run, position);
+
+            if (position == end) return fail("unterminated string");
+            char c = *position++;
+            if (c == '"') return true;
+            if (c != '\\') return fail("control character in string");
+            if (position == end) return fail("unterminated string");
+
+            switch (*position++) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t codePoint;
+                if (!parseHex4(codePoint)) return false;
+                // A high surrogate must be followed by an escaped low surrogate
+                if (codePoint >= 0xD800 && codePoint < 0xDC00) {
+                    uint32_t low;
+                    if (!consume("\\u") || !parseHex4(low) || low < 0xDC00 || low >= 0xE000) return fail("invalid surrogate pair");
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                } else if (codePoint >= 0xDC00 && codePoint < 0xE000) {
+                    return fail("invalid surrogate pair");
+                }
+                appendUtf8(out, codePoint);
+                break;
+            }
+            default:
+                return fail("invalid escape");
+            }
+        }
+    }
+
+    bool parseNumber(JsonValue& value)
+    {
+        // Validate the JSON grammar, which is stricter than strtod's
+        const char* start = position;
+        if (position < end && *position == '-') ++position;
+        if (position == end || *position < '0' || *position > '9') return fail("invalid value");
+        if (*position == '0') {
+            ++position;
+        } else {
+            while (position < end && *position >= '0' && *position <= '9') ++position;
+        }
+        if (position < end && *position == '.') {
+            ++position;
+            if (position == end || *position < '0' || *position > '9') return fail("invalid number");
+            while (position < end && *position >= '0' && *position <= '9') ++position;
+        }
+        if (position < end && (*position == 'e' || *position == 'E')) {
+            ++position;
+            if (position < end && (*position == '+' || *position == '-')) ++position;
+            if (position == end || *position < '0' || *position > '9') return fail("invalid number");
+            while (position < end && *position >= '0' && *position <= '9') ++position;
+        }
+
+        // The text is not null-terminated, so convert a copy
+        std::string digits(start, position);
+        value.type = JsonValue::Type::NUMBER;
+        value.number = std::strtod(digits.c_str(), nullptr);
+        return true;
+    }
+};
+
+bool JsonValue::parse(const char* text, size_t length, JsonValue& value, std::string& error)
+{
+    JsonValue parsed;
+    JsonParser parser(text, length);
+    if (!parser.parseDocument(parsed, error)) return false;
+    value = std::move(parsed);
+    return true;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+    return type == Type::ARRAY && index < items.size() ? items[index] : nullValue();
+}
+
+const JsonValue& JsonValue::operator[](const char* key) const
+{
+    if (type == Type::OBJECT) {
+        for (const auto& member : members) {
+            if (member.first == key) return member.second;
+        }
+    }
+    return nullValue();
+}
+
+bool JsonValue::has(const char* key) const
+{
+    return !(*this)[key].isNull();
+}
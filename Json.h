@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <climits>
+
+// Minimal JSON document (RFC 8259) for reading glTF. Parses the whole text into a tree of values;
+// lookups of missing keys or indices return a shared null value instead of failing, so optional
+// fields can be read without checks.
+class JsonValue {
+public:
+    enum class Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+    // Parses text into value. Returns false and describes the problem in error on malformed input.
+    static bool parse(const char* text, size_t length, JsonValue& value, std::string& error);
+
+    Type getType() const { return type; }
+    bool isNull() const { return type == Type::NUL; }
+    bool isNumber() const { return type == Type::NUMBER; }
+    bool isString() const { return type == Type::STRING; }
+    bool isArray() const { return type == Type::ARRAY; }
+    bool isObject() const { return type == Type::OBJECT; }
+
+    // The value, or fallback if it has another type
+    bool asBool(bool fallback = false) const { return type == Type::BOOLEAN ? boolean : fallback; }
+    double asNumber(double fallback = 0.0) const { return type == Type::NUMBER ? number : fallback; }
+    int asInt(int fallback = -1) const
+    {
+        return type == Type::NUMBER && number >= INT_MIN && number <= INT_MAX ? static_cast<int>(number) : fallback;
+    }
+    const std::string& asString() const { return text; }   // Empty unless a string
+
+    // Elements of an array or members of an object; 0 for other types
+    size_t size() const { return type == Type::OBJECT ? members.size() : items.size(); }
+    const JsonValue& operator[](size_t index) const;
+    const JsonValue& operator[](const char* key) const;
+    bool has(const char* key) const;   // Member exists and is not null
+
+    const std::vector<std::pair<std::string, JsonValue>>& getMembers() const { return members; }
+
+private:
+    Type type = Type::NUL;
+    bool boolean = false;
+    double number = 0.0;
+    std::string text;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;   // In document order
+
+    friend class JsonParser;
+};
@@ -0,0 +1,306 @@
+#include "LightClusters.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LIGHT_CLUSTERS_SSE 1
+#endif
+
+namespace {
+    // Intensity below which a light no longer visibly contributes
+    const float LIGHT_THRESHOLD = 0.04f;
+
+    // Texels of packed light data per light, matching FetchLight in shader.frag
+    const int LIGHT_TEXELS = 5;
+
+    unsigned int createTextureBuffer(unsigned int& buffer, GLenum format)
+    {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        return texture;
+    }
+
+    void writeTextureBuffer(unsigned int buffer, const void* data, size_t size)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        // Orphan last frame's contents; never allocate zero bytes
+        glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(size, 16), nullptr, GL_STREAM_DRAW);
+        if (size > 0) glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+}
+
+LightClusters::LightClusters()
+{
+    for (int axis = 0; axis < 3; ++axis) {
+        boundsMin[axis].assign(TILE_STRIDE * SLICES, FLT_MAX);   // Padding never overlaps a light
+        boundsMax[axis].assign(TILE_STRIDE * SLICES, -FLT_MAX);
+        sphereCenter[axis].assign(TILE_STRIDE * SLICES, 0.0f);
+    }
+    sphereRadius.assign(TILE_STRIDE * SLICES, 0.0f);
+    binned.resize(static_cast<size_t>(CLUSTER_COUNT) * MAX_LIGHTS_PER_CLUSTER);
+    binnedCounts.resize(CLUSTER_COUNT);
+    ranges.resize(CLUSTER_COUNT * 2);
+
+    lightTexture = createTextureBuffer(lightBuffer, GL_RGBA32F);
+    rangeTexture = createTextureBuffer(rangeBuffer, GL_RG32UI);
+    indexTexture = createTextureBuffer(indexBuffer, GL_R16UI);
+}
+
+LightClusters::~LightClusters()
+{
+    unsigned int textures[] = { lightTexture, rangeTexture, indexTexture };
+    unsigned int buffers[] = { lightBuffer, rangeBuffer, indexBuffer };
+    glDeleteTextures(3, textures);
+    glDeleteBuffers(3, buffers);
+}
+
+void LightClusters::clear()
+{
+    lights.clear();
+}
+
+void LightClusters::addLight(const Light& light)
+{
+    // Light indices are stored as 16 bits
+    if (lights.size() < 0xFFFF) lights.push_back(light);
+}
+
+float LightClusters::lightRange(const Light& light)
+{
+    glm::vec3 color = light.ambient + light.diffuse + light.specular;
+    float peak = std::max(color.r, std::max(color.g, color.b));
+    if (peak <= 0.0f) return 0.0f;
+
+    // Solve 1 / (constant + linear * d + quadratic * d^2) = LIGHT_THRESHOLD / peak for d
+    float target = peak / LIGHT_THRESHOLD;
+    if (target <= light.constant) return 0.0f;
+    if (light.quadratic > 0.0f) {
+        float discriminant = light.linear * light.linear + 4.0f * light.quadratic * (target - light.constant);
+        return (-light.linear + std::sqrt(discriminant)) / (2.0f * light.quadratic);
+    }
+    if (light.linear > 0.0f) return (target - light.constant) / light.linear;
+    return FLT_MAX;
+}
+
+void LightClusters::buildClusterBounds(const glm::mat4& projection)
+{
+    clusterProjection = projection;
+
+    // Near and far planes of a GL perspective projection
+    float nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+    float farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+    float logRatio = std::log(farPlane / nearPlane);
+    sliceScale = SLICES / logRatio;
+    sliceBias = -SLICES * std::log(nearPlane) / logRatio;
+    sliceDepths.resize(SLICES + 1);
+    for (int s = 0; s <= SLICES; ++s) {
+        sliceDepths[s] = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(s) / SLICES);
+    }
+
+    // View-space rays through the tile corners, scaled to unit depth
+    glm::mat4 inverseProjection = glm::inverse(projection);
+    std::vector<glm::vec3> corners((TILES_X + 1) * (TILES_Y + 1));
+    for (int y = 0; y <= TILES_Y; ++y) {
+        for (int x = 0; x <= TILES_X; ++x) {
+            glm::vec4 ndc(-1.0f + 2.0f * x / TILES_X, -1.0f + 2.0f * y / TILES_Y, -1.0f, 1.0f);
+            glm::vec4 point = inverseProjection * ndc;
+            glm::vec3 ray = glm::vec3(point) / point.w;
+            corners[y * (TILES_X + 1) + x] = ray / -ray.z;
+        }
+    }
+
+    for (int s = 0; s < SLICES; ++s) {
+        for (int y = 0; y < TILES_Y; ++y) {
+            for (int x = 0; x < TILES_X; ++x) {
+                glm::vec3 low(FLT_MAX), high(-FLT_MAX);
+                for (int corner = 0; corner < 4; ++corner) {
+                    const glm::vec3& ray = corners[(y + corner / 2) * (TILES_X + 1) + x + corner % 2];
+                    for (int d = 0; d < 2; ++d) {
+                        glm::vec3 point = ray * sliceDepths[s + d];
+                        low = glm::min(low, point);
+                        high = glm::max(high, point);
+                    }
+                }
+                size_t i = static_cast<size_t>(s) * TILE_STRIDE + y * TILES_X + x;
+                glm::vec3 center = (low + high) * 0.5f;
+                for (int axis = 0; axis < 3; ++axis) {
+                    boundsMin[axis][i] = low[axis];
+                    boundsMax[axis][i] = high[axis];
+                    sphereCenter[axis][i] = center[axis];
+                }
+                sphereRadius[i] = glm::length(high - low) * 0.5f;
+            }
+        }
+    }
+}
+
+void LightClusters::binLight(uint16_t index, const glm::vec3& viewPosition, const glm::vec3& viewDirection, float range,
+                             const Light& light)
+{
+    // Depth slices the light's sphere spans
+    float depth = -viewPosition.z;
+    float nearest = depth - range, farthest = depth + range;
+    if (farthest < sliceDepths.front() || nearest > sliceDepths.back()) return;
+    int firstSlice = nearest <= sliceDepths.front() ? 0 : static_cast<int>(std::log(nearest) * sliceScale + sliceBias);
+    int lastSlice = farthest >= sliceDepths.back() ? SLICES - 1 : static_cast<int>(std::log(farthest) * sliceScale + sliceBias);
+    firstSlice = std::max(0, std::min(firstSlice, SLICES - 1));
+    lastSlice = std::max(firstSlice, std::min(lastSlice, SLICES - 1));
+
+    // Spot lights also reject clusters outside the cone (bounding sphere against the cone)
+    float coneCos = light.outerCutOff;
+    float coneSin = std::sqrt(std::max(0.0f, 1.0f - coneCos * coneCos));
+    auto append = [&](int slice, int tile) {
+        size_t cluster = static_cast<size_t>(slice) * TILES_X * TILES_Y + tile;
+        if (binnedCounts[cluster] < MAX_LIGHTS_PER_CLUSTER) {
+            binned[cluster * MAX_LIGHTS_PER_CLUSTER + binnedCounts[cluster]++] = index;
+        } else {
+            ++droppedLights;
+        }
+    };
+
+    for (int s = firstSlice; s <= lastSlice; ++s) {
+        size_t base = static_cast<size_t>(s) * TILE_STRIDE;
+#ifdef LIGHT_CLUSTERS_SSE
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 px = _mm_set1_ps(viewPosition.x), py = _mm_set1_ps(viewPosition.y), pz = _mm_set1_ps(viewPosition.z);
+        const __m128 dx = _mm_set1_ps(viewDirection.x), dy = _mm_set1_ps(viewDirection.y), dz = _mm_set1_ps(viewDirection.z);
+        const __m128 rangeSquared = _mm_set1_ps(range * range), rangeWide = _mm_set1_ps(range);
+        const __m128 cosWide = _mm_set1_ps(coneCos), sinWide = _mm_set1_ps(coneSin);
+        for (int t = 0; t < TILES_X * TILES_Y; t += 4) {
+            size_t i = base + t;
+            // Squared distance from the light to each cluster box
+            __m128 ex = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&boundsMin[0][i]), px), _mm_sub_ps(px, _mm_loadu_ps(&boundsMax[0][i]))));
+            __m128 ey = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&boundsMin[1][i]), py), _mm_sub_ps(py, _mm_loadu_ps(&boundsMax[1][i]))));
+            __m128 ez = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&boundsMin[2][i]), pz), _mm_sub_ps(pz, _mm_loadu_ps(&boundsMax[2][i]))));
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)), _mm_mul_ps(ez, ez));
+            __m128 hit = _mm_cmple_ps(distance, rangeSquared);
+
+            if (light.spot) {
+                __m128 vx = _mm_sub_ps(_mm_loadu_ps(&sphereCenter[0][i]), px);
+                __m128 vy = _mm_sub_ps(_mm_loadu_ps(&sphereCenter[1][i]), py);
+                __m128 vz = _mm_sub_ps(_mm_loadu_ps(&sphereCenter[2][i]), pz);
+                __m128 radius = _mm_loadu_ps(&sphereRadius[i]);
+                __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+                __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, dx), _mm_mul_ps(vy, dy)), _mm_mul_ps(vz, dz));
+                __m128 across = _mm_sqrt_ps(_mm_max_ps(zero, _mm_sub_ps(lengthSquared, _mm_mul_ps(along, along))));
+                __m128 closest = _mm_sub_ps(_mm_mul_ps(cosWide, across), _mm_mul_ps(along, sinWide));
+                hit = _mm_and_ps(hit, _mm_cmple_ps(closest, radius));
+                hit = _mm_and_ps(hit, _mm_cmple_ps(along, _mm_add_ps(radius, rangeWide)));
+                hit = _mm_and_ps(hit, _mm_cmpge_ps(along, _mm_sub_ps(zero, radius)));
+            }
+
+            int mask = _mm_movemask_ps(hit);
+            while (mask) {
+                int lane = 0;
+                while (!(mask & (1 << lane))) ++lane;
+                mask &= mask - 1;
+                if (t + lane < TILES_X * TILES_Y) append(s, t + lane);
+            }
+        }
+#else
+        for (int t = 0; t < TILES_X * TILES_Y; ++t) {
+            size_t i = base + t;
+            float distance = 0.0f;
+            for (int axis = 0; axis < 3; ++axis) {
+                float e = std::max(0.0f, std::max(boundsMin[axis][i] - viewPosition[axis], viewPosition[axis] - boundsMax[axis][i]));
+                distance += e * e;
+            }
+            if (distance > range * range) continue;
+
+            if (light.spot) {
+                glm::vec3 v = glm::vec3(sphereCenter[0][i], sphereCenter[1][i], sphereCenter[2][i]) - viewPosition;
+                float along = glm::dot(v, viewDirection);
+                float across = std::sqrt(std::max(0.0f, glm::dot(v, v) - along * along));
+                float radius = sphereRadius[i];
+                if (coneCos * across - along * coneSin > radius || along > radius + range || along < -radius) continue;
+            }
+            append(s, t);
+        }
+#endif
+    }
+}
+
+void LightClusters::update(const glm::mat4& view, const glm::mat4& projection, int width, int height)
+{
+    if (projection != clusterProjection) buildClusterBounds(projection);
+    viewportWidth = std::max(width, 1);
+    viewportHeight = std::max(height, 1);
+
+    std::fill(binnedCounts.begin(), binnedCounts.end(), 0u);
+    droppedLights = 0;
+    lightTexels.resize(lights.size() * LIGHT_TEXELS);
+    for (size_t l = 0; l < lights.size(); ++l) {
+        const Light& light = lights[l];
+        float range = lightRange(light);
+
+        // Folding the constant term into the colours leaves 1 + linear * d + quadratic * d^2,
+        // so a light fits in five texels
+        float scale = 1.0f / std::max(light.constant, 1e-4f);
+        glm::vec4* texels = &lightTexels[l * LIGHT_TEXELS];
+        texels[0] = glm::vec4(light.position, range);
+        texels[1] = glm::vec4(light.direction, light.spot ? light.cutOff : -2.0f);   // Point lights: whole sphere
+        texels[2] = glm::vec4(light.ambient * scale, light.spot ? light.outerCutOff : -3.0f);
+        texels[3] = glm::vec4(light.diffuse * scale, light.linear * scale);
+        texels[4] = glm::vec4(light.specular * scale, light.quadratic * scale);
+
+        if (range <= 0.0f) continue;
+        glm::vec3 viewPosition = glm::vec3(view * glm::vec4(light.position, 1.0f));
+        glm::vec3 viewDirection = glm::normalize(glm::mat3(view) * light.direction);
+        binLight(static_cast<uint16_t>(l), viewPosition, viewDirection, range, light);
+    }
+
+    // Compact the per-cluster slots into one index list
+    indices.clear();
+    maxLightsPerCluster = 0;
+    for (int c = 0; c < CLUSTER_COUNT; ++c) {
+        uint32_t count = binnedCounts[c];
+        ranges[c * 2] = static_cast<uint32_t>(indices.size());
+        ranges[c * 2 + 1] = count;
+        indices.insert(indices.end(), binned.begin() + static_cast<size_t>(c) * MAX_LIGHTS_PER_CLUSTER,
+                       binned.begin() + static_cast<size_t>(c) * MAX_LIGHTS_PER_CLUSTER + count);
+        maxLightsPerCluster = std::max<size_t>(maxLightsPerCluster, count);
+    }
+
+    upload();
+}
+
+void LightClusters::upload()
+{
+    writeTextureBuffer(lightBuffer, lightTexels.data(), lightTexels.size() * sizeof(glm::vec4));
+    writeTextureBuffer(rangeBuffer, ranges.data(), ranges.size() * sizeof(uint32_t));
+    writeTextureBuffer(indexBuffer, indices.data(), indices.size() * sizeof(uint16_t));
+}
+
+void LightClusters::fillUniforms(FrameUniforms::Lights& uniforms) const
+{
+    uniforms.clusterScale = glm::vec4(static_cast<float>(TILES_X) / viewportWidth, static_cast<float>(TILES_Y) / viewportHeight,
+                                      sliceScale, sliceBias);
+    uniforms.clusterCount = glm::ivec4(TILES_X, TILES_Y, SLICES, 0);
+}
+
+void LightClusters::bind(Shader& shader) const
+{
+    unsigned int textures[] = { lightTexture, rangeTexture, indexTexture };
+    for (int i = 0; i < 3; ++i) {
+        glActiveTexture(GL_TEXTURE0 + FIRST_TEXTURE_UNIT + i);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    // Sampler uniforms are reset when the program is reloaded, so set them with every bind
+    shader.setInt("clusterLights", FIRST_TEXTURE_UNIT);
+    shader.setInt("clusterRanges", FIRST_TEXTURE_UNIT + 1);
+    shader.setInt("clusterLightIndices", FIRST_TEXTURE_UNIT + 2);
+}
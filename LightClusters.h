@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "Shader.h"
+#include "FrameUniforms.h"
+
+// Clustered forward lighting. The view frustum is split into a grid of screen tiles times
+// exponential depth slices; every frame the point and spot lights are binned on the CPU (four
+// clusters at a time with SSE) into the clusters their range reaches, and shader.frag shades
+// only the lights of the fragment's cluster. The light data, the per-cluster ranges and the
+// light index list are uploaded as texture buffers, which GL 3.3 can index from the shader.
+class LightClusters {
+public:
+    static const int TILES_X = 16;
+    static const int TILES_Y = 9;
+    static const int SLICES = 24;
+    static const int CLUSTER_COUNT = TILES_X * TILES_Y * SLICES;
+
+    // Lights a single cluster can hold; further ones are dropped (see getDroppedLights)
+    static const int MAX_LIGHTS_PER_CLUSTER = 64;
+
+    // Texture units of the three buffers, above those Mesh::Draw uses for materials
+    static const int FIRST_TEXTURE_UNIT = 13;
+
+    struct Light {
+        glm::vec3 position;
+        glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);   // Spot lights only
+        glm::vec3 ambient = glm::vec3(0.0f);
+        glm::vec3 diffuse = glm::vec3(0.0f);
+        glm::vec3 specular = glm::vec3(0.0f);
+        float constant = 1.0f;
+        float linear = 0.09f;
+        float quadratic = 0.032f;
+        float cutOff = 0.0f;        // Spot cone cosines; ignored for point lights
+        float outerCutOff = 0.0f;
+        bool spot = false;
+    };
+
+    LightClusters();
+    ~LightClusters();
+
+    LightClusters(const LightClusters&) = delete;
+    LightClusters& operator=(const LightClusters&) = delete;
+
+    // Lights for the next update()
+    void clear();
+    void addLight(const Light& light);
+
+    // Bins the lights for the camera and uploads the buffers. The cluster bounds are rebuilt
+    // only when the projection changes.
+    void update(const glm::mat4& view, const glm::mat4& projection, int viewportWidth, int viewportHeight);
+
+    // Grid parameters for the Lights uniform block
+    void fillUniforms(FrameUniforms::Lights& lights) const;
+
+    // Binds the texture buffers and points the shader's samplers at them
+    void bind(Shader& shader) const;
+
+    size_t getLightCount() const { return lights.size(); }
+    size_t getMaxLightsPerCluster() const { return maxLightsPerCluster; }
+    size_t getDroppedLights() const { return droppedLights; }
+    float getAverageLightsPerCluster() const { return static_cast<float>(indices.size()) / CLUSTER_COUNT; }
+
+    // Distance at which a light's attenuated intensity falls below the visible threshold;
+    // shader.frag fades each light out smoothly at this range
+    static float lightRange(const Light& light);
+
+private:
+    std::vector<Light> lights;
+
+    // Cluster bounds in view space, structure of arrays for SIMD: for slice s, the 4-aligned
+    // runs [s * TILE_STRIDE, s * TILE_STRIDE + TILES_X * TILES_Y) hold the tiles of that slice
+    static const int TILE_STRIDE = (TILES_X * TILES_Y + 3) & ~3;
+    std::vector<float> boundsMin[3], boundsMax[3];
+    std::vector<float> sphereCenter[3], sphereRadius;   // Bounding spheres, for the spot cone test
+    std::vector<float> sliceDepths;                     // SLICES + 1 view-space depths
+    glm::mat4 clusterProjection = glm::mat4(0.0f);
+    float sliceScale = 0.0f, sliceBias = 0.0f;
+    int viewportWidth = 1, viewportHeight = 1;
+
+    std::vector<uint16_t> binned;        // MAX_LIGHTS_PER_CLUSTER slots per cluster
+    std::vector<uint32_t> binnedCounts;
+    std::vector<uint32_t> ranges;        // (first index, count) per cluster
+    std::vector<uint16_t> indices;       // Light indices, cluster by cluster
+    std::vector<glm::vec4> lightTexels;  // LIGHT_TEXELS per light
+    size_t maxLightsPerCluster = 0;
+    size_t droppedLights = 0;
+
+    unsigned int lightBuffer = 0, rangeBuffer = 0, indexBuffer = 0;
+    unsigned int lightTexture = 0, rangeTexture = 0, indexTexture = 0;
+
+    void buildClusterBounds(const glm::mat4& projection);
+    void binLight(uint16_t index, const glm::vec3& viewPosition, const glm::vec3& viewDirection, float range, const Light& light);
+    void upload();
+};
@@ -4,6 +4,7 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <algorithm>
 
 // Add ImGui headers
 #include "imgui.h"
@@ -17,11 +18,20 @@
 
 // Add our custom headers
 #include "Shader.h"
+#include "FrameUniforms.h"
+#include "LightClusters.h"
+#include "DeferredRenderer.h"
 #include "Camera.h"
 #include "MuseumRoom.h"
 #include "MuseumObjectManager.h"
+#include "Scene.h"
+#include "SceneStreamer.h"
 #include "MobileRobot.h"
 #include "RayTracer.h"
+#include "HybridRenderer.h"
+#include "ScenePicker.h"
+#include "ThreadPool.h"
+#include "CompressedTexture.h"
 
 // Global variables for camera and input
 Camera camera(glm::vec3(0.0f, 3.0f, 5.0f));
@@ -35,6 +45,11 @@ float lastFrame = 0.0f;
 bool mouseCaptured = true;
 bool mKeyPressed = false;
 
+// Pending mouse pick (cursor position in window coordinates)
+bool pickRequested = false;
+double pickCursorX = 0.0;
+double pickCursorY = 0.0;
+
 // Callback function to adjust the viewport when the window size changes
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
@@ -59,6 +74,16 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
     camera.ProcessMouseMovement(xoffset, yoffset);
 }
 
+// Mouse button callback: left click in the 3D view picks an exhibit or the robot
+void mouse_button_callback(GLFWwindow* window, int button, int action, int /*mods*/) {
+    if (mouseCaptured) return; // The cursor is only visible when released
+    if (button != GLFW_MOUSE_BUTTON_LEFT || action != GLFW_PRESS) return;
+    if (ImGui::GetCurrentContext() && ImGui::GetIO().WantCaptureMouse) return; // Click belongs to the UI
+    
+    glfwGetCursorPos(window, &pickCursorX, &pickCursorY);
+    pickRequested = true;
+}
+
 // Scroll callback
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
@@ -125,6 +150,7 @@ int main() {
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    glfwSetMouseButtonCallback(window, mouse_button_callback);
     
     // Tell GLFW to capture our mouse
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -134,6 +160,9 @@ int main() {
         std::cerr << "Failed to initialize GLAD\n";
         return -1;
     }
+
+    // Texture loading picks block-compressed formats based on what this context can sample
+    CompressedTexture::detectSupport();
     
     // Set the viewport dimensions
     glViewport(0, 0, 800, 600);
@@ -154,12 +183,34 @@ int main() {
     glEnable(GL_DEPTH_TEST);
     
     // Create shader program
-    Shader ourShader("shader.vert", "shader.frag");
+    Shader ourShader("shader.vert", "shader.frag", { "HAS_TEXTURE", "HAS_SPECULAR_MAP", "HAS_NORMAL_MAP", "ADVANCED_SHADING" });
+    // Camera and light uniform buffers shared by the programs
+    FrameUniforms frameUniforms;
+    frameUniforms.attach(ourShader);
+    // Point and spot lights binned per view-frustum cluster every frame
+    LightClusters lightClusters;
       // Create museum room
     MuseumRoom room;
-      // Create museum object manager and load default objects
+      // Create museum object manager and place the exhibits described by the scene file,
+      // streaming their models in as the camera approaches; without one, use the built-in hall
     MuseumObjectManager objectManager;
-    objectManager.loadDefaultObjects();    // Create mobile robot
+    Scene scene;
+    bool sceneLoaded = Scene::load("museum.scene", scene);
+    if (sceneLoaded) {
+        std::vector<MuseumRoom::Box> rooms;
+        for (const Scene::Room& sceneRoom : scene.rooms) {
+            rooms.push_back({ sceneRoom.center, sceneRoom.size });
+        }
+        room.setRooms(rooms);
+        objectManager.setStreaming(true);
+        objectManager.loadScene(scene);
+    } else {
+        objectManager.loadDefaultObjects();
+    }
+    SceneStreamer sceneStreamer;
+    int streamingCpuBudgetMB = static_cast<int>(sceneStreamer.cpuBudget >> 20);
+    int streamingGpuBudgetMB = static_cast<int>(sceneStreamer.gpuBudget >> 20);
+    // Create mobile robot
     MobileRobot robot;
     
     // Create and initialize ray tracer
@@ -182,19 +233,79 @@ int main() {
     metalMaterial.roughness = 0.1f;
     rayTracer.addSphere(glm::vec3(-3.0f, 2.0f, -3.0f), 0.8f, metalMaterial);
     
-    // Set camera boundaries to keep it inside the museum room
-    // Room dimensions: 20x8x20 (width x height x depth)
+    // Room walls and ceiling so secondary rays see the museum instead of the background
+    RayTracingMaterial wallMaterial;
+    wallMaterial.albedo = glm::vec3(0.6f, 0.55f, 0.5f);
+    wallMaterial.roughness = 0.9f;
+    if (sceneLoaded) {
+        // The same rectangles the rasterizer draws, so doorways stay open between rooms.
+        // Floors are covered by the tracer's own floor plane.
+        for (const MuseumRoom::Surface& surface : room.getSurfaces()) {
+            if (surface.normal.y > 0.5f) continue;
+            rayTracer.addQuad(surface.origin, surface.edgeU, surface.edgeV, wallMaterial);
+        }
+    } else {
+        rayTracer.addPlane(glm::vec3(0.0f, 8.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), wallMaterial);
+        rayTracer.addPlane(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f, 0.0f, -1.0f), wallMaterial);
+        rayTracer.addPlane(glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f, 0.0f, 1.0f), wallMaterial);
+        rayTracer.addPlane(glm::vec3(-10.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), wallMaterial);
+        rayTracer.addPlane(glm::vec3(10.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), wallMaterial);
+    }
+    
+    // Exhibits are traced as real triangles from out-of-core BVH files next to the models.
+    // Only the treelets rays reach are mapped, within the shared treelet cache budget.
+    // A file is opened (or converted) on the worker pool once its exhibit has streamed in, so
+    // conversions follow the streamer's budgets, and the mesh is added when that finishes.
+    int treeletBudgetMB = static_cast<int>(TreeletCache::shared().getBudget() / (1024 * 1024));
+    // Exhibits placing the same model share one conversion and one mapping.
+    std::vector<std::shared_future<std::shared_ptr<OutOfCoreBVH>>> exhibitTraceMeshes(objectManager.getObjectCount());
+    std::vector<bool> exhibitTraceMeshAdded(objectManager.getObjectCount(), false);
+    std::map<std::string, std::shared_future<std::shared_ptr<OutOfCoreBVH>>> traceMeshesByPath;
+    
+    // Hybrid renderer: rasterized G-buffer + ray-traced reflections/refractions for selected pixels
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    HybridRenderer hybridRenderer(framebufferWidth, framebufferHeight);
+    bool enableHybridRendering = false;
+    
+    // Deferred shading: G-buffer pass, then one lighting pass over the visible pixels
+    DeferredRenderer deferredRenderer(framebufferWidth, framebufferHeight);
+    bool enableDeferredShading = false;
+    
+    // Forward shading variant with the PBR-like effects of shader.frag
+    bool enableAdvancedShading = false;
+    
+    // Hot reload: an edited shader recompiles just its program, and an edited model or texture is
+    // re-imported in the background and swapped in between frames
+    FileWatcher fileWatcher;
+    std::vector<Shader*> watchedShaders = hybridRenderer.getShaders();
+    for (Shader* shader : deferredRenderer.getShaders()) watchedShaders.push_back(shader);
+    for (Shader* shader : watchedShaders) frameUniforms.attach(*shader);
+    watchedShaders.push_back(&ourShader);
+    for (Shader* shader : watchedShaders) {
+        for (const std::string& path : { shader->getVertexPath(), shader->getFragmentPath() }) {
+            fileWatcher.watch(path, [shader](const std::string&) { shader->reload(); });
+        }
+    }
+    objectManager.enableHotReload(fileWatcher);
+    int hybridBounces = hybridRenderer.getMaxBounces();
+    
+    // Set camera boundaries to keep it inside the museum (the box around all rooms)
     // Add small margins to prevent camera from going through walls
     float roomMargin = 0.5f;
+    glm::vec3 museumMin = room.getBoundsMin();
+    glm::vec3 museumMax = room.getBoundsMax();
     camera.SetRoomBoundaries(
-        -10.0f + roomMargin,  // minX 
-         10.0f - roomMargin,  // maxX
-         1.0f,                // minY (keep camera above floor)
-         7.0f,                // maxY (keep camera below ceiling)
-        -10.0f + roomMargin,  // minZ
-         10.0f - roomMargin   // maxZ
-    );    // Museum state variables
+        museumMin.x + roomMargin,  // minX 
+        museumMax.x - roomMargin,  // maxX
+        museumMin.y + 1.0f,        // minY (keep camera above floor)
+        museumMax.y - 1.0f,        // maxY (keep camera below ceiling)
+        museumMin.z + roomMargin,  // minZ
+        museumMax.z - roomMargin   // maxZ
+    );
+    robot.setRoomBounds(museumMin + glm::vec3(roomMargin), museumMax - glm::vec3(roomMargin));    // Museum state variables
     bool show_control_panel = true;
+    PickResult lastPick;
     bool show_scan_result_popup = false;
     float robot_position[3] = {0.0f, 0.0f, 0.0f};
     float robot_arm_angle = 0.0f;
@@ -217,9 +328,61 @@ int main() {
         // Poll and handle events
         glfwPollEvents();
         // Process input
-        processInput(window);        // Update robot
+        processInput(window);
+        
+        // Swap in exhibits whose background import (or reload) has finished
+        fileWatcher.poll();
+        if (sceneLoaded) {
+            sceneStreamer.update(objectManager, camera.Position, robot.getPosition(), deltaTime);
+        }
+        objectManager.update();
+        for (size_t i = 0; i < exhibitTraceMeshes.size(); ++i) {
+            const MuseumObject* obj = objectManager.getObject(i);
+            if (!obj || obj->loadState != MuseumObject::LoadState::READY || exhibitTraceMeshAdded[i]) continue;
+            if (!exhibitTraceMeshes[i].valid()) {
+                std::string modelPath = obj->modelPath;
+                auto& traceMesh = traceMeshesByPath[modelPath];
+                if (!traceMesh.valid()) {
+                    traceMesh = ThreadPool::shared().enqueue([modelPath]() { return OutOfCoreBVH::loadOrConvert(modelPath); }).share();
+                }
+                exhibitTraceMeshes[i] = traceMesh;
+            }
+            if (exhibitTraceMeshes[i].wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+            
+            std::shared_ptr<OutOfCoreBVH> mesh = exhibitTraceMeshes[i].get();
+            exhibitTraceMeshes[i] = std::shared_future<std::shared_ptr<OutOfCoreBVH>>();
+            exhibitTraceMeshAdded[i] = true; // Added once
+            if (!mesh || !obj->model) continue; // Keeps the bounding-sphere approximation
+            
+            RayTracingMaterial exhibitMaterial;
+            exhibitMaterial.albedo = obj->materialDiffuse;
+            exhibitMaterial.metallic = 0.3f;
+            rayTracer.addMesh(mesh, obj->getModelMatrix(), exhibitMaterial, static_cast<int>(i));
+        }
+        
+        // Update robot
         robot.update(deltaTime, objectManager);
         
+        // Resolve a pending mouse pick against the exhibit BVH and the robot
+        if (pickRequested) {
+            pickRequested = false;
+            int windowWidth, windowHeight;
+            glfwGetWindowSize(window, &windowWidth, &windowHeight);
+            glm::mat4 pickProjection = glm::perspective(glm::radians(camera.Zoom), 800.0f / 600.0f, 0.1f, 100.0f);
+            glm::vec3 rayOrigin, rayDirection;
+            ScenePicker::cursorRay(pickCursorX, pickCursorY, windowWidth, windowHeight,
+                                   camera.GetViewMatrix(), pickProjection, rayOrigin, rayDirection);
+            lastPick = ScenePicker::pick(rayOrigin, rayDirection, objectManager, robot);
+            
+            if (lastPick.target == PickTarget::EXHIBIT) {
+                // Same as pressing the exhibit's button
+                robot.setAutoMode(false);
+                robot.setReturningHome(false);
+                robot.setCurrentTargetObjectIndex(lastPick.objectIndex);
+                robot.moveToObject(lastPick.objectIndex, objectManager);
+            }
+        }
+        
         // Update museum object spotlights based on robot position
         objectManager.updateObjectSpotlights(robot.getPosition(), deltaTime);
           // Check if we have a new scan result
@@ -238,6 +401,9 @@ int main() {
         if (show_control_panel) {
             ImGui::Begin("Virtual Museum Control Panel", &show_control_panel);
             ImGui::Text("Welcome to the Virtual Museum!");
+            if (size_t loading = objectManager.getLoadingCount()) {
+                ImGui::Text("Loading exhibits: %zu remaining", loading);
+            }
             ImGui::Separator();
             
             if (ImGui::CollapsingHeader("Robot Controls", ImGuiTreeNodeFlags_DefaultOpen)) {
@@ -301,6 +467,14 @@ int main() {
                     ImGui::PopID();
                 }
                 
+                ImGui::Text("Or click an exhibit / the robot in the 3D view (mouse released)");
+                if (lastPick.target == PickTarget::EXHIBIT) {
+                    const MuseumObject* picked = objectManager.getObject(lastPick.objectIndex);
+                    ImGui::Text("Picked: %s (%.1f us)", picked ? picked->name.c_str() : "?", lastPick.pickTimeMicroseconds);
+                } else if (lastPick.target == PickTarget::ROBOT) {
+                    ImGui::Text("Picked: Robot (%.1f us)", lastPick.pickTimeMicroseconds);
+                }
+                
                 ImGui::Separator();
                 
                 // Robot arm controls
@@ -314,6 +488,9 @@ int main() {
                 if (robot.isScanning()) {
                     ImGui::Text("Status: SCANNING...");
                     ImGui::ProgressBar(arm.scanProgress, ImVec2(0.0f, 0.0f));
+                    const PointCloudScanner& scanner = robot.getScanner();
+                    ImGui::Text("Point cloud: %zu points (%zu rays, %.0fk rays/s)", scanner.getPoints().size(),
+                                scanner.getRaysCast(), scanner.getRaysPerSecond() / 1000.0f);
                 } else {
                     const char* stateNames[] = { "IDLE", "MOVING", "SCANNING", "RETURNING" };
                     ImGui::Text("Status: %s", stateNames[(int)robot.getState()]);
@@ -397,7 +574,75 @@ int main() {
                     enableWarmLighting = true;
                     atmosphericIntensity = 0.15f;
                 }
-            }if (ImGui::CollapsingHeader("Camera Controls")) {
+            }if (ImGui::CollapsingHeader("Rendering")) {
+                ImGui::Checkbox("Deferred Shading", &enableDeferredShading);
+                if (enableDeferredShading) {
+                    ImGui::Text("G-buffer: %d bytes per pixel", DeferredRenderer::getBytesPerPixel());
+                }
+                ImGui::Checkbox("Advanced Shading (forward)", &enableAdvancedShading);
+                ImGui::Text("Shader variants compiled: %zu", ourShader.getVariantCount());
+                ImGui::Checkbox("Ray-Traced Reflections (Hybrid)", &enableHybridRendering);
+                if (ImGui::SliderInt("Secondary Bounces", &hybridBounces, 1, 5)) {
+                    hybridRenderer.setMaxBounces(hybridBounces);
+                }
+                if (enableHybridRendering) {
+                    ImGui::Text("Traced pixels: %zu (%.1f%% of screen)", 
+                        hybridRenderer.getTracedPixelCount(), hybridRenderer.getCoverage() * 100.0f);
+                    ImGui::Text("Trace time: %.2f ms", hybridRenderer.getLastTraceTimeMs());
+                }
+                
+                // Out-of-core geometry paging
+                TreeletCache::Stats treeletStats = TreeletCache::shared().getStats();
+                ImGui::Text("Out-of-core meshes: %zu", rayTracer.getMeshCount());
+                ImGui::Text("Treelets resident: %zu (%.1f MB)", treeletStats.residentTreelets,
+                            treeletStats.residentBytes / (1024.0f * 1024.0f));
+                ImGui::Text("Page-ins: %zu, evictions: %zu, failed: %zu", treeletStats.pageIns,
+                            treeletStats.evictions, treeletStats.failedMaps);
+                if (ImGui::SliderInt("Treelet Cache (MB)", &treeletBudgetMB, 16, 2048)) {
+                    TreeletCache::shared().setBudget(static_cast<size_t>(treeletBudgetMB) * 1024 * 1024);
+                }
+                
+                // Distance-based level of detail for the exhibits
+                ImGui::SliderFloat("LOD Pixel Error", &objectManager.lodPixelError, 0.0f, 8.0f, "%.1f px");
+                ImGui::Text("Exhibit triangles: %zu of %zu", objectManager.getDrawnTriangles(),
+                            objectManager.getFullDetailTriangles());
+                ImGui::Text("Exhibits culled: %zu, occlusion-tested: %zu", objectManager.getCulledObjects(),
+                            objectManager.getOcclusionTestedObjects());
+                ImGui::Text("LOD detail streamed in: %.1f MB", objectManager.getRefinedBytes() / (1024.0f * 1024.0f));
+                AssetRegistry::Stats assetStats = objectManager.getAssets().getStats();
+                ImGui::Text("Exhibit models: %zu resident for %zu exhibits", assetStats.models, assetStats.handles);
+                ImGui::Text("Clustered lights: %zu, %.2f per cluster (max %zu)", lightClusters.getLightCount(),
+                            lightClusters.getAverageLightsPerCluster(), lightClusters.getMaxLightsPerCluster());
+                if (lightClusters.getDroppedLights() > 0) {
+                    ImGui::Text("Cluster overflow: %zu lights dropped", lightClusters.getDroppedLights());
+                }
+                if (sceneLoaded) {
+                    // Streaming of the scene's models by distance and memory budget
+                    const SceneStreamer::Stats& streamStats = sceneStreamer.getStats();
+                    ImGui::Text("Streaming: %zu resident, %zu loading, %.1f MB CPU / %.1f MB GPU",
+                                streamStats.residentModels, streamStats.loadingModels,
+                                streamStats.cpuBytes / (1024.0f * 1024.0f), streamStats.gpuBytes / (1024.0f * 1024.0f));
+                    ImGui::Text("Loads: %zu, evictions: %zu", streamStats.loads, streamStats.evictions);
+                    if (ImGui::SliderInt("Model CPU Budget (MB)", &streamingCpuBudgetMB, 32, 4096)) {
+                        sceneStreamer.cpuBudget = static_cast<size_t>(streamingCpuBudgetMB) << 20;
+                    }
+                    if (ImGui::SliderInt("Model GPU Budget (MB)", &streamingGpuBudgetMB, 32, 4096)) {
+                        sceneStreamer.gpuBudget = static_cast<size_t>(streamingGpuBudgetMB) << 20;
+                    }
+                    ImGui::SliderFloat("Load Distance", &sceneStreamer.loadDistance, 5.0f, 100.0f, "%.0f m");
+                    sceneStreamer.unloadDistance = std::max(sceneStreamer.unloadDistance, sceneStreamer.loadDistance);
+                    ImGui::SliderFloat("Unload Distance", &sceneStreamer.unloadDistance, sceneStreamer.loadDistance, 150.0f, "%.0f m");
+                }
+                GeometryPool::Stats geometryStats = GeometryPool::shared().getStats();
+                ImGui::Text("Geometry pool: %zu meshes, %.1f of %.1f MB", geometryStats.ranges,
+                            geometryStats.usedBytes / (1024.0f * 1024.0f), geometryStats.capacityBytes / (1024.0f * 1024.0f));
+
+                // Shared texture registry
+                TextureCache::Stats textureStats = TextureCache::shared().getStats();
+                ImGui::Text("Textures: %zu unique (%.1f MB), %zu shared uses", textureStats.textures,
+                            textureStats.gpuBytes / (1024.0f * 1024.0f), textureStats.hits);
+            }
+            if (ImGui::CollapsingHeader("Camera Controls")) {
                 ImGui::Text("Camera Position: (%.1f, %.1f, %.1f)", camera.Position.x, camera.Position.y, camera.Position.z);
                 ImGui::Text("Camera Zoom: %.1f", camera.Zoom);
                 ImGui::Separator();
@@ -458,6 +703,7 @@ int main() {
             // Display scan time
             float timeSinceScan = static_cast<float>(glfwGetTime()) - scanResult.scanTime;
             ImGui::Text("Scan Time: %.1f seconds ago", timeSinceScan);
+            ImGui::Text("Point Cloud: %zu points from %zu rays", scanResult.pointCount, scanResult.raysCast);
             
             // Display object description with proper wrapping
             ImGui::Separator();
@@ -483,43 +729,38 @@ int main() {
     }
         
     // --- RENDERING ---
+        // Camera/view transformation
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), 800.0f / 600.0f, 0.1f, 100.0f);
+        glm::mat4 view = camera.GetViewMatrix();
+        frameUniforms.setCamera({ view, projection, camera.Position, 0.0f });
+        
+        // Hybrid pass 1: G-buffer used to find the pixels that need secondary rays
+        if (enableHybridRendering) {
+            glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+            hybridRenderer.resize(framebufferWidth, framebufferHeight);
+            hybridRenderer.renderGBuffer(view, projection, room, objectManager, robot);
+        }
+        
         // Enhanced atmospheric background based on lighting settings
         glm::vec3 backgroundColor = enableWarmLighting ? 
             glm::vec3(0.12f, 0.10f, 0.08f) : glm::vec3(0.08f, 0.10f, 0.12f);
         backgroundColor += glm::vec3(atmosphericIntensity * 0.3f);
         glClearColor(backgroundColor.x, backgroundColor.y, backgroundColor.z, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        ourShader.use();
-            
-            // Camera/view transformation
-            glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), 800.0f / 600.0f, 0.1f, 100.0f);
-            glm::mat4 view = camera.GetViewMatrix();
-            ourShader.setMat4("projection", projection);
-            ourShader.setMat4("view", view);
-            ourShader.setVec3("viewPos", camera.Position);
-              // Material properties
-            ourShader.setVec3("material.ambient", 0.2f, 0.2f, 0.2f);
-            ourShader.setVec3("material.diffuse", 0.5f, 0.5f, 0.5f);
-            ourShader.setVec3("material.specular", 1.0f, 1.0f, 1.0f);
-            ourShader.setFloat("material.shininess", 64.0f);
-            ourShader.setBool("hasTexture", false); // Default to no texture for room
+            // The directional light goes to the shaders in one uniform buffer write; point and
+            // spot lights are binned into the light clusters
+            FrameUniforms::Lights lights = {};
              // Enhanced directional light with atmospheric adjustment
             glm::vec3 dirLightColor = enableWarmLighting ? 
                 glm::vec3(1.0f, 0.95f, 0.85f) : glm::vec3(1.0f, 1.0f, 1.0f);
             
-            ourShader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-            ourShader.setVec3("dirLight.ambient", 
+            lights.dirLight.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+            lights.dirLight.ambient = glm::vec3(
                 ambient_light + atmosphericIntensity, 
                 ambient_light + (enableWarmLighting ? atmosphericIntensity * 0.95f : atmosphericIntensity), 
                 ambient_light + (enableWarmLighting ? atmosphericIntensity * 0.85f : atmosphericIntensity));
-            ourShader.setVec3("dirLight.diffuse", 
-                directional_light ? dirLightColor.x * 0.5f : 0.0f, 
-                directional_light ? dirLightColor.y * 0.5f : 0.0f, 
-                directional_light ? dirLightColor.z * 0.5f : 0.0f);
-            ourShader.setVec3("dirLight.specular", 
-                directional_light ? dirLightColor.x : 0.0f, 
-                directional_light ? dirLightColor.y : 0.0f, 
-                directional_light ? dirLightColor.z : 0.0f);
+            lights.dirLight.diffuse = directional_light ? dirLightColor * 0.5f : glm::vec3(0.0f);
+            lights.dirLight.specular = directional_light ? dirLightColor : glm::vec3(0.0f);
             
             // Enhanced point lights with warm/cool lighting and intensity control
             glm::vec3 pointLightPositions[] = {
@@ -533,100 +774,96 @@ int main() {
             glm::vec3 pointLightColor = enableWarmLighting ? 
                 glm::vec3(1.0f, 0.9f, 0.8f) : glm::vec3(0.9f, 0.95f, 1.0f);
             
+            lightClusters.clear();
             for (int i = 0; i < 4; i++) {
-                std::string index = std::to_string(i);
-                ourShader.setVec3("pointLights[" + index + "].position", pointLightPositions[i]);
-                ourShader.setVec3("pointLights[" + index + "].ambient", 
-                    0.05f * pointLightIntensity * pointLightColor.x, 
-                    0.05f * pointLightIntensity * pointLightColor.y, 
-                    0.05f * pointLightIntensity * pointLightColor.z);
-                ourShader.setVec3("pointLights[" + index + "].diffuse", 
-                    0.8f * pointLightIntensity * pointLightColor.x, 
-                    0.8f * pointLightIntensity * pointLightColor.y, 
-                    0.8f * pointLightIntensity * pointLightColor.z);
-                ourShader.setVec3("pointLights[" + index + "].specular", 
-                    1.0f * pointLightIntensity * pointLightColor.x, 
-                    1.0f * pointLightIntensity * pointLightColor.y, 
-                    1.0f * pointLightIntensity * pointLightColor.z);
-                ourShader.setFloat("pointLights[" + index + "].constant", 1.0f);
-                ourShader.setFloat("pointLights[" + index + "].linear", 0.09f);
-                ourShader.setFloat("pointLights[" + index + "].quadratic", 0.032f);
-            }// Spotlights (museum object spotlights + robot spotlights)
-            glm::vec3 spotlightPositions[4];
-            glm::vec3 spotlightDirections[4];
-            glm::vec3 spotlightColors[4];
-            float spotlightIntensities[4];
-            
-            // Get active museum object spotlights
-            auto activeSpotlights = objectManager.getActiveSpotlights();
+                LightClusters::Light light;
+                light.position = pointLightPositions[i];
+                light.ambient = 0.05f * pointLightIntensity * pointLightColor;
+                light.diffuse = 0.8f * pointLightIntensity * pointLightColor;
+                light.specular = 1.0f * pointLightIntensity * pointLightColor;
+                lightClusters.addLight(light);
+            }
             
-            // Fill first slots with museum object spotlights (up to 2 slots)
-            int spotlightIndex = 0;
-            for (size_t i = 0; i < std::min(activeSpotlights.size(), size_t(2)); ++i) {
-                spotlightPositions[spotlightIndex] = activeSpotlights[i].position;
-                spotlightDirections[spotlightIndex] = activeSpotlights[i].direction;
-                spotlightColors[spotlightIndex] = activeSpotlights[i].color;
-                spotlightIntensities[spotlightIndex] = activeSpotlights[i].intensity;
-                spotlightIndex++;
+            // Spotlights: every lit exhibit's spotlight plus the robot's
+            for (const auto& exhibitSpotlight : objectManager.getActiveSpotlights()) {
+                LightClusters::Light light;
+                light.spot = true;
+                light.position = exhibitSpotlight.position;
+                light.direction = exhibitSpotlight.direction;
+                light.diffuse = exhibitSpotlight.color * exhibitSpotlight.intensity;
+                light.specular = exhibitSpotlight.color * exhibitSpotlight.intensity;
+                light.cutOff = glm::cos(glm::radians(exhibitSpotlight.cutOff));
+                light.outerCutOff = glm::cos(glm::radians(exhibitSpotlight.outerCutOff));
+                lightClusters.addLight(light);
+            }
+            if (robot.hasScanningSpotlight()) {
+                // Robot spotlights use tighter beam
+                LightClusters::Light light;
+                light.spot = true;
+                light.position = robot.getScanningSpotlightPosition();
+                light.direction = robot.getScanningSpotlightDirection();
+                light.diffuse = robot.getMainSpotlightColor() * robot.getScanningSpotlightIntensity();
+                light.specular = light.diffuse;
+                light.cutOff = glm::cos(glm::radians(robot.getSpotlightConeAngle()));
+                light.outerCutOff = glm::cos(glm::radians(robot.getSpotlightConeAngle() + 5.0f));
+                lightClusters.addLight(light);
             }
+            if (robot.isSecondarySpotlightActive()) {
+                LightClusters::Light light;
+                light.spot = true;
+                light.position = robot.getSecondarySpotlightPosition();
+                light.direction = robot.getSecondarySpotlightDirection();
+                light.diffuse = robot.getSecondarySpotlightColor() * robot.getSecondarySpotlightIntensity();
+                light.specular = light.diffuse;
+                light.cutOff = glm::cos(glm::radians(robot.getSpotlightConeAngle()));
+                light.outerCutOff = glm::cos(glm::radians(robot.getSpotlightConeAngle() + 5.0f));
+                lightClusters.addLight(light);
+            }
+            glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+            lightClusters.update(view, projection, framebufferWidth, framebufferHeight);
+            lightClusters.fillUniforms(lights);
+            frameUniforms.setLights(lights);
             
-            // Fill remaining slots with robot spotlights
-            while (spotlightIndex < 4) {
-                if (spotlightIndex == 2 && robot.hasScanningSpotlight()) {
-                    spotlightPositions[spotlightIndex] = robot.getScanningSpotlightPosition();
-                    spotlightDirections[spotlightIndex] = robot.getScanningSpotlightDirection();
-                    spotlightColors[spotlightIndex] = robot.getMainSpotlightColor();
-                    spotlightIntensities[spotlightIndex] = robot.getScanningSpotlightIntensity();
-                } else if (spotlightIndex == 3 && robot.isSecondarySpotlightActive()) {
-                    spotlightPositions[spotlightIndex] = robot.getSecondarySpotlightPosition();
-                    spotlightDirections[spotlightIndex] = robot.getSecondarySpotlightDirection();
-                    spotlightColors[spotlightIndex] = robot.getSecondarySpotlightColor();
-                    spotlightIntensities[spotlightIndex] = robot.getSecondarySpotlightIntensity();
-                } else {
-                    // Empty spotlight slot
-                    spotlightPositions[spotlightIndex] = glm::vec3(0.0f);
-                    spotlightDirections[spotlightIndex] = glm::vec3(0.0f, -1.0f, 0.0f);
-                    spotlightColors[spotlightIndex] = glm::vec3(1.0f);
-                    spotlightIntensities[spotlightIndex] = 0.0f;
-                }
-                spotlightIndex++;
+            // Forward shading lights every fragment as it is drawn; the deferred path draws the
+            // same calls into its G-buffer and lights the visible pixels afterwards
+            if (enableDeferredShading) deferredRenderer.resize(framebufferWidth, framebufferHeight);
+            Shader& sceneShader = enableDeferredShading ? deferredRenderer.beginGeometryPass() : ourShader;
+            if (!enableDeferredShading) {
+                ourShader.use();
+                lightClusters.bind(ourShader);
+                ourShader.setFeature("ADVANCED_SHADING", enableAdvancedShading);
+                ourShader.setFloat("time", static_cast<float>(glfwGetTime()));
             }
-              for (int i = 0; i < 4; i++) {
-                std::string index = std::to_string(i);
-                ourShader.setVec3("spotLights[" + index + "].position", spotlightPositions[i]);
-                ourShader.setVec3("spotLights[" + index + "].direction", spotlightDirections[i]);
-                ourShader.setVec3("spotLights[" + index + "].ambient", 0.0f, 0.0f, 0.0f);
-                ourShader.setVec3("spotLights[" + index + "].diffuse", spotlightColors[i] * spotlightIntensities[i]);
-                ourShader.setVec3("spotLights[" + index + "].specular", spotlightColors[i] * spotlightIntensities[i]);
-                ourShader.setFloat("spotLights[" + index + "].constant", 1.0f);
-                ourShader.setFloat("spotLights[" + index + "].linear", 0.09f);
-                ourShader.setFloat("spotLights[" + index + "].quadratic", 0.032f);
-                
-                // Set cut-off angles based on spotlight type
-                if (i < activeSpotlights.size()) {
-                    // Museum object spotlights use their own parameters
-                    ourShader.setFloat("spotLights[" + index + "].cutOff", glm::cos(glm::radians(activeSpotlights[i].cutOff)));
-                    ourShader.setFloat("spotLights[" + index + "].outerCutOff", glm::cos(glm::radians(activeSpotlights[i].outerCutOff)));
-                } else if (i >= 2) {
-                    // Robot spotlights use tighter beam
-                    ourShader.setFloat("spotLights[" + index + "].cutOff", glm::cos(glm::radians(robot.getSpotlightConeAngle())));
-                    ourShader.setFloat("spotLights[" + index + "].outerCutOff", glm::cos(glm::radians(robot.getSpotlightConeAngle() + 5.0f)));
-                } else {
-                    // Default spotlight parameters for empty slots
-                    ourShader.setFloat("spotLights[" + index + "].cutOff", glm::cos(glm::radians(25.0f)));
-                    ourShader.setFloat("spotLights[" + index + "].outerCutOff", glm::cos(glm::radians(35.0f)));
-                }}
+              // Material properties
+            sceneShader.setVec3("material.ambient", 0.2f, 0.2f, 0.2f);
+            sceneShader.setVec3("material.diffuse", 0.5f, 0.5f, 0.5f);
+            sceneShader.setVec3("material.specular", 1.0f, 1.0f, 1.0f);
+            sceneShader.setFloat("material.shininess", 64.0f);
             
             // Render the museum room
             glm::mat4 model = glm::mat4(1.0f);
-            ourShader.setMat4("model", model);
-            ourShader.setBool("hasTexture", false);
+            Mesh::setTransform(sceneShader, model);
+            sceneShader.setFeatures({ { "HAS_TEXTURE", false }, { "HAS_SPECULAR_MAP", false }, { "HAS_NORMAL_MAP", false } });
             room.render();
-              // Render museum objects
-            ourShader.setBool("hasTexture", true);
-            objectManager.drawAll(ourShader);
+              // Render museum objects (each mesh selects the variant for its textures)
+            Frustum viewFrustum(projection * view);
+            objectManager.setLodView(camera.Position, glm::radians(camera.Zoom), static_cast<float>(framebufferHeight));
+            objectManager.setFrustum(viewFrustum);
+            objectManager.drawAll(sceneShader);
               // Render mobile robot
-            robot.render(ourShader);
+            if (viewFrustum.intersects(robot.getBounds())) {
+                robot.render(sceneShader);
+            }
+            robot.renderPointCloud(sceneShader);
+            
+            if (enableDeferredShading) {
+                deferredRenderer.renderLighting(view, projection, lightClusters);
+            }
+            
+            // Hybrid pass 2: trace the compacted pixel list on the worker pool and blend it in
+            if (enableHybridRendering) {
+                hybridRenderer.traceAndComposite(rayTracer, camera.Position);
+            }
         
         // Render ImGui
         ImGui::Render();
@@ -0,0 +1,140 @@
+#include "MappedFile.h"
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedView::~MappedView()
+{
+    if (!base) return;
+#ifdef _WIN32
+    UnmapViewOfFile(base);
+#else
+    munmap(base, mappedSize);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        std::cout << "ERROR::MAPPED_FILE:: CreateFileMapping failed for " << path << std::endl;
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    fileSize = static_cast<uint64_t>(size.QuadPart);
+#else
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return false;
+
+    struct stat info;
+    if (fstat(descriptor, &info) != 0 || info.st_size == 0) {
+        ::close(descriptor);
+        return false;
+    }
+
+    fileDescriptor = descriptor;
+    fileSize = static_cast<uint64_t>(info.st_size);
+#endif
+
+    filePath = path;
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (fileDescriptor >= 0) ::close(fileDescriptor);
+    fileDescriptor = -1;
+#endif
+    fileSize = 0;
+    filePath.clear();
+}
+
+bool MappedFile::isOpen() const
+{
+#ifdef _WIN32
+    return mappingHandle != nullptr;
+#else
+    return fileDescriptor >= 0;
+#endif
+}
+
+std::unique_ptr<MappedView> MappedFile::map(uint64_t offset, size_t length) const
+{
+    if (!isOpen() || length == 0 || offset + length > fileSize) return nullptr;
+
+    // The OS only maps at granularity boundaries; map from the boundary and offset the pointer
+    uint64_t alignedOffset = offset - offset % allocationGranularity();
+    size_t lead = static_cast<size_t>(offset - alignedOffset);
+    size_t mappedSize = length + lead;
+
+#ifdef _WIN32
+    void* base = MapViewOfFile(mappingHandle, FILE_MAP_READ,
+                               static_cast<DWORD>(alignedOffset >> 32),
+                               static_cast<DWORD>(alignedOffset & 0xFFFFFFFFu), mappedSize);
+    if (!base) return nullptr;
+#else
+    void* base = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fileDescriptor, static_cast<off_t>(alignedOffset));
+    if (base == MAP_FAILED) return nullptr;
+#endif
+
+    std::unique_ptr<MappedView> view(new MappedView());
+    view->base = base;
+    view->mappedSize = mappedSize;
+    view->bytes = static_cast<const unsigned char*>(base) + lead;
+    view->length = length;
+    return view;
+}
+
+size_t MappedFile::allocationGranularity()
+{
+    static const size_t granularity = []() {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return static_cast<size_t>(info.dwAllocationGranularity);
+#else
+        return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    }();
+    return granularity;
+}
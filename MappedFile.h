@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+// Read-only view of a byte range of a memory-mapped file. Unmapped on destruction.
+class MappedView {
+public:
+    ~MappedView();
+
+    MappedView(const MappedView&) = delete;
+    MappedView& operator=(const MappedView&) = delete;
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    friend class MappedFile;
+    MappedView() = default;
+
+    void* base = nullptr;       // Start of the OS mapping (aligned down to the allocation granularity)
+    size_t mappedSize = 0;
+    const unsigned char* bytes = nullptr;
+    size_t length = 0;
+};
+
+// Read-only memory-mapped file (Win32 file mapping or POSIX mmap).
+// Views of arbitrary ranges can be mapped and released independently, so callers decide how much
+// of a large file is resident at a time; the OS pages the mapped bytes in on first touch.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const;
+    uint64_t size() const { return fileSize; }
+    const std::string& getPath() const { return filePath; }
+
+    // Map [offset, offset + length). Returns nullptr if the range is invalid or the OS refuses
+    // (e.g. the address space is exhausted).
+    std::unique_ptr<MappedView> map(uint64_t offset, size_t length) const;
+
+    // Map the whole file
+    std::unique_ptr<MappedView> mapAll() const { return map(0, static_cast<size_t>(fileSize)); }
+
+    // Alignment that mapping offsets are rounded down to
+    static size_t allocationGranularity();
+
+private:
+    std::string filePath;
+    uint64_t fileSize = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+};
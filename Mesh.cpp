@@ -1,24 +1,165 @@
 #include "Mesh.h"
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must match the attribute layout in GeometryPool");
+
+namespace {
+    glm::vec2 encodeOctahedral(glm::vec3 n)
+    {
+        n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        glm::vec2 e(n.x, n.y);
+        if (n.z < 0.0f) {
+            e = glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                          (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+        }
+        return e;
+    }
+
+    // Quaternion of the orthonormalized (tangent, bitangent, normal) frame with the bitangent's
+    // handedness in the sign of w
+    glm::quat encodeTangentFrame(const glm::vec3& normal, const glm::vec3& tangent, const glm::vec3& bitangent)
+    {
+        glm::vec3 t = tangent - normal * glm::dot(normal, tangent);
+        float length = glm::length(t);
+        if (!(length > 1e-6f)) {
+            // No UVs (or degenerate ones): any frame around the normal will do
+            t = glm::cross(normal, std::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f));
+            length = glm::length(t);
+        }
+        t /= length;
+        glm::vec3 b = glm::cross(normal, t);
+
+        glm::quat q = glm::normalize(glm::quat_cast(glm::mat3(t, b, normal)));
+        if (q.w < 0.0f) q = -q;
+
+        // Keep w at least one snorm8 step away from zero so its sign survives quantization
+        const float minW = 1.0f / 127.0f;
+        if (q.w < minW) {
+            float xyzScale = std::sqrt(1.0f - minW * minW) / glm::length(glm::vec3(q.x, q.y, q.z));
+            q = glm::quat(minW, q.x * xyzScale, q.y * xyzScale, q.z * xyzScale);
+        }
+        if (glm::dot(b, bitangent) < 0.0f) q = -q;
+        return q;
+    }
+}
+
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures,
+           const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::vector<MeshLod> lods)
+    : boundsMin(boundsMin), boundsMax(boundsMax)
+{
+    this->vertices = std::move(vertices);
+    this->indices = std::move(indices);
+    this->textures = std::move(textures);
+    this->lods = lods.empty() ? std::vector<MeshLod>{ { 0, static_cast<uint32_t>(this->indices.size()), 0.0f,
+                                                        static_cast<uint32_t>(this->vertices.size()) } } : std::move(lods);
+
+    // Now that we have all the required data, copy it into the shared buffers.
+    setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size());
+    loadedVertices = static_cast<uint32_t>(this->vertices.size());
+}
+
+Mesh::Mesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount,
+           std::vector<Texture> textures, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+           std::vector<MeshLod> lods)
+    : boundsMin(boundsMin), boundsMax(boundsMax)
 {
-    this->vertices = vertices;
-    this->indices = indices;
     this->textures = textures;
+    this->lods = lods.empty() ? std::vector<MeshLod>{ { 0, static_cast<uint32_t>(indexCount), 0.0f,
+                                                        static_cast<uint32_t>(vertexCount) } } : lods;
+
+    sourceVertices = vertexData;
+    sourceIndices = indexData;
+    geometry = GeometryPool::shared().reserve(vertexCount, indexCount);
+    loadedLod = this->lods.size();
+    wantedLod = this->lods.size() - 1;
+    uploadLevel(this->lods.size() - 1);
+}
+
+size_t Mesh::Draw(Shader& shader, float maxError)
+{
+    bindTextures(shader, textures);
+
+    const MeshLod& lod = selectLod(maxError);
+    size_t indexSize = geometry.shortIndices ? sizeof(uint16_t) : sizeof(unsigned int);
 
-    // Now that we have all the required data, set the vertex buffers and its attribute pointers.
-    setupMesh();
+    // Draw mesh
+    setPositionDequantization(shader, boundsMin, boundsMax);
+    GeometryPool::shared().bind(geometry.shortIndices);
+    glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(lod.indexCount),
+                             geometry.shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+                             (void*)((geometry.firstIndex + lod.firstIndex) * indexSize), static_cast<GLint>(geometry.firstVertex));
+    glBindVertexArray(0);
+    shader.setBool("packedVertex", false);   // The room and robot share the shader with float vertices
+
+    // Always good practice to set everything back to defaults once configured.
+    glActiveTexture(GL_TEXTURE0);
+    return lod.indexCount / 3;
+}
+
+const MeshLod& Mesh::selectLod(float maxError)
+{
+    size_t level = 0;
+    while (level + 1 < lods.size() && lods[level + 1].error <= maxError) level++;
+    wantedLod = std::min(wantedLod, level);
+    return lods[std::max(level, loadedLod)];
 }
 
-void Mesh::Draw(Shader& shader)
+size_t Mesh::refine(size_t maxBytes)
+{
+    size_t uploaded = 0;
+    while (loadedLod > wantedLod && uploaded < maxBytes) {
+        uploaded += uploadLevel(loadedLod - 1);
+    }
+    // Detail that is no longer drawn is not fetched; the next draws ask again
+    wantedLod = lods.size() - 1;
+    return uploaded;
+}
+
+size_t Mesh::uploadLevel(size_t level)
+{
+    const MeshLod& lod = lods[level];
+    size_t bytes = 0;
+
+    // Each level only adds vertices at the end of the prefix the coarser levels use
+    if (lod.vertexCount > loadedVertices) {
+        std::vector<PackedVertex> packed = packVertices(sourceVertices + loadedVertices, lod.vertexCount - loadedVertices);
+        GeometryPool::shared().uploadVertices(geometry, loadedVertices, packed.data(), packed.size());
+        bytes += packed.size() * sizeof(PackedVertex);
+        loadedVertices = lod.vertexCount;
+    }
+
+    GeometryPool::shared().uploadIndices(geometry, lod.firstIndex, sourceIndices + lod.firstIndex, lod.indexCount);
+    bytes += lod.indexCount * (geometry.shortIndices ? sizeof(uint16_t) : sizeof(unsigned int));
+    loadedLod = level;
+    return bytes;
+}
+
+void Mesh::release()
+{
+    GeometryPool::shared().release(geometry);
+    geometry = GeometryPool::Range();
+}
+
+void Mesh::bindTextures(Shader& shader, const std::vector<Texture>& textures)
 {
-    // Bind appropriate textures
     unsigned int diffuseNr = 1;
     unsigned int specularNr = 1;
     unsigned int normalNr = 1;
     unsigned int heightNr = 1;
 
+    // Only the maps a mesh has are sampled; the shader variant is chosen to match
+    bool hasDiffuse = false, hasSpecular = false, hasNormal = false;
+    for (const Texture& texture : textures) {
+        hasDiffuse = hasDiffuse || texture.type == "texture_diffuse";
+        hasSpecular = hasSpecular || texture.type == "texture_specular";
+        hasNormal = hasNormal || texture.type == "texture_normal";
+    }
+    shader.setFeatures({ { "HAS_TEXTURE", hasDiffuse }, { "HAS_SPECULAR_MAP", hasSpecular }, { "HAS_NORMAL_MAP", hasNormal } });
+
     for (unsigned int i = 0; i < textures.size(); i++)
     {
         glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
@@ -41,56 +182,55 @@ void Mesh::Draw(Shader& shader)
         // And finally bind the texture
         glBindTexture(GL_TEXTURE_2D, textures[i].id);
     }
+}
 
-    // Draw mesh
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+void Mesh::setTransform(Shader& shader, const glm::mat4& model)
+{
+    shader.setMat4("model", model);
+    shader.setMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
+}
 
-    // Always good practice to set everything back to defaults once configured.
-    glActiveTexture(GL_TEXTURE0);
+void Mesh::setPositionDequantization(Shader& shader, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    shader.setBool("packedVertex", true);
+    shader.setVec3("positionOffset", boundsMin);
+    shader.setVec3("positionScale", boundsMax - boundsMin);
 }
 
-void Mesh::setupMesh()
+void Mesh::setupMesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount)
 {
-    // Create buffers/arrays
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    glBindVertexArray(VAO);
-    
-    // Load data into vertex buffers
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    
-    // A great thing about structs is that their memory layout is sequential for all its items.
-    // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-    // again translates to 3/2 floats which translates to a byte array.
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-    // Set the vertex attribute pointers
-    // Vertex Positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    
-    // Vertex normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-    
-    // Vertex texture coords
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-    
-    // Vertex tangent
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-    
-    // Vertex bitangent
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+    std::vector<PackedVertex> packed = packVertices(vertexData, vertexCount);
+    geometry = GeometryPool::shared().allocate(packed.data(), vertexCount, indexData, indexCount);
+}
 
-    glBindVertexArray(0);
+std::vector<PackedVertex> Mesh::packVertices(const Vertex* vertexData, size_t vertexCount) const
+{
+    glm::vec3 positionScale = boundsMax - boundsMin;
+
+    std::vector<PackedVertex> packed(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const Vertex& vertex = vertexData[i];
+        PackedVertex& out = packed[i];
+
+        for (int c = 0; c < 3; ++c) {
+            float relative = positionScale[c] > 0.0f ? (vertex.Position[c] - boundsMin[c]) / positionScale[c] : 0.0f;
+            out.position[c] = glm::packUnorm1x16(relative);
+        }
+        out.position[3] = 0;
+
+        glm::vec3 normal = glm::length(vertex.Normal) > 1e-6f ? glm::normalize(vertex.Normal) : glm::vec3(0.0f, 0.0f, 1.0f);
+        glm::vec2 octahedral = encodeOctahedral(normal);
+        out.normal[0] = static_cast<int16_t>(glm::packSnorm1x16(octahedral.x));
+        out.normal[1] = static_cast<int16_t>(glm::packSnorm1x16(octahedral.y));
+
+        out.texCoords[0] = glm::packHalf1x16(vertex.TexCoords.x);
+        out.texCoords[1] = glm::packHalf1x16(vertex.TexCoords.y);
+
+        glm::quat frame = encodeTangentFrame(normal, vertex.Tangent, vertex.Bitangent);
+        out.tangentFrame[0] = static_cast<int8_t>(glm::packSnorm1x8(frame.x));
+        out.tangentFrame[1] = static_cast<int8_t>(glm::packSnorm1x8(frame.y));
+        out.tangentFrame[2] = static_cast<int8_t>(glm::packSnorm1x8(frame.z));
+        out.tangentFrame[3] = static_cast<int8_t>(glm::packSnorm1x8(frame.w));
+    }
+    return packed;
 }
@@ -5,7 +5,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <string>
 #include <vector>
+#include <cstdint>
 #include "Shader.h"
+#include "GeometryPool.h"
 
 // Vertex structure for mesh data
 struct Vertex {
@@ -16,6 +18,24 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+// GPU layout of a Vertex, 20 bytes instead of 56. Mesh::setupMesh packs the vertices into the
+// GeometryPool; shader.vert and gbuffer.vert decode them when packedVertex is set.
+struct PackedVertex {
+    uint16_t position[4];   // unorm16 within the mesh's bounding box; [3] is padding
+    int16_t normal[2];      // snorm16 octahedral encoding
+    uint16_t texCoords[2];  // Half floats
+    int8_t tangentFrame[4]; // snorm8 quaternion rotating (X, Y, Z) onto (tangent, bitangent, normal);
+                            // w < 0 flips the bitangent for mirrored UVs
+};
+
+// One level of detail: a range of the mesh's index buffer drawn with the shared vertices
+struct MeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;            // Bound on the deviation from LOD 0, in model units
+    uint32_t vertexCount;   // The level only uses the first vertexCount vertices
+};
+
 // Texture structure
 struct Texture {
     unsigned int id;
@@ -27,20 +47,76 @@ class Mesh {
 public:
     // Mesh Data
     std::vector<Vertex>       vertices;
-    std::vector<unsigned int> indices;
+    std::vector<unsigned int> indices;    // Every LOD level, coarsest first
     std::vector<Texture>      textures;
-    unsigned int VAO;
+    std::vector<MeshLod>      lods;       // By increasing error; a single level spanning indices if none are given
+
+    // Constructor. Positions are quantized within [boundsMin, boundsMax]; the meshes of a model
+    // share its bounds so they can be drawn together (see Model::Draw).
+    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures,
+         const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::vector<MeshLod> lods = std::vector<MeshLod>());
+
+    // Streams the given arrays (e.g. a memory-mapped mesh cache) without keeping a CPU copy; they
+    // must stay valid for the life of the mesh. Room for every level is reserved in the
+    // GeometryPool but only the coarsest one is uploaded here, so the mesh can be drawn at once;
+    // refine() uploads the finer levels in place when they are needed. vertices/indices stay
+    // empty for such meshes.
+    Mesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount,
+         std::vector<Texture> textures, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+         std::vector<MeshLod> lods = std::vector<MeshLod>());
+
+    // Render the mesh with the coarsest LOD whose error is at most maxError (model units).
+    // Returns the number of triangles drawn.
+    size_t Draw(Shader& shader, float maxError = 0.0f);
+
+    // Coarsest level whose error is at most maxError, or the finest uploaded level if that one is
+    // coarser. Remembers the level asked for so that refine() can upload it.
+    const MeshLod& selectLod(float maxError);
 
-    // Constructor
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
+    // Uploads the finer levels asked for by selectLod() since the last call, coarse to fine,
+    // until at least maxBytes have been uploaded (a level is never split). Returns the bytes uploaded.
+    size_t refine(size_t maxBytes);
 
-    // Render the mesh
-    void Draw(Shader& shader);
+    // Whether every level is on the GPU
+    bool isComplete() const { return loadedLod == 0; }
+
+    // Where the mesh lives in the GeometryPool
+    const GeometryPool::Range& getGeometry() const { return geometry; }
+
+    // Returns the geometry to the pool. Meshes are copied around by value, so the owner calls
+    // this once instead of a destructor.
+    void release();
+
+    // Binds the textures to consecutive units and points the shader's samplers at them. Selects
+    // the HAS_TEXTURE / HAS_SPECULAR_MAP / HAS_NORMAL_MAP variant that samples exactly the maps bound.
+    static void bindTextures(Shader& shader, const std::vector<Texture>& textures);
+
+    // Model matrix of a draw that is not instanced, with the normal matrix shader.vert and
+    // gbuffer.vert would otherwise invert per vertex
+    static void setTransform(Shader& shader, const glm::mat4& model);
+
+    // Dequantization uniforms read by shader.vert and gbuffer.vert
+    static void setPositionDequantization(Shader& shader, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
 
 private:
     // Render data
-    unsigned int VBO, EBO;
+    GeometryPool::Range geometry;
+    glm::vec3 boundsMin, boundsMax;
+
+    // Progressive upload state: the source arrays of a streamed mesh (null otherwise), the finest
+    // level on the GPU with the vertex prefix it needs, and the finest level asked for
+    const Vertex* sourceVertices = nullptr;
+    const unsigned int* sourceIndices = nullptr;
+    size_t loadedLod = 0;
+    uint32_t loadedVertices = 0;
+    size_t wantedLod = 0;
+
+    // Packs the vertices and copies them and the indices into the GeometryPool
+    void setupMesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount);
+
+    // Quantizes vertices into the GPU layout
+    std::vector<PackedVertex> packVertices(const Vertex* vertexData, size_t vertexCount) const;
 
-    // Initialize all the buffer objects/arrays
-    void setupMesh();
+    // Uploads one level of a streamed mesh and the vertices it adds. Returns the bytes uploaded.
+    size_t uploadLevel(size_t level);
 };
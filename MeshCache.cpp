@@ -0,0 +1,355 @@
+#include "MeshCache.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+
+namespace {
+    struct CacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceHash;
+        uint32_t importFlags;
+        uint32_t meshCount;
+        uint32_t textureCount;
+        uint32_t stringBytes;
+        uint32_t imageCount;
+        uint32_t lodCount;
+        float boundsMin[3];
+        float boundsMax[3];
+        uint64_t vertexDataOffset;
+        uint64_t vertexCount;
+        uint64_t indexDataOffset;
+        uint64_t indexCount;
+    };
+
+    // Vertex data is aligned so it can be read in place from the mapping
+    const uint64_t DATA_ALIGNMENT = 16;
+
+    static_assert(sizeof(Vertex) == 56, "Vertex is stored in the cache as-is");
+    static_assert(sizeof(MeshLod) == 16, "MeshLod is stored in the cache as-is");
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+struct MeshCache::MeshRecord {
+    uint64_t firstVertex;
+    uint64_t vertexCount;
+    uint64_t firstIndex;
+    uint64_t indexCount;
+    uint32_t firstTexture;
+    uint32_t textureCount;
+    uint32_t firstLod;
+    uint32_t lodCount;
+};
+
+struct MeshCache::TextureRecord {
+    uint32_t typeOffset;
+    uint32_t typeLength;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+};
+
+struct MeshCache::ImageRecord {
+    uint32_t pathOffset;
+    uint32_t pathLength;
+    uint64_t dataOffset;    // From the start of the file
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+bool MeshCache::hashFile(const std::string& path, uint64_t& hash)
+{
+    MappedFile source;
+    if (!source.open(path)) return false;
+    std::unique_ptr<MappedView> bytes = source.mapAll();
+    if (!bytes) return false;
+
+    hash = hashBytes(bytes->data(), bytes->size());
+    return true;
+}
+
+uint64_t MeshCache::hashBytes(const unsigned char* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool MeshCache::write(const std::string& cachePath, uint64_t sourceHash, uint32_t importFlags,
+                      const std::vector<MeshSource>& meshes, const std::vector<EmbeddedImage>& images,
+                      const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    std::vector<MeshRecord> meshRecords;
+    std::vector<TextureRecord> textureRecords;
+    std::vector<ImageRecord> imageRecords;
+    std::vector<MeshLod> lodRecords;
+    std::string stringTable;
+    uint64_t totalVertices = 0, totalIndices = 0;
+
+    for (const MeshSource& mesh : meshes) {
+        MeshRecord record;
+        record.firstVertex = totalVertices;
+        record.vertexCount = mesh.vertexCount;
+        record.firstIndex = totalIndices;
+        record.indexCount = mesh.indexCount;
+        record.firstTexture = static_cast<uint32_t>(textureRecords.size());
+        record.textureCount = static_cast<uint32_t>(mesh.textures->size());
+        record.firstLod = static_cast<uint32_t>(lodRecords.size());
+        record.lodCount = static_cast<uint32_t>(mesh.lods->size());
+        meshRecords.push_back(record);
+        lodRecords.insert(lodRecords.end(), mesh.lods->begin(), mesh.lods->end());
+
+        for (const TextureBinding& texture : *mesh.textures) {
+            TextureRecord binding;
+            binding.typeOffset = static_cast<uint32_t>(stringTable.size());
+            binding.typeLength = static_cast<uint32_t>(texture.type.size());
+            stringTable += texture.type;
+            binding.pathOffset = static_cast<uint32_t>(stringTable.size());
+            binding.pathLength = static_cast<uint32_t>(texture.path.size());
+            stringTable += texture.path;
+            textureRecords.push_back(binding);
+        }
+
+        totalVertices += mesh.vertexCount;
+        totalIndices += mesh.indexCount;
+    }
+
+    for (const EmbeddedImage& image : images) {
+        ImageRecord record = {};
+        record.pathOffset = static_cast<uint32_t>(stringTable.size());
+        record.pathLength = static_cast<uint32_t>(image.path.size());
+        stringTable += image.path;
+        record.size = image.size;
+        record.width = image.width;
+        record.height = image.height;
+        imageRecords.push_back(record);
+    }
+
+    CacheHeader header = {};
+    std::memcpy(header.magic, "MSHC", 4);
+    header.version = FORMAT_VERSION;
+    header.sourceHash = sourceHash;
+    header.importFlags = importFlags;
+    header.meshCount = static_cast<uint32_t>(meshRecords.size());
+    header.textureCount = static_cast<uint32_t>(textureRecords.size());
+    header.stringBytes = static_cast<uint32_t>(stringTable.size());
+    header.imageCount = static_cast<uint32_t>(imageRecords.size());
+    header.lodCount = static_cast<uint32_t>(lodRecords.size());
+    std::memcpy(header.boundsMin, &boundsMin[0], sizeof(header.boundsMin));
+    std::memcpy(header.boundsMax, &boundsMax[0], sizeof(header.boundsMax));
+
+    uint64_t tablesEnd = sizeof(CacheHeader) + meshRecords.size() * sizeof(MeshRecord) +
+                         textureRecords.size() * sizeof(TextureRecord) + imageRecords.size() * sizeof(ImageRecord) +
+                         lodRecords.size() * sizeof(MeshLod) + stringTable.size();
+    header.vertexDataOffset = alignUp(tablesEnd, DATA_ALIGNMENT);
+    header.vertexCount = totalVertices;
+    header.indexDataOffset = header.vertexDataOffset + totalVertices * sizeof(Vertex);
+    header.indexCount = totalIndices;
+
+    // Images follow the indices, each aligned like the vertex data
+    uint64_t fileEnd = header.indexDataOffset + totalIndices * sizeof(unsigned int);
+    for (ImageRecord& record : imageRecords) {
+        record.dataOffset = alignUp(fileEnd, DATA_ALIGNMENT);
+        fileEnd = record.dataOffset + record.size;
+    }
+
+    // Write to a temporary file and swap it in, so a crash never leaves a half-written cache
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cout << "ERROR::MESH_CACHE:: Cannot write " << tempPath << std::endl;
+            return false;
+        }
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(meshRecords.data()), meshRecords.size() * sizeof(MeshRecord));
+        out.write(reinterpret_cast<const char*>(textureRecords.data()), textureRecords.size() * sizeof(TextureRecord));
+        out.write(reinterpret_cast<const char*>(imageRecords.data()), imageRecords.size() * sizeof(ImageRecord));
+        out.write(reinterpret_cast<const char*>(lodRecords.data()), lodRecords.size() * sizeof(MeshLod));
+        out.write(stringTable.data(), stringTable.size());
+
+        static const char zeros[DATA_ALIGNMENT] = {};
+        out.write(zeros, static_cast<std::streamsize>(header.vertexDataOffset - tablesEnd));
+
+        for (const MeshSource& mesh : meshes) {
+            out.write(reinterpret_cast<const char*>(mesh.vertices), mesh.vertexCount * sizeof(Vertex));
+        }
+        for (const MeshSource& mesh : meshes) {
+            out.write(reinterpret_cast<const char*>(mesh.indices), mesh.indexCount * sizeof(unsigned int));
+        }
+
+        uint64_t written = header.indexDataOffset + totalIndices * sizeof(unsigned int);
+        for (size_t i = 0; i < images.size(); ++i) {
+            out.write(zeros, static_cast<std::streamsize>(imageRecords[i].dataOffset - written));
+            out.write(reinterpret_cast<const char*>(images[i].data), static_cast<std::streamsize>(images[i].size));
+            written = imageRecords[i].dataOffset + imageRecords[i].size;
+        }
+
+        if (!out) {
+            std::cout << "ERROR::MESH_CACHE:: Write failed: " << tempPath << std::endl;
+            out.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    std::remove(cachePath.c_str());
+    if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+        std::cout << "ERROR::MESH_CACHE:: Cannot replace " << cachePath << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool MeshCache::open(const std::string& cachePath, uint64_t sourceHash, uint32_t importFlags)
+{
+    view.reset();
+    meshCount = 0;
+    imageCount = 0;
+
+    if (!file.open(cachePath)) return false;
+    if (file.size() < sizeof(CacheHeader)) return false;
+
+    view = file.mapAll();
+    if (!view) return false;
+
+    CacheHeader header;
+    std::memcpy(&header, view->data(), sizeof(header));
+    if (std::memcmp(header.magic, "MSHC", 4) != 0 || header.version != FORMAT_VERSION ||
+        header.sourceHash != sourceHash || header.importFlags != importFlags) {
+        view.reset();
+        return false;
+    }
+
+    uint64_t tablesEnd = sizeof(CacheHeader) + static_cast<uint64_t>(header.meshCount) * sizeof(MeshRecord) +
+                         static_cast<uint64_t>(header.textureCount) * sizeof(TextureRecord) +
+                         static_cast<uint64_t>(header.imageCount) * sizeof(ImageRecord) +
+                         static_cast<uint64_t>(header.lodCount) * sizeof(MeshLod) + header.stringBytes;
+    uint64_t indexEnd = header.indexDataOffset + header.indexCount * sizeof(unsigned int);
+    if (tablesEnd > file.size() || header.vertexDataOffset < tablesEnd || header.vertexDataOffset % DATA_ALIGNMENT != 0 ||
+        header.indexDataOffset != header.vertexDataOffset + header.vertexCount * sizeof(Vertex) ||
+        indexEnd > file.size() || (header.imageCount == 0 && indexEnd != file.size())) {
+        std::cout << "ERROR::MESH_CACHE:: Corrupt cache file: " << cachePath << std::endl;
+        view.reset();
+        return false;
+    }
+
+    const unsigned char* base = view->data();
+    meshRecords = reinterpret_cast<const MeshRecord*>(base + sizeof(CacheHeader));
+    textureRecords = reinterpret_cast<const TextureRecord*>(meshRecords + header.meshCount);
+    imageRecords = reinterpret_cast<const ImageRecord*>(textureRecords + header.textureCount);
+    lodRecords = reinterpret_cast<const MeshLod*>(imageRecords + header.imageCount);
+    strings = reinterpret_cast<const char*>(lodRecords + header.lodCount);
+    vertexData = reinterpret_cast<const Vertex*>(base + header.vertexDataOffset);
+    indexData = reinterpret_cast<const unsigned int*>(base + header.indexDataOffset);
+
+    // Every range must lie inside the file before anything is handed to GL
+    for (uint32_t i = 0; i < header.meshCount; ++i) {
+        const MeshRecord& record = meshRecords[i];
+        if (record.firstVertex + record.vertexCount > header.vertexCount ||
+            record.firstIndex + record.indexCount > header.indexCount ||
+            record.firstTexture + record.textureCount > header.textureCount ||
+            record.lodCount == 0 || static_cast<uint64_t>(record.firstLod) + record.lodCount > header.lodCount) {
+            std::cout << "ERROR::MESH_CACHE:: Corrupt mesh table: " << cachePath << std::endl;
+            view.reset();
+            return false;
+        }
+        for (uint32_t l = 0; l < record.lodCount; ++l) {
+            const MeshLod& lod = lodRecords[record.firstLod + l];
+            if (static_cast<uint64_t>(lod.firstIndex) + lod.indexCount > record.indexCount || lod.vertexCount > record.vertexCount) {
+                std::cout << "ERROR::MESH_CACHE:: Corrupt LOD table: " << cachePath << std::endl;
+                view.reset();
+                return false;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < header.textureCount; ++i) {
+        const TextureRecord& record = textureRecords[i];
+        if (static_cast<uint64_t>(record.typeOffset) + record.typeLength > header.stringBytes ||
+            static_cast<uint64_t>(record.pathOffset) + record.pathLength > header.stringBytes) {
+            std::cout << "ERROR::MESH_CACHE:: Corrupt texture table: " << cachePath << std::endl;
+            view.reset();
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header.imageCount; ++i) {
+        const ImageRecord& record = imageRecords[i];
+        if (static_cast<uint64_t>(record.pathOffset) + record.pathLength > header.stringBytes ||
+            record.dataOffset < indexEnd || record.dataOffset + record.size > file.size() ||
+            (record.height != 0 && record.size != static_cast<uint64_t>(record.width) * record.height * 4)) {
+            std::cout << "ERROR::MESH_CACHE:: Corrupt image table: " << cachePath << std::endl;
+            view.reset();
+            return false;
+        }
+    }
+
+    meshCount = header.meshCount;
+    imageCount = header.imageCount;
+    boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    return true;
+}
+
+const Vertex* MeshCache::getVertices(size_t mesh) const
+{
+    return vertexData + meshRecords[mesh].firstVertex;
+}
+
+size_t MeshCache::getVertexCount(size_t mesh) const
+{
+    return static_cast<size_t>(meshRecords[mesh].vertexCount);
+}
+
+const unsigned int* MeshCache::getIndices(size_t mesh) const
+{
+    return indexData + meshRecords[mesh].firstIndex;
+}
+
+size_t MeshCache::getIndexCount(size_t mesh) const
+{
+    return static_cast<size_t>(meshRecords[mesh].indexCount);
+}
+
+std::vector<MeshCache::TextureBinding> MeshCache::getTextures(size_t mesh) const
+{
+    std::vector<TextureBinding> bindings;
+    const MeshRecord& record = meshRecords[mesh];
+    for (uint32_t i = 0; i < record.textureCount; ++i) {
+        const TextureRecord& texture = textureRecords[record.firstTexture + i];
+        bindings.push_back({ std::string(strings + texture.typeOffset, texture.typeLength),
+                             std::string(strings + texture.pathOffset, texture.pathLength) });
+    }
+    return bindings;
+}
+
+std::vector<MeshLod> MeshCache::getLods(size_t mesh) const
+{
+    const MeshRecord& record = meshRecords[mesh];
+    return std::vector<MeshLod>(lodRecords + record.firstLod, lodRecords + record.firstLod + record.lodCount);
+}
+
+bool MeshCache::findEmbeddedImage(const std::string& path, EmbeddedImage& image) const
+{
+    for (size_t i = 0; i < imageCount; ++i) {
+        const ImageRecord& record = imageRecords[i];
+        if (path.compare(0, std::string::npos, strings + record.pathOffset, record.pathLength) != 0) continue;
+
+        image.path = path;
+        image.data = view->data() + record.dataOffset;
+        image.size = static_cast<size_t>(record.size);
+        image.width = record.width;
+        image.height = record.height;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "Mesh.h"
+#include "MappedFile.h"
+
+// Binary cache of a model's final mesh data, written next to the model as "<model>.meshcache".
+// The file holds the processed Vertex arrays, indices of every LOD level, texture bindings and
+// bounding box in the exact in-memory layout, so a warm load maps it and hands the vertex/index
+// ranges straight to the GeometryPool without running Assimp. Each mesh is stored coarse to fine
+// (see MeshSimplifier::buildLodChain), so drawing it coarsely only pages in the start of its
+// vertex and index ranges and finer levels are read when Mesh::refine uploads them. It is keyed by an FNV-1a hash of the
+// source file's bytes plus the import flags, so any change to the model (or to how it is
+// imported) rebuilds it.
+class MeshCache {
+public:
+    static const uint32_t FORMAT_VERSION = 6;   // 3: meshes are stored after MeshOptimizer, 4: LOD chains,
+                                                // 5: coarsest level first with per-level vertex prefixes,
+                                                // 6: LOD errors are maximum plane distances
+
+    struct TextureBinding {
+        std::string type;   // Sampler prefix, e.g. "texture_diffuse"
+        std::string path;   // Path as stored in the model's material
+    };
+
+    // Geometry of one mesh to be written
+    struct MeshSource {
+        const Vertex* vertices;
+        size_t vertexCount;
+        const unsigned int* indices;
+        size_t indexCount;
+        const std::vector<TextureBinding>* textures;
+        const std::vector<MeshLod>* lods;   // Ranges of indices
+    };
+
+    // Image stored inside the model file (e.g. a GLB's binary chunk), kept in the cache so warm
+    // starts can decode it from the mapping. height == 0 means data holds an encoded file
+    // (PNG, JPEG, ...) of size bytes; otherwise it is width * height BGRA texels.
+    struct EmbeddedImage {
+        std::string path;   // Path as referenced by the materials, e.g. "*0"
+        const unsigned char* data;
+        size_t size;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    static std::string cachePathFor(const std::string& modelPath) { return modelPath + ".meshcache"; }
+
+    // 64-bit FNV-1a over the file's contents. Returns false if the file cannot be read.
+    static bool hashFile(const std::string& path, uint64_t& hash);
+    static uint64_t hashBytes(const unsigned char* data, size_t size);
+
+    // Write the cache for a loaded model
+    static bool write(const std::string& cachePath, uint64_t sourceHash, uint32_t importFlags,
+                      const std::vector<MeshSource>& meshes, const std::vector<EmbeddedImage>& images,
+                      const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+    // Map a cache file. Fails if it is missing, corrupt or was made from a different source/flags.
+    bool open(const std::string& cachePath, uint64_t sourceHash, uint32_t importFlags);
+
+    size_t getMeshCount() const { return meshCount; }
+    const Vertex* getVertices(size_t mesh) const;
+    size_t getVertexCount(size_t mesh) const;
+    const unsigned int* getIndices(size_t mesh) const;
+    size_t getIndexCount(size_t mesh) const;
+    std::vector<TextureBinding> getTextures(size_t mesh) const;
+    std::vector<MeshLod> getLods(size_t mesh) const;
+
+    // Embedded image referenced under this path; data points into the mapping
+    bool findEmbeddedImage(const std::string& path, EmbeddedImage& image) const;
+
+    // Size of the mapping, i.e. the most the cache can keep resident
+    size_t getMappedBytes() const { return view ? view->size() : 0; }
+
+    glm::vec3 getBoundsMin() const { return boundsMin; }
+    glm::vec3 getBoundsMax() const { return boundsMax; }
+
+private:
+    struct MeshRecord;
+    struct TextureRecord;
+    struct ImageRecord;
+
+    MappedFile file;
+    std::unique_ptr<MappedView> view;
+    size_t meshCount = 0;
+    const MeshRecord* meshRecords = nullptr;
+    const TextureRecord* textureRecords = nullptr;
+    const ImageRecord* imageRecords = nullptr;
+    size_t imageCount = 0;
+    const MeshLod* lodRecords = nullptr;
+    const char* strings = nullptr;
+    const Vertex* vertexData = nullptr;
+    const unsigned int* indexData = nullptr;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+};
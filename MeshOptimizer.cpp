@@ -0,0 +1,295 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+namespace {
+    const unsigned int NONE = ~0u;
+
+    // A cluster may be split as long as restarting the cache costs at most this much extra ACMR
+    const float OVERDRAW_THRESHOLD = 1.05f;
+
+    // FIFO post-transform cache simulation. A vertex hits if it was inserted within the last
+    // CACHE_SIZE misses; flush() makes every vertex miss again.
+    class FifoCache {
+    public:
+        explicit FifoCache(size_t vertexCount) : insertedAt(vertexCount, 0) {}
+
+        bool access(unsigned int vertex)
+        {
+            if (time - insertedAt[vertex] <= MeshOptimizer::CACHE_SIZE) return true;
+            insertedAt[vertex] = time++;
+            return false;
+        }
+
+        void flush() { time += MeshOptimizer::CACHE_SIZE; }
+
+    private:
+        std::vector<unsigned int> insertedAt;
+        unsigned int time = MeshOptimizer::CACHE_SIZE + 1;
+    };
+
+    size_t vertexHash(const Vertex& vertex)
+    {
+        uint32_t words[sizeof(Vertex) / 4];
+        std::memcpy(words, &vertex, sizeof(words));
+        uint32_t hash = 2166136261u;
+        for (uint32_t word : words) {
+            hash = (hash ^ word) * 16777619u;
+        }
+        return hash ^ (hash >> 15);
+    }
+
+    // Returns the next vertex to fan around when the candidates from the last fan are exhausted:
+    // the most recently emitted vertex with triangles left, or else the next one in index order
+    unsigned int skipDeadEnd(std::vector<unsigned int>& deadEnd, const std::vector<unsigned int>& live, size_t& cursor)
+    {
+        while (!deadEnd.empty()) {
+            unsigned int vertex = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[vertex] > 0) return vertex;
+        }
+        for (; cursor < live.size(); ++cursor) {
+            if (live[cursor] > 0) return static_cast<unsigned int>(cursor);
+        }
+        return NONE;
+    }
+}
+
+MeshOptimizer::Report MeshOptimizer::optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    Report report;
+    report.verticesBefore = vertices.size();
+    report.trianglesBefore = indices.size() / 3;
+    report.acmrBefore = analyzeVertexCache(indices, vertices.size());
+
+    weldVertices(vertices, indices);
+    std::vector<size_t> clusterStarts;
+    optimizeVertexCache(indices, vertices.size(), &clusterStarts);
+    optimizeOverdraw(indices, vertices, clusterStarts);
+    optimizeVertexFetch(vertices, indices);
+
+    report.verticesAfter = vertices.size();
+    report.trianglesAfter = indices.size() / 3;
+    report.acmrAfter = analyzeVertexCache(indices, vertices.size());
+    return report;
+}
+
+void MeshOptimizer::weldVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    if (vertices.empty()) return;
+
+    // Open-addressing table of unique vertices, at most half full
+    size_t tableSize = 1;
+    while (tableSize < vertices.size() * 2) tableSize *= 2;
+    std::vector<unsigned int> table(tableSize, NONE);
+
+    std::vector<unsigned int> remap(vertices.size());
+    std::vector<Vertex> unique;
+    unique.reserve(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        size_t slot = vertexHash(vertices[i]) & (tableSize - 1);
+        while (table[slot] != NONE && std::memcmp(&unique[table[slot]], &vertices[i], sizeof(Vertex)) != 0) {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (table[slot] == NONE) {
+            table[slot] = static_cast<unsigned int>(unique.size());
+            unique.push_back(vertices[i]);
+        }
+        remap[i] = table[slot];
+    }
+
+    // Welding can collapse thin triangles onto an edge; they would only cost vertex work
+    size_t kept = 0;
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        unsigned int a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+        if (a == b || b == c || a == c) continue;
+        indices[kept++] = a;
+        indices[kept++] = b;
+        indices[kept++] = c;
+    }
+    indices.resize(kept);
+    vertices.swap(unique);
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount,
+                                        std::vector<size_t>* clusterStarts)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return;
+
+    // Vertex -> triangle adjacency; live counts the triangles of each vertex not yet emitted
+    std::vector<unsigned int> live(vertexCount, 0);
+    for (unsigned int index : indices) live[index]++;
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) offsets[v + 1] = offsets[v] + live[v];
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    deadEnd.reserve(indices.size());
+
+    unsigned int timestamp = CACHE_SIZE + 1;
+    size_t cursor = 0;
+    bool clusterStart = true;
+    unsigned int fanning = skipDeadEnd(deadEnd, live, cursor);
+    while (fanning != NONE) {
+        if (clusterStart && clusterStarts) clusterStarts->push_back(result.size() / 3);
+
+        // Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (unsigned int a = offsets[fanning]; a < offsets[fanning + 1]; ++a) {
+            unsigned int triangle = adjacency[a];
+            if (emitted[triangle]) continue;
+            emitted[triangle] = 1;
+            for (int k = 0; k < 3; ++k) {
+                unsigned int vertex = indices[triangle * 3 + k];
+                result.push_back(vertex);
+                deadEnd.push_back(vertex);
+                candidates.push_back(vertex);
+                live[vertex]--;
+                if (timestamp - cacheTime[vertex] > CACHE_SIZE) cacheTime[vertex] = timestamp++;
+            }
+        }
+
+        // Fan next around the candidate that is oldest in the cache but will still be there
+        // after its remaining triangles are emitted
+        unsigned int best = NONE;
+        int bestPriority = -1;
+        for (unsigned int vertex : candidates) {
+            if (live[vertex] == 0) continue;
+            int priority = 0;
+            if (timestamp - cacheTime[vertex] + 2 * live[vertex] <= CACHE_SIZE) {
+                priority = static_cast<int>(timestamp - cacheTime[vertex]);
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                best = vertex;
+            }
+        }
+
+        clusterStart = best == NONE;
+        fanning = clusterStart ? skipDeadEnd(deadEnd, live, cursor) : best;
+    }
+
+    indices.swap(result);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices,
+                                     const std::vector<size_t>& clusterStarts)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || clusterStarts.empty()) return;
+
+    // Split the cache clusters further where starting cold costs little, so the sort has
+    // finer pieces to work with
+    std::vector<size_t> pieces;
+    FifoCache cache(vertices.size());
+    for (size_t c = 0; c < clusterStarts.size(); ++c) {
+        size_t begin = clusterStarts[c];
+        size_t end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount;
+
+        cache.flush();
+        size_t clusterMisses = 0;
+        for (size_t i = begin * 3; i < end * 3; ++i) clusterMisses += cache.access(indices[i]) ? 0 : 1;
+        float clusterAcmr = static_cast<float>(clusterMisses) / (end - begin);
+
+        pieces.push_back(begin);
+        cache.flush();
+        size_t pieceStart = begin, pieceMisses = 0;
+        for (size_t t = begin; t < end; ++t) {
+            for (int k = 0; k < 3; ++k) pieceMisses += cache.access(indices[t * 3 + k]) ? 0 : 1;
+            size_t pieceTriangles = t + 1 - pieceStart;
+            if (t + 1 < end && static_cast<float>(pieceMisses) / pieceTriangles <= clusterAcmr * OVERDRAW_THRESHOLD) {
+                pieces.push_back(t + 1);
+                pieceStart = t + 1;
+                pieceMisses = 0;
+                cache.flush();
+            }
+        }
+    }
+
+    // Area-weighted centroid and normal of every piece
+    struct Piece {
+        size_t begin, end;
+        glm::vec3 centroid;
+        glm::vec3 normal;
+        float area;
+        float sortKey;
+    };
+    std::vector<Piece> sorted;
+    sorted.reserve(pieces.size());
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t p = 0; p < pieces.size(); ++p) {
+        Piece piece;
+        piece.begin = pieces[p];
+        piece.end = p + 1 < pieces.size() ? pieces[p + 1] : triangleCount;
+        piece.centroid = glm::vec3(0.0f);
+        piece.normal = glm::vec3(0.0f);
+        piece.area = 0.0f;
+        for (size_t t = piece.begin; t < piece.end; ++t) {
+            const glm::vec3& a = vertices[indices[t * 3]].Position;
+            const glm::vec3& b = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3& c = vertices[indices[t * 3 + 2]].Position;
+            glm::vec3 cross = glm::cross(b - a, c - a);
+            float area = glm::length(cross);
+            piece.centroid += (a + b + c) * (area / 3.0f);
+            piece.normal += cross;
+            piece.area += area;
+        }
+        meshCentroid += piece.centroid;
+        meshArea += piece.area;
+        if (piece.area > 0.0f) piece.centroid /= piece.area;
+        sorted.push_back(piece);
+    }
+    if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+    // Pieces far out along their own normal occlude the rest of the mesh; draw them first
+    for (Piece& piece : sorted) {
+        float normalLength = glm::length(piece.normal);
+        piece.sortKey = normalLength > 0.0f ? glm::dot(piece.centroid - meshCentroid, piece.normal / normalLength) : 0.0f;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Piece& a, const Piece& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (const Piece& piece : sorted) {
+        result.insert(result.end(), indices.begin() + piece.begin * 3, indices.begin() + piece.end * 3);
+    }
+    indices.swap(result);
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    std::vector<unsigned int> remap(vertices.size(), NONE);
+    std::vector<Vertex> ordered;
+    ordered.reserve(vertices.size());
+    for (unsigned int& index : indices) {
+        if (remap[index] == NONE) {
+            remap[index] = static_cast<unsigned int>(ordered.size());
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(ordered);
+}
+
+float MeshOptimizer::analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return 0.0f;
+
+    FifoCache cache(vertexCount);
+    size_t misses = 0;
+    for (unsigned int index : indices) misses += cache.access(index) ? 0 : 1;
+    return static_cast<float>(misses) / triangleCount;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include "Mesh.h"
+
+// Load-time optimization of indexed triangle meshes for the GPU:
+//  1. weld vertices with identical attributes and drop degenerate triangles,
+//  2. reorder triangles for the post-transform vertex cache (Tipsify, Sander et al. 2007),
+//  3. sort the resulting clusters so outward-facing ones are drawn first, reducing overdraw,
+//  4. renumber vertices in first-use order so vertex fetch walks memory linearly.
+// All steps keep the rendered surface and triangle winding unchanged.
+class MeshOptimizer {
+public:
+    // Entries in the simulated FIFO post-transform cache
+    static const unsigned int CACHE_SIZE = 16;
+
+    struct Report {
+        size_t verticesBefore = 0;
+        size_t verticesAfter = 0;
+        size_t trianglesBefore = 0;
+        size_t trianglesAfter = 0;
+        float acmrBefore = 0.0f;   // Average cache miss ratio: vertex shader runs per triangle
+        float acmrAfter = 0.0f;
+    };
+
+    // Runs every step in place. Thread-safe; meshes of one model can be optimized in parallel.
+    static Report optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+    // Merges bitwise identical vertices and removes triangles that reference a vertex twice
+    static void weldVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+    // Tipsify triangle order. Appends the first triangle of every cluster (a point where the
+    // cache had to restart) to clusterStarts when it is given.
+    static void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount,
+                                    std::vector<size_t>* clusterStarts = nullptr);
+
+    // Reorders whole clusters from optimizeVertexCache() front to back from the outside in
+    static void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices,
+                                 const std::vector<size_t>& clusterStarts);
+
+    // Renumbers vertices in the order the index buffer first uses them; unused ones are dropped
+    static void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+    // Vertex shader invocations per triangle for a FIFO cache of CACHE_SIZE entries (0.5 is ideal, 3 the worst)
+    static float analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount);
+};
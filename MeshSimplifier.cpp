@@ -0,0 +1,301 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+#include <cmath>
+
+namespace {
+    // Symmetric 4x4 quadric of squared plane distances, with the total plane weight
+    struct Quadric {
+        double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+        double b0 = 0, b1 = 0, b2 = 0;
+        double c = 0;
+        double weight = 0;
+
+        void addPlane(const glm::dvec3& n, double d, double w)
+        {
+            a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+            a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+            b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+            c += w * d * d;
+            weight += w;
+        }
+
+        void add(const Quadric& q)
+        {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2;
+            c += q.c;
+            weight += q.weight;
+        }
+
+        // Weighted mean squared distance of p to the planes
+        double error(const glm::vec3& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double sum = a00 * x * x + a11 * y * y + a22 * z * z +
+                         2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                         2.0 * (b0 * x + b1 * y + b2 * z) + c;
+            return weight > 0.0 ? std::max(sum, 0.0) / weight : 0.0;
+        }
+    };
+
+    struct Collapse {
+        unsigned int from;
+        unsigned int to;
+        double error;
+    };
+
+    uint64_t edgeKey(unsigned int a, unsigned int b)
+    {
+        return (static_cast<uint64_t>(a) << 32) | b;
+    }
+
+    struct PositionHash {
+        size_t operator()(const glm::vec3& p) const
+        {
+            uint32_t words[3];
+            std::memcpy(words, &p, sizeof(words));
+            return (words[0] * 73856093u) ^ (words[1] * 19349663u) ^ (words[2] * 83492791u);
+        }
+    };
+
+    // Would moving from onto to flip any triangle around from that survives the collapse?
+    bool flipsTriangle(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+                       const unsigned int* triangles, size_t triangleCount, unsigned int from, unsigned int to)
+    {
+        const glm::vec3& target = vertices[to].Position;
+        for (size_t i = 0; i < triangleCount; ++i) {
+            const unsigned int* corner = &indices[triangles[i] * 3];
+            if (corner[0] == to || corner[1] == to || corner[2] == to) continue;
+
+            glm::vec3 p[3], q[3];
+            for (int k = 0; k < 3; ++k) {
+                p[k] = vertices[corner[k]].Position;
+                q[k] = corner[k] == from ? target : p[k];
+            }
+            glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+            glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+            if (glm::dot(before, after) <= 0.0f) return true;
+        }
+        return false;
+    }
+}
+
+float MeshSimplifier::simplify(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, size_t targetIndexCount)
+{
+    size_t vertexCount = vertices.size();
+    if (indices.size() <= targetIndexCount || vertexCount == 0) return 0.0f;
+
+    // Vertices at the same position (seams) share one quadric and may not move
+    std::vector<unsigned int> positionId(vertexCount);
+    std::vector<unsigned int> positionUses;
+    {
+        std::unordered_map<glm::vec3, unsigned int, PositionHash> ids;
+        ids.reserve(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            auto inserted = ids.emplace(vertices[v].Position, static_cast<unsigned int>(positionUses.size()));
+            if (inserted.second) positionUses.push_back(0);
+            positionId[v] = inserted.first->second;
+            positionUses[positionId[v]]++;
+        }
+    }
+
+    std::vector<char> seam(vertexCount), locked(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        seam[v] = positionUses[positionId[v]] > 1;
+        locked[v] = seam[v];
+    }
+
+    // Border and non-manifold edges: every directed edge must have exactly one twin
+    {
+        std::unordered_map<uint64_t, unsigned int> edgeUses;
+        edgeUses.reserve(indices.size());
+        for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+            for (int k = 0; k < 3; ++k) {
+                edgeUses[edgeKey(positionId[indices[t + k]], positionId[indices[t + (k + 1) % 3]])]++;
+            }
+        }
+        for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+            for (int k = 0; k < 3; ++k) {
+                unsigned int a = indices[t + k], b = indices[t + (k + 1) % 3];
+                auto twin = edgeUses.find(edgeKey(positionId[b], positionId[a]));
+                if (edgeUses[edgeKey(positionId[a], positionId[b])] != 1 || twin == edgeUses.end() || twin->second != 1) {
+                    locked[a] = locked[b] = 1;
+                }
+            }
+        }
+    }
+
+    // Area-weighted plane quadrics, per position. The quadric only ranks collapses; the reported
+    // error is measured against the planes themselves, so each position also lists the input
+    // triangles whose planes it has absorbed.
+    std::vector<Quadric> quadrics(positionUses.size());
+    std::vector<glm::vec4> planes;
+    std::vector<std::vector<unsigned int>> positionPlanes(positionUses.size());
+    planes.reserve(indices.size() / 3);
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        glm::dvec3 p0(vertices[indices[t]].Position), p1(vertices[indices[t + 1]].Position), p2(vertices[indices[t + 2]].Position);
+        glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        double area = glm::length(normal);
+        if (area <= 0.0) continue;
+        normal /= area;
+        double d = -glm::dot(normal, p0);
+        unsigned int plane = static_cast<unsigned int>(planes.size());
+        planes.push_back(glm::vec4(glm::vec3(normal), static_cast<float>(d)));
+        for (int k = 0; k < 3; ++k) {
+            quadrics[positionId[indices[t + k]]].addPlane(normal, d, area);
+            positionPlanes[positionId[indices[t + k]]].push_back(plane);
+        }
+    }
+
+    float maxDistance = 0.0f;
+    std::vector<unsigned int> offsets(vertexCount + 1), adjacency, fill;
+    std::vector<char> touched(vertexCount);
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<Collapse> collapses;
+
+    while (indices.size() > targetIndexCount) {
+        // Vertex -> triangle adjacency for this pass
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (unsigned int index : indices) offsets[index + 1]++;
+        for (size_t v = 0; v < vertexCount; ++v) offsets[v + 1] += offsets[v];
+        adjacency.resize(indices.size());
+        fill.assign(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i) adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+
+        // Every edge from a movable vertex onto a vertex that has a single wedge
+        collapses.clear();
+        for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+            for (int k = 0; k < 3; ++k) {
+                unsigned int a = indices[t + k], b = indices[t + (k + 1) % 3];
+                for (int direction = 0; direction < 2; ++direction) {
+                    if (!locked[a] && !seam[b]) {
+                        Quadric combined = quadrics[positionId[a]];
+                        combined.add(quadrics[positionId[b]]);
+                        collapses.push_back({ a, b, combined.error(vertices[b].Position) });
+                    }
+                    std::swap(a, b);
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+        // Apply the cheapest collapses whose neighbourhoods do not overlap
+        std::fill(touched.begin(), touched.end(), 0);
+        for (size_t v = 0; v < vertexCount; ++v) remap[v] = static_cast<unsigned int>(v);
+        size_t removedIndices = 0, needed = indices.size() - targetIndexCount;
+        size_t applied = 0;
+        for (const Collapse& collapse : collapses) {
+            if (removedIndices >= needed) break;
+            if (touched[collapse.from] || touched[collapse.to]) continue;
+
+            const unsigned int* triangles = &adjacency[offsets[collapse.from]];
+            size_t triangleCount = offsets[collapse.from + 1] - offsets[collapse.from];
+            if (flipsTriangle(vertices, indices, triangles, triangleCount, collapse.from, collapse.to)) continue;
+
+            for (size_t i = 0; i < triangleCount; ++i) {
+                const unsigned int* corner = &indices[triangles[i] * 3];
+                for (int k = 0; k < 3; ++k) touched[corner[k]] = 1;
+                if (corner[0] == collapse.to || corner[1] == collapse.to || corner[2] == collapse.to) removedIndices += 3;
+            }
+            // Half-edge collapses never move the kept vertex, so its distance to the absorbed planes is final
+            unsigned int fromId = positionId[collapse.from], toId = positionId[collapse.to];
+            const glm::vec3& target = vertices[collapse.to].Position;
+            std::vector<unsigned int>& absorbed = positionPlanes[fromId];
+            for (unsigned int plane : absorbed) {
+                maxDistance = std::max(maxDistance, std::abs(glm::dot(glm::vec3(planes[plane]), target) + planes[plane].w));
+            }
+            positionPlanes[toId].insert(positionPlanes[toId].end(), absorbed.begin(), absorbed.end());
+            std::vector<unsigned int>().swap(absorbed);
+
+            remap[collapse.from] = collapse.to;
+            quadrics[toId].add(quadrics[fromId]);
+            applied++;
+        }
+        if (applied == 0) break;
+
+        size_t kept = 0;
+        for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+            unsigned int a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+            if (a == b || b == c || a == c) continue;
+            indices[kept++] = a;
+            indices[kept++] = b;
+            indices[kept++] = c;
+        }
+        indices.resize(kept);
+    }
+
+    return maxDistance;
+}
+
+void MeshSimplifier::buildLodChain(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                                   std::vector<MeshLod>& lods)
+{
+    uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    lods.clear();
+    lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f, vertexCount });
+
+    std::vector<unsigned int> current(indices);
+    float error = 0.0f;
+    while (lods.size() < MAX_LODS && current.size() / 3 >= MIN_LOD_TRIANGLES * 2) {
+        std::vector<unsigned int> next(current);
+        float levelError = simplify(vertices, next, current.size() / 6 * 3);
+
+        // Locked seams and borders can keep a mesh from shrinking; a near copy is not worth storing
+        if (next.size() > current.size() * 3 / 4) break;
+
+        // Deviations of successive levels add up, so this stays a bound relative to LOD 0
+        error += levelError;
+        MeshOptimizer::optimizeVertexCache(next, vertices.size());
+        lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(next.size()), error, vertexCount });
+        indices.insert(indices.end(), next.begin(), next.end());
+        current.swap(next);
+    }
+
+    orderForStreaming(vertices, indices, lods);
+}
+
+void MeshSimplifier::orderForStreaming(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                                       std::vector<MeshLod>& lods)
+{
+    // Coarsest level each vertex appears in (LOD 0 for unused ones)
+    std::vector<uint32_t> coarsestLevel(vertices.size(), 0);
+    for (size_t level = 1; level < lods.size(); ++level) {
+        for (uint32_t i = 0; i < lods[level].indexCount; ++i) {
+            coarsestLevel[indices[lods[level].firstIndex + i]] = static_cast<uint32_t>(level);
+        }
+    }
+
+    // Bucket the vertices coarsest level first, keeping the vertex cache order within a level
+    std::vector<uint32_t> levelStart(lods.size() + 1, 0);
+    for (uint32_t level : coarsestLevel) levelStart[level]++;
+    uint32_t start = 0;
+    for (size_t level = lods.size(); level-- > 0;) {
+        uint32_t count = levelStart[level];
+        levelStart[level] = start;
+        start += count;
+        lods[level].vertexCount = start;
+    }
+
+    std::vector<unsigned int> remap(vertices.size());
+    std::vector<Vertex> ordered(vertices.size());
+    for (size_t v = 0; v < vertices.size(); ++v) {
+        remap[v] = levelStart[coarsestLevel[v]]++;
+        ordered[remap[v]] = vertices[v];
+    }
+    vertices.swap(ordered);
+
+    std::vector<unsigned int> reordered;
+    reordered.reserve(indices.size());
+    for (size_t level = lods.size(); level-- > 0;) {
+        MeshLod& lod = lods[level];
+        uint32_t firstIndex = static_cast<uint32_t>(reordered.size());
+        for (uint32_t i = 0; i < lod.indexCount; ++i) {
+            reordered.push_back(remap[indices[lod.firstIndex + i]]);
+        }
+        lod.firstIndex = firstIndex;
+    }
+    indices.swap(reordered);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include "Mesh.h"
+
+// Quadric error metric simplification (Garland & Heckbert) by half-edge collapse. Only the index
+// buffer changes: every level reuses the mesh's vertices, so all LODs share one vertex buffer.
+// Vertices on borders, UV/normal seams and non-manifold edges never move, which keeps silhouettes
+// and texture charts intact at the cost of some reduction on heavily split meshes.
+class MeshSimplifier {
+public:
+    // Levels stop once a mesh gets this small or simplification stalls
+    static const size_t MAX_LODS = 6;
+    static const size_t MIN_LOD_TRIANGLES = 128;
+
+    // Collapses edges in order of increasing error until indices has at most targetIndexCount
+    // entries or nothing else can collapse. Returns the largest error introduced: the maximum
+    // distance from a kept vertex to the planes of the input triangles merged into it, in model units.
+    static float simplify(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, size_t targetIndexCount);
+
+    // Builds successively halved levels from indices (which holds LOD 0 on entry) and lists every
+    // level, LOD 0 included, in lods. Each level's index range is reordered for the vertex cache.
+    // The mesh is then laid out for streaming coarse to fine (see Mesh::refine): the vertices are
+    // ordered by the coarsest level using them, so every level needs only a prefix of them, and
+    // indices holds the levels coarsest first.
+    static void buildLodChain(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                              std::vector<MeshLod>& lods);
+
+private:
+    static void orderForStreaming(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                                  std::vector<MeshLod>& lods);
+};
@@ -2,6 +2,8 @@
 #include <iostream>
 #include <algorithm>
 #include <cmath>
+#include <cfloat>
+#include <cstddef>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
@@ -39,6 +41,8 @@ MobileRobot::~MobileRobot() {
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
+    glDeleteVertexArrays(1, &pointCloudVAO);
+    glDeleteBuffers(1, &pointCloudVBO);
 }
 
 void MobileRobot::setupPatrolPoints() {
@@ -79,6 +83,17 @@ void MobileRobot::initializeGeometry() {
     glEnableVertexAttribArray(2);
     
     glBindVertexArray(0);
+    
+    // Scanned point cloud (position + normal, appended as scan batches arrive)
+    glGenVertexArrays(1, &pointCloudVAO);
+    glGenBuffers(1, &pointCloudVBO);
+    glBindVertexArray(pointCloudVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, pointCloudVBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ScanPoint), (void*)offsetof(ScanPoint, position));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(ScanPoint), (void*)offsetof(ScanPoint, normal));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
 }
 
 void MobileRobot::generateRobotGeometry() {
@@ -255,27 +270,62 @@ void MobileRobot::updateArm(float deltaTime) {
     }
 }
 
-void MobileRobot::updateScanning(float deltaTime, const MuseumObjectManager& objectManager) {    if (arm.isScanning && arm.scanProgress > 0.5f && !lastScanResult.hasResult) {
-        // Check for nearby objects to scan with increased range for better detection
+void MobileRobot::updateScanning(float deltaTime, const MuseumObjectManager& objectManager) {
+    // Lock onto the closest exhibit when a scan starts
+    if (arm.isScanning && !scanner.isActive()) {
         int nearestObject = objectManager.findClosestObject(position, scanRange * 2.0f);
+        const MuseumObject* obj = nearestObject >= 0 ? objectManager.getObject(nearestObject) : nullptr;
         
-        if (nearestObject >= 0) {
-            const MuseumObject* obj = objectManager.getObject(nearestObject);
-            if (obj) {
-                lastScanResult.hasResult = true;
-                lastScanResult.objectName = obj->name;
-                lastScanResult.objectDescription = obj->description;
-                lastScanResult.objectPosition = obj->position;
-                lastScanResult.objectIndex = nearestObject;
-                lastScanResult.scanTime = glfwGetTime();
-                
-                std::cout << "Scanned object: " << obj->name << std::endl;
-                std::cout << "Scan result set, popup should appear!" << std::endl;
-            }
+        if (obj && obj->model) {
+            targetObjectPosition = obj->position; // Aim the sensor (and spotlight) at the exhibit
+            scanner.begin(obj->model, obj->getModelMatrix(), nearestObject);
+            uploadedPointCount = 0;
         } else {
             std::cout << "No object found within scan range. Try moving closer to an object." << std::endl;
+            stopScan();
+            return;
+        }
+    }
+    
+    if (scanner.isActive()) {
+        // updateArm ended the sweep: the last slices are still traced and merged over the next frames
+        if (!arm.isScanning) scanner.finish();
+        
+        // Sweep the sensor fan; rays are traced on the worker pool and merged when ready
+        scanner.update(calculateArmTipPosition(), getScanningSpotlightDirection(), arm.scanProgress, deltaTime);
+    }
+    
+    // Reported once, on the frame the final batch was merged
+    bool completed = scanner.takeCompleted();
+    if (completed) {
+        std::cout << "Scan captured " << scanner.getPoints().size() << " points from "
+                  << scanner.getRaysCast() << " rays" << std::endl;
+        if (scanner.getPoints().empty()) {
+            std::cout << "The scanner did not hit the object. Try moving closer to it." << std::endl;
         }
     }
+    if (!scanner.isActive() && !completed) return;
+    
+    const MuseumObject* obj = objectManager.getObject(scanner.getTargetObjectIndex());
+    if (!obj) return;
+    
+    // The exhibit is identified once the sensor has actually hit its surface
+    if (!lastScanResult.hasResult && !scanner.getPoints().empty() && (arm.scanProgress > 0.5f || completed)) {
+        lastScanResult.hasResult = true;
+        lastScanResult.objectName = obj->name;
+        lastScanResult.objectDescription = obj->description;
+        lastScanResult.objectPosition = obj->position;
+        lastScanResult.objectIndex = scanner.getTargetObjectIndex();
+        lastScanResult.scanTime = glfwGetTime();
+        
+        std::cout << "Scanned object: " << obj->name << std::endl;
+        std::cout << "Scan result set, popup should appear!" << std::endl;
+    }
+    
+    if (lastScanResult.hasResult && lastScanResult.objectIndex == scanner.getTargetObjectIndex()) {
+        lastScanResult.pointCount = scanner.getPoints().size();
+        lastScanResult.raysCast = scanner.getRaysCast();
+    }
 }
 
 void MobileRobot::updateAutoPatrol(float deltaTime, const MuseumObjectManager& objectManager) {
@@ -369,7 +419,7 @@ void MobileRobot::render(Shader& shader) {
     shader.setVec3("material.diffuse", 0.4f, 0.4f, 0.6f);
     shader.setVec3("material.specular", 0.8f, 0.8f, 0.9f);
     shader.setFloat("material.shininess", 32.0f);
-    shader.setBool("hasTexture", false);
+    shader.setFeatures({ { "HAS_TEXTURE", false }, { "HAS_SPECULAR_MAP", false }, { "HAS_NORMAL_MAP", false } });
     
     renderRobotBody(shader);
     renderRobotArm(shader);
@@ -377,9 +427,43 @@ void MobileRobot::render(Shader& shader) {
     // Scan beam removed - robot will scan without visual beam
 }
 
+void MobileRobot::renderPointCloud(Shader& shader) {
+    const std::vector<ScanPoint>& points = scanner.getPoints();
+    if (points.empty()) return;
+    
+    // Upload only the points merged since the last frame; grow the buffer geometrically
+    glBindBuffer(GL_ARRAY_BUFFER, pointCloudVBO);
+    if (points.size() > pointCloudCapacity) {
+        pointCloudCapacity = std::max<size_t>(points.size() * 2, 4096);
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(pointCloudCapacity * sizeof(ScanPoint)), nullptr, GL_DYNAMIC_DRAW);
+        uploadedPointCount = 0;
+    }
+    if (points.size() > uploadedPointCount) {
+        glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(uploadedPointCount * sizeof(ScanPoint)),
+                        static_cast<GLsizeiptr>((points.size() - uploadedPointCount) * sizeof(ScanPoint)),
+                        points.data() + uploadedPointCount);
+        uploadedPointCount = points.size();
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    // Same glowing green as the scan indicator
+    shader.setVec3("material.ambient", 0.3f, 1.0f, 0.3f);
+    shader.setVec3("material.diffuse", 0.0f, 1.0f, 0.0f);
+    shader.setVec3("material.specular", 0.8f, 1.0f, 0.8f);
+    shader.setFloat("material.shininess", 16.0f);
+    shader.setFeatures({ { "HAS_TEXTURE", false }, { "HAS_SPECULAR_MAP", false }, { "HAS_NORMAL_MAP", false } });
+    Mesh::setTransform(shader, glm::mat4(1.0f));
+    
+    glPointSize(3.0f);
+    glBindVertexArray(pointCloudVAO);
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(points.size()));
+    glBindVertexArray(0);
+    glPointSize(1.0f);
+}
+
 void MobileRobot::renderRobotBody(Shader& shader) {
     glm::mat4 modelMatrix = getRobotMatrix();
-    shader.setMat4("model", modelMatrix);
+    Mesh::setTransform(shader, modelMatrix);
       glBindVertexArray(VAO);
     glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
     glBindVertexArray(0);
@@ -399,7 +483,7 @@ void MobileRobot::renderRobotArm(Shader& shader) {
     shoulderMatrix = glm::translate(shoulderMatrix, glm::vec3(0, 0, 0.3f));
     shoulderMatrix = glm::scale(shoulderMatrix, glm::vec3(0.1f, 0.1f, 0.3f));
     
-    shader.setMat4("model", shoulderMatrix);
+    Mesh::setTransform(shader, shoulderMatrix);
     glBindVertexArray(VAO);
     glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0); // Draw first 36 indices (cube)
     
@@ -411,7 +495,7 @@ void MobileRobot::renderRobotArm(Shader& shader) {
     elbowMatrix = glm::translate(elbowMatrix, glm::vec3(0, 0, 0.25f));
     elbowMatrix = glm::scale(elbowMatrix, glm::vec3(0.08f, 0.08f, 0.25f));
     
-    shader.setMat4("model", elbowMatrix);
+    Mesh::setTransform(shader, elbowMatrix);
     glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
     
     glBindVertexArray(0);
@@ -433,7 +517,7 @@ void MobileRobot::renderScanBeam(Shader& shader) {
     float pulseScale = 0.05f + 0.03f * sin(arm.scanProgress * M_PI * 8.0f);
     scanIndicatorMatrix = glm::scale(scanIndicatorMatrix, glm::vec3(pulseScale));
     
-    shader.setMat4("model", scanIndicatorMatrix);
+    Mesh::setTransform(shader, scanIndicatorMatrix);
     glBindVertexArray(VAO);
     glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
     glBindVertexArray(0);
@@ -503,6 +587,7 @@ void MobileRobot::startScan() {
 }
 
 void MobileRobot::stopScan() {
+    scanner.cancel();
     arm.isScanning = false;
     arm.scanProgress = 0.0f;
     state = RobotState::IDLE;
@@ -608,9 +693,9 @@ glm::vec3 MobileRobot::calculateOptimalRobotPosition(const glm::vec3& objectPos,
             break;
     }
     
-    // Ensure robot stays within room boundaries (room is 20x8x20 centered at origin)
-    robotPos.x = glm::clamp(robotPos.x, -9.5f, 9.5f);
-    robotPos.z = glm::clamp(robotPos.z, -9.5f, 9.5f);
+    // Ensure robot stays within the museum floor
+    robotPos.x = glm::clamp(robotPos.x, roomMin.x, roomMax.x);
+    robotPos.z = glm::clamp(robotPos.z, roomMin.z, roomMax.z);
     robotPos.y = 0.0f; // Keep robot on ground
     
     return robotPos;
@@ -793,6 +878,50 @@ bool MobileRobot::isArmPositionValid(float baseRot, float shoulder, float elbow,
     return reach <= arm.maxReach;
 }
 
+AABB MobileRobot::getBounds() const {
+    AABB body{ glm::vec3(-0.4f, 0.0f, -0.5f), glm::vec3(0.4f, 0.7f, 0.5f) };
+    AABB bounds = body.transformed(getRobotMatrix());
+    glm::vec3 armBasePos = position + glm::vec3(0.0f, 0.7f, 0.0f);
+    bounds.grow(AABB{ armBasePos - glm::vec3(arm.maxReach), armBasePos + glm::vec3(arm.maxReach) });
+    return bounds;
+}
+
+bool MobileRobot::intersectRay(const glm::vec3& origin, const glm::vec3& direction, float& distance) const {
+    bool hitAnything = false;
+    float closest = FLT_MAX;
+    
+    // Body: base box plus the sensor head, tested in robot space
+    glm::mat4 toLocal = glm::inverse(getRobotMatrix());
+    glm::vec3 localOrigin = glm::vec3(toLocal * glm::vec4(origin, 1.0f));
+    glm::vec3 localDirection = glm::vec3(toLocal * glm::vec4(direction, 0.0f));
+    AABB body{ glm::vec3(-0.4f, 0.0f, -0.5f), glm::vec3(0.4f, 0.7f, 0.5f) };
+    glm::vec3 invDirection(1.0f / localDirection.x, 1.0f / localDirection.y, 1.0f / localDirection.z);
+    float tBody;
+    if (body.intersectRay(localOrigin, invDirection, 0.0f, closest, tBody)) {
+        closest = tBody;
+        hitAnything = true;
+    }
+    
+    // Arm segments
+    for (const auto& sphere : arm.segments) {
+        glm::vec3 oc = origin - sphere.center;
+        float a = glm::dot(direction, direction);
+        float b = glm::dot(oc, direction);
+        float c = glm::dot(oc, oc) - sphere.radius * sphere.radius;
+        float discriminant = b * b - a * c;
+        if (discriminant < 0.0f) continue;
+        
+        float t = (-b - sqrt(discriminant)) / a;
+        if (t > 0.0f && t < closest) {
+            closest = t;
+            hitAnything = true;
+        }
+    }
+    
+    if (hitAnything) distance = closest;
+    return hitAnything;
+}
+
 // Advanced Spotlight System Implementation
 glm::vec3 MobileRobot::getScanningSpotlightPosition() const {
     return calculateArmTipPosition();
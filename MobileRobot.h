@@ -6,6 +6,8 @@
 #include <memory>
 #include "Shader.h"
 #include "MuseumObjectManager.h"
+#include "BVH.h"
+#include "PointCloudScanner.h"
 
 enum class RobotState {
     IDLE,
@@ -62,6 +64,8 @@ struct ScanResult {
     glm::vec3 objectPosition;
     int objectIndex = -1;
     float scanTime = 0.0f;
+    size_t pointCount = 0;            // Points in the captured cloud (voxel-downsampled)
+    size_t raysCast = 0;
 };
 
 class MobileRobot {
@@ -72,6 +76,7 @@ public:
     // Main update and render functions
     void update(float deltaTime, const MuseumObjectManager& objectManager);
     void render(Shader& shader);
+    void renderPointCloud(Shader& shader);
     
     // Navigation controls
     void setPosition(const glm::vec3& position);
@@ -95,6 +100,12 @@ public:
     void updateArmCollisionSpheres();
     bool isArmPositionValid(float baseRot, float shoulder, float elbow, float wrist) const;
     
+    // Ray test against the robot body box and arm collision spheres (for mouse picking)
+    bool intersectRay(const glm::vec3& origin, const glm::vec3& direction, float& distance) const;
+    
+    // World-space box around the body and everything the arm can reach, for frustum culling
+    AABB getBounds() const;
+    
     // Advanced spotlight methods
     glm::vec3 getScanningSpotlightPosition() const;
     glm::vec3 getScanningSpotlightDirection() const;
@@ -111,6 +122,8 @@ public:
     const RobotArm& getArm() const { return arm; }    const ScanResult& getLastScanResult() const { return lastScanResult; }
     void clearLastScanResult() { lastScanResult.hasResult = false; }
     bool isScanning() const { return arm.isScanning; }
+    const PointCloudScanner& getScanner() const { return scanner; }
+    void setScanRayRate(float raysPerSecond) { scanner.setRayRate(raysPerSecond); }
     
     // Automatic tour getters
     bool isAutoMode() const { return autoMode; }
@@ -120,6 +133,7 @@ public:
     void setMovementSpeed(float speed) { movementSpeed = speed; }
     void setRotationSpeed(float speed) { rotationSpeed = speed; }
     void setScanRange(float range) { scanRange = range; }
+    void setRoomBounds(const glm::vec3& minBounds, const glm::vec3& maxBounds) { roomMin = minBounds; roomMax = maxBounds; }
     
     // Automatic tour controls
     void setAutoMode(bool mode) { autoMode = mode; }
@@ -152,6 +166,7 @@ private:
     // Robot components
     RobotArm arm;
     ScanResult lastScanResult;
+    PointCloudScanner scanner;
     
     // Enhanced physics system
     PhysicsProperties robotPhysics;
@@ -175,6 +190,8 @@ private:
     float rotationSpeed;
     float scanRange;
     float targetTolerance;
+    glm::vec3 roomMin = glm::vec3(-9.5f, 0.0f, -9.5f);   // Floor area the robot may drive on
+    glm::vec3 roomMax = glm::vec3(9.5f, 0.0f, 9.5f);
       // Auto patrol system
     std::vector<glm::vec3> patrolPoints;
     int currentPatrolIndex;
@@ -194,6 +211,9 @@ private:
     unsigned int VAO, VBO, EBO;
     std::vector<float> vertices;
     std::vector<unsigned int> indices;
+    unsigned int pointCloudVAO = 0, pointCloudVBO = 0;
+    size_t pointCloudCapacity = 0;
+    size_t uploadedPointCount = 0;
       // Internal methods
     void initializeGeometry();    void updateMovement(float deltaTime);
     void updateArm(float deltaTime);
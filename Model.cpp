@@ -4,47 +4,491 @@
 // stb_image for texture loading
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "ThreadPool.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "GlbLoader.h"
+#include <chrono>
+#include <cstddef>
+#include <algorithm>
 
-Model::Model(std::string const& path, bool gamma) : gammaCorrection(gamma)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MODEL_INSTANCES_SSE 1
+#endif
+
+namespace {
+    // Part of the mesh cache key: changing the import changes the cached vertex data
+    const unsigned int IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+    void packInstance(const InstanceSource& source, ModelInstance& instance)
+    {
+        const glm::mat4& m = source.transform;
+        for (int row = 0; row < 3; ++row) {
+            instance.modelRows[row] = glm::vec4(m[0][row], m[1][row], m[2][row], m[3][row]);
+        }
+        // The rows of the inverse are the cross products of the columns over the determinant
+        glm::vec3 c0(m[0]), c1(m[1]), c2(m[2]);
+        glm::vec3 r0 = glm::cross(c1, c2), r1 = glm::cross(c2, c0), r2 = glm::cross(c0, c1);
+        float invDet = 1.0f / glm::dot(c0, r0);
+        instance.normalColumns[0] = glm::vec4(r0 * invDet, source.materialAmbient.x);
+        instance.normalColumns[1] = glm::vec4(r1 * invDet, source.materialAmbient.y);
+        instance.normalColumns[2] = glm::vec4(r2 * invDet, source.materialAmbient.z);
+        instance.materialDiffuse = glm::vec4(source.materialDiffuse, 0.0f);
+        instance.materialSpecular = glm::vec4(source.materialSpecular, 0.0f);
+    }
+}
+
+Model::Model(std::string const& path, bool gamma) : Model(import(path), gamma)
 {
-    // Initialize bounding box to extreme values
-    boundingBoxMin = glm::vec3(FLT_MAX);
-    boundingBoxMax = glm::vec3(-FLT_MAX);
-    
-    loadModel(path);
 }
 
-void Model::Draw(Shader& shader)
+Model::Model(std::unique_ptr<ModelData> data, bool gamma) : gammaCorrection(gamma)
+{
+    directory = data->directory;
+    boundingBoxMin = data->boundingBoxMin;
+    boundingBoxMax = data->boundingBoxMax;
+    meshBounds = std::move(data->meshBounds);
+
+    if (data->meshCache) {
+        const MeshCache& cache = *data->meshCache;
+        for (size_t m = 0; m < cache.getMeshCount(); ++m) {
+            std::vector<Texture> textures;
+            for (const MeshCache::TextureBinding& binding : cache.getTextures(m)) {
+                textures.push_back(findOrLoadTexture(binding, *data));
+            }
+            // Only the coarsest level goes from the mapping into the GL buffers now; Refine() streams
+            // in the finer ones as draws need them
+            meshes.push_back(Mesh(cache.getVertices(m), cache.getVertexCount(m), cache.getIndices(m), cache.getIndexCount(m),
+                                  textures, boundingBoxMin, boundingBoxMax, cache.getLods(m)));
+        }
+        meshCache = std::move(data->meshCache);
+    }
+
+    for (ModelData::MeshData& mesh : data->meshes) {
+        std::vector<Texture> textures;
+        for (const MeshCache::TextureBinding& binding : mesh.textures) {
+            textures.push_back(findOrLoadTexture(binding, *data));
+        }
+        meshes.push_back(Mesh(std::move(mesh.vertices), std::move(mesh.indices), textures,
+                              boundingBoxMin, boundingBoxMax, std::move(mesh.lods)));
+    }
+
+    // Meshes with the same textures and index width are drawn with one multi-draw call
+    std::map<std::pair<std::vector<unsigned int>, bool>, size_t> batchByState;
+    for (size_t m = 0; m < meshes.size(); ++m) {
+        std::vector<unsigned int> textureIds;
+        for (const Texture& texture : meshes[m].textures) textureIds.push_back(texture.id);
+        auto key = std::make_pair(textureIds, meshes[m].getGeometry().shortIndices);
+
+        auto found = batchByState.find(key);
+        if (found == batchByState.end()) {
+            found = batchByState.emplace(key, drawBatches.size()).first;
+            drawBatches.push_back(DrawBatch());
+            drawBatches.back().shortIndices = key.second;
+        }
+        drawBatches[found->second].meshes.push_back(m);
+    }
+}
+
+std::unique_ptr<ModelData> Model::import(const std::string& path)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::unique_ptr<ModelData> data(new ModelData());
+    data->path = path;
+
+    // Retrieve the directory path of the filepath
+    data->directory = path.substr(0, path.find_last_of('/'));
+    if (data->directory == path) {
+        // Try backslash for Windows paths
+        data->directory = path.substr(0, path.find_last_of('\\'));
+    }
+
+    try {
+        // Own the scene (or the mapped GLB), whose embedded images are decoded in place after the
+        // meshes are converted
+        Assimp::Importer importer;
+        const aiScene* scene = nullptr;
+        GlbLoader glb;
+        const GlbLoader* glbSource = nullptr;
+
+        // Warm start: the cache is keyed by the model's contents, so a hit is always up to date
+        uint64_t sourceHash = 0;
+        bool hashed = MeshCache::hashFile(path, sourceHash);
+        std::string cachePath = MeshCache::cachePathFor(path);
+        if (hashed && loadFromMeshCache(cachePath, sourceHash, *data)) {
+            float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            std::cout << "Loaded " << path << " from mesh cache in " << ms << " ms" << std::endl;
+        } else {
+            // GLB models are read straight from the mapped file; Assimp handles the rest
+            if (glb.load(path, *data)) {
+                glbSource = &glb;
+            } else {
+                scene = loadModel(path, importer, *data);
+                if (!scene) return data;
+            }
+            optimizeMeshes(*data);
+
+            float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            std::cout << "Imported " << path << (glbSource ? " from GLB" : " with Assimp") << " in " << ms << " ms" << std::endl;
+
+            if (hashed && !data->meshes.empty()) {
+                std::vector<MeshCache::MeshSource> sources;
+                for (const ModelData::MeshData& mesh : data->meshes) {
+                    sources.push_back({ mesh.vertices.data(), mesh.vertices.size(),
+                                        mesh.indices.data(), mesh.indices.size(), &mesh.textures, &mesh.lods });
+                }
+                // Embedded images are copied into the cache so a warm start never needs the scene
+                std::vector<MeshCache::EmbeddedImage> embedded;
+                for (const std::string& texturePath : texturePaths(*data)) {
+                    MeshCache::EmbeddedImage image;
+                    if (findEmbeddedImage(scene, glbSource, *data, texturePath, image)) embedded.push_back(image);
+                }
+                MeshCache::write(cachePath, sourceHash, IMPORT_FLAGS, sources, embedded,
+                                 data->boundingBoxMin, data->boundingBoxMax);
+            }
+        }
+
+        computeMeshBounds(*data);
+        decodeImages(*data, scene, glbSource);
+    } catch (const std::exception& e) {
+        std::cout << "ERROR::MODEL:: Import of " << path << " failed: " << e.what() << std::endl;
+        data->meshes.clear();
+        data->meshCache.reset();
+    }
+
+    return data;
+}
+
+void Model::computeMeshBounds(ModelData& data)
+{
+    auto boundsOf = [](const Vertex* vertices, size_t count) {
+        AABB bounds;
+        for (size_t v = 0; v < count; ++v) bounds.grow(vertices[v].Position);
+        return bounds;
+    };
+
+    // Runs on the importing thread, so a cached model's mapping is read here and not on the GL thread
+    data.meshBounds.clear();
+    if (data.meshCache) {
+        for (size_t m = 0; m < data.meshCache->getMeshCount(); ++m) {
+            data.meshBounds.push_back(boundsOf(data.meshCache->getVertices(m), data.meshCache->getVertexCount(m)));
+        }
+    }
+    for (const ModelData::MeshData& mesh : data.meshes) {
+        data.meshBounds.push_back(boundsOf(mesh.vertices.data(), mesh.vertices.size()));
+    }
+}
+
+void Model::optimizeMeshes(ModelData& data)
+{
+    std::vector<MeshOptimizer::Report> reports(data.meshes.size());
+    // Runs inside the import's pool task; parallelFor finishes any chunk no idle worker picks up
+    // on this thread, so the meshes are still spread out when other imports keep the pool busy
+    ThreadPool::shared().parallelFor(data.meshes.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t m = begin; m < end; ++m) {
+            ModelData::MeshData& mesh = data.meshes[m];
+            reports[m] = MeshOptimizer::optimize(mesh.vertices, mesh.indices);
+            MeshSimplifier::buildLodChain(mesh.vertices, mesh.indices, mesh.lods);
+        }
+    });
+
+    // ACMR over the whole model, weighted by triangle count
+    MeshOptimizer::Report total;
+    size_t lodTriangles = 0;
+    for (const ModelData::MeshData& mesh : data.meshes) {
+        lodTriangles += mesh.lods.back().indexCount / 3;
+    }
+    for (const MeshOptimizer::Report& report : reports) {
+        total.verticesBefore += report.verticesBefore;
+        total.verticesAfter += report.verticesAfter;
+        total.trianglesBefore += report.trianglesBefore;
+        total.trianglesAfter += report.trianglesAfter;
+        total.acmrBefore += report.acmrBefore * report.trianglesBefore;
+        total.acmrAfter += report.acmrAfter * report.trianglesAfter;
+    }
+    if (total.trianglesBefore > 0) total.acmrBefore /= total.trianglesBefore;
+    if (total.trianglesAfter > 0) total.acmrAfter /= total.trianglesAfter;
+
+    std::cout << "Optimized " << data.path << ": " << total.verticesBefore << " -> " << total.verticesAfter
+              << " vertices, " << total.trianglesBefore << " -> " << total.trianglesAfter << " triangles, ACMR "
+              << total.acmrBefore << " -> " << total.acmrAfter << ", coarsest LOD " << lodTriangles << " triangles" << std::endl;
+}
+
+Model::~Model()
+{
+    for (Mesh& mesh : meshes) {
+        mesh.release();
+    }
+    for (const Texture& texture : textures_loaded) {
+        TextureCache::shared().release(texture.id);
+    }
+}
+
+size_t Model::Draw(Shader& shader, float maxError)
+{
+    // Every mesh is quantized within the model's bounds, so this is set once per model
+    Mesh::setPositionDequantization(shader, boundingBoxMin, boundingBoxMax);
+
+    size_t triangles = 0;
+    for (const DrawBatch& batch : drawBatches) {
+        Mesh::bindTextures(shader, meshes[batch.meshes[0]].textures);
+        GeometryPool::shared().bind(batch.shortIndices);
+
+        size_t indexSize = batch.shortIndices ? sizeof(uint16_t) : sizeof(unsigned int);
+        drawCounts.clear();
+        drawOffsets.clear();
+        drawBaseVertices.clear();
+        for (size_t m : batch.meshes) {
+            const GeometryPool::Range& geometry = meshes[m].getGeometry();
+            const MeshLod& lod = meshes[m].selectLod(maxError);
+            drawCounts.push_back(static_cast<GLsizei>(lod.indexCount));
+            drawOffsets.push_back((void*)((geometry.firstIndex + lod.firstIndex) * indexSize));
+            drawBaseVertices.push_back(static_cast<GLint>(geometry.firstVertex));
+            triangles += lod.indexCount / 3;
+        }
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), batch.shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+                                      drawOffsets.data(), static_cast<GLsizei>(drawCounts.size()), drawBaseVertices.data());
+    }
+
+    glBindVertexArray(0);
+    shader.setBool("packedVertex", false);   // The room and robot share the shader with float vertices
+    glActiveTexture(GL_TEXTURE0);
+    return triangles;
+}
+
+void Model::PackInstances(const InstanceSource* sources, size_t count, ModelInstance* instances)
 {
-    for (unsigned int i = 0; i < meshes.size(); i++)
-        meshes[i].Draw(shader);
+    size_t i = 0;
+#ifdef MODEL_INSTANCES_SSE
+    for (; i + 4 <= count; i += 4) {
+        const InstanceSource* source = sources + i;
+        ModelInstance* instance = instances + i;
+
+        for (int j = 0; j < 4; ++j) {
+            const float* m = &source[j].transform[0][0];
+            __m128 row0 = _mm_loadu_ps(m), row1 = _mm_loadu_ps(m + 4), row2 = _mm_loadu_ps(m + 8), row3 = _mm_loadu_ps(m + 12);
+            _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+            _mm_storeu_ps(&instance[j].modelRows[0][0], row0);
+            _mm_storeu_ps(&instance[j].modelRows[1][0], row1);
+            _mm_storeu_ps(&instance[j].modelRows[2][0], row2);
+            instance[j].materialDiffuse = glm::vec4(source[j].materialDiffuse, 0.0f);
+            instance[j].materialSpecular = glm::vec4(source[j].materialSpecular, 0.0f);
+        }
+
+        // The upper 3x3 columns of the four matrices, one matrix per lane
+        __m128 x[3], y[3], z[3];
+        for (int c = 0; c < 3; ++c) {
+            __m128 a = _mm_loadu_ps(&source[0].transform[c][0]), b = _mm_loadu_ps(&source[1].transform[c][0]);
+            __m128 d = _mm_loadu_ps(&source[2].transform[c][0]), e = _mm_loadu_ps(&source[3].transform[c][0]);
+            _MM_TRANSPOSE4_PS(a, b, d, e);
+            x[c] = a;
+            y[c] = b;
+            z[c] = d;
+        }
+
+        // Inverse rows as in packInstance: row k is column k+1 cross column k+2
+        __m128 rx[3], ry[3], rz[3];
+        for (int k = 0; k < 3; ++k) {
+            int a = (k + 1) % 3, b = (k + 2) % 3;
+            rx[k] = _mm_sub_ps(_mm_mul_ps(y[a], z[b]), _mm_mul_ps(z[a], y[b]));
+            ry[k] = _mm_sub_ps(_mm_mul_ps(z[a], x[b]), _mm_mul_ps(x[a], z[b]));
+            rz[k] = _mm_sub_ps(_mm_mul_ps(x[a], y[b]), _mm_mul_ps(y[a], x[b]));
+        }
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x[0], rx[0]), _mm_mul_ps(y[0], ry[0])), _mm_mul_ps(z[0], rz[0]));
+        __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+        // Back to one column per instance, with the ambient colour in w
+        for (int k = 0; k < 3; ++k) {
+            __m128 nx = _mm_mul_ps(rx[k], invDet), ny = _mm_mul_ps(ry[k], invDet), nz = _mm_mul_ps(rz[k], invDet);
+            __m128 ambient = _mm_setr_ps(source[0].materialAmbient[k], source[1].materialAmbient[k],
+                                         source[2].materialAmbient[k], source[3].materialAmbient[k]);
+            _MM_TRANSPOSE4_PS(nx, ny, nz, ambient);
+            _mm_storeu_ps(&instance[0].normalColumns[k][0], nx);
+            _mm_storeu_ps(&instance[1].normalColumns[k][0], ny);
+            _mm_storeu_ps(&instance[2].normalColumns[k][0], nz);
+            _mm_storeu_ps(&instance[3].normalColumns[k][0], ambient);
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        packInstance(sources[i], instances[i]);
+    }
 }
 
-void Model::loadModel(std::string const& path)
+size_t Model::DrawInstanced(Shader& shader, size_t firstInstance, const ModelInstance* instances, const float* maxErrors,
+                            size_t count, const Frustum& frustum)
 {
-    // Read file via ASSIMP
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    Mesh::setPositionDequantization(shader, boundingBoxMin, boundingBoxMax);
+    shader.setBool("instanced", true);
+
+    size_t triangles = 0;
+    for (const DrawBatch& batch : drawBatches) {
+        Mesh::bindTextures(shader, meshes[batch.meshes[0]].textures);
+        GeometryPool::shared().bind(batch.shortIndices);
+
+        size_t indexSize = batch.shortIndices ? sizeof(uint16_t) : sizeof(unsigned int);
+        for (size_t m : batch.meshes) {
+            const GeometryPool::Range& geometry = meshes[m].getGeometry();
+
+            // The caller culled whole instances; a model of several meshes also skips the meshes an
+            // instance has outside the frustum
+            meshVisibility.assign(count, 1);
+            if (meshes.size() > 1 && m < meshBounds.size()) {
+                if (frustum.cullTransformedBox(meshBounds[m], instances[0].modelRows, INSTANCE_TEXELS, count,
+                                               meshVisibility.data()) == 0) continue;
+            }
+
+            // maxErrors is sorted, so each LOD level covers a contiguous run of instances; culled
+            // instances split the runs
+            for (size_t begin = 0, end; begin < count; begin = end) {
+                if (!meshVisibility[begin]) {
+                    end = begin + 1;
+                    continue;
+                }
+                const MeshLod& lod = meshes[m].selectLod(maxErrors[begin]);
+                for (end = begin + 1; end < count && meshVisibility[end] && &meshes[m].selectLod(maxErrors[end]) == &lod; ++end) {}
+
+                // Without base instances (GL 4.2) the shader adds the run's first instance itself
+                shader.setInt("instanceBase", static_cast<int>(firstInstance + begin));
+
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(lod.indexCount),
+                                                  batch.shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+                                                  (void*)((geometry.firstIndex + lod.firstIndex) * indexSize),
+                                                  static_cast<GLsizei>(end - begin), static_cast<GLint>(geometry.firstVertex));
+                triangles += lod.indexCount / 3 * (end - begin);
+            }
+        }
+    }
+
+    glBindVertexArray(0);
+    shader.setBool("instanced", false);
+    shader.setBool("packedVertex", false);
+    glActiveTexture(GL_TEXTURE0);
+    return triangles;
+}
+
+size_t Model::Refine(size_t maxBytes)
+{
+    size_t uploaded = 0;
+    for (Mesh& mesh : meshes) {
+        uploaded += mesh.refine(maxBytes - std::min(maxBytes, uploaded));
+    }
+    return uploaded;
+}
+
+bool Model::IsComplete() const
+{
+    for (const Mesh& mesh : meshes) {
+        if (!mesh.isComplete()) return false;
+    }
+    return true;
+}
+
+size_t Model::GetTriangleCount() const
+{
+    size_t triangles = 0;
+    for (const Mesh& mesh : meshes)
+        triangles += mesh.lods[0].indexCount / 3;
+    return triangles;
+}
+
+Model::MemoryUsage Model::GetMemoryUsage() const
+{
+    MemoryUsage usage;
+    for (const Mesh& mesh : meshes) {
+        // Empty for meshes built from the mesh cache, which is counted below
+        usage.cpuBytes += mesh.vertices.capacity() * sizeof(Vertex) + mesh.indices.capacity() * sizeof(unsigned int);
+
+        const GeometryPool::Range& geometry = mesh.getGeometry();
+        usage.gpuBytes += geometry.vertexCount * sizeof(PackedVertex);
+        usage.gpuBytes += geometry.indexCount * (geometry.shortIndices ? sizeof(uint16_t) : sizeof(unsigned int));
+    }
+    if (meshCache) usage.cpuBytes += meshCache->getMappedBytes();
+    if (bvhReady.load(std::memory_order_acquire)) usage.cpuBytes += bvh.getMemoryBytes();
+    for (const Texture& texture : textures_loaded) {
+        usage.gpuBytes += TextureCache::shared().getTextureBytes(texture.id);
+    }
+    return usage;
+}
+
+std::vector<std::string> Model::GetExternalTextureFiles() const
+{
+    std::vector<std::string> files;
+    for (const Texture& texture : textures_loaded) {
+        if (!texture.path.empty() && texture.path[0] != '*') files.push_back(directory + '/' + texture.path);
+    }
+    return files;
+}
+
+const TriangleBVH& Model::GetBVH() const
+{
+    std::call_once(bvhBuilt, [this]() {
+        // Merge every mesh into one triangle soup; triangle indices follow mesh order
+        std::vector<glm::vec3> positions;
+        std::vector<unsigned int> indices;
+        if (meshCache) {
+            // Meshes loaded from the cache keep no CPU copy; read the mapped arrays instead
+            for (size_t m = 0; m < meshCache->getMeshCount(); ++m) {
+                unsigned int baseVertex = static_cast<unsigned int>(positions.size());
+                const Vertex* vertices = meshCache->getVertices(m);
+                const unsigned int* meshIndices = meshCache->getIndices(m);
+                for (size_t v = 0; v < meshCache->getVertexCount(m); ++v) {
+                    positions.push_back(vertices[v].Position);
+                }
+                MeshLod lod0 = meshCache->getLods(m)[0];
+                for (size_t i = 0; i < lod0.indexCount; ++i) {
+                    indices.push_back(baseVertex + meshIndices[lod0.firstIndex + i]);
+                }
+            }
+        }
+        for (const Mesh& mesh : meshes) {
+            unsigned int baseVertex = static_cast<unsigned int>(positions.size());
+            for (const Vertex& vertex : mesh.vertices) {
+                positions.push_back(vertex.Position);
+            }
+            // Full detail only; the index array holds the simplified levels as well
+            const MeshLod& lod0 = mesh.lods[0];
+            for (size_t i = 0; i < lod0.indexCount && lod0.firstIndex + i < mesh.indices.size(); ++i) {
+                indices.push_back(baseVertex + mesh.indices[lod0.firstIndex + i]);
+            }
+        }
+        bvh.build(positions, indices);
+        bvhReady.store(true, std::memory_order_release);
+    });
+    return bvh;
+}
+
+const aiScene* Model::loadModel(const std::string& path, Assimp::Importer& importer, ModelData& data)
+{
+    // Read file via ASSIMP. Each import has its own importer, so several models can load at once.
+    const aiScene* scene = importer.ReadFile(path, IMPORT_FLAGS);
     
     // Check for errors
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
     {
         std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
-        return;
-    }
-    
-    // Retrieve the directory path of the filepath
-    directory = path.substr(0, path.find_last_of('/'));
-    if (directory == path) {
-        // Try backslash for Windows paths
-        directory = path.substr(0, path.find_last_of('\\'));
+        return nullptr;
     }
 
     // Process ASSIMP's root node recursively
-    processNode(scene->mRootNode, scene);
+    processNode(scene->mRootNode, scene, data);
+    return scene;
 }
 
-void Model::processNode(aiNode* node, const aiScene* scene)
+bool Model::loadFromMeshCache(const std::string& cachePath, uint64_t sourceHash, ModelData& data)
+{
+    std::unique_ptr<MeshCache> cache(new MeshCache());
+    if (!cache->open(cachePath, sourceHash, IMPORT_FLAGS)) return false;
+
+    data.boundingBoxMin = cache->getBoundsMin();
+    data.boundingBoxMax = cache->getBoundsMax();
+    data.meshCache = std::move(cache);
+    return true;
+}
+
+void Model::processNode(aiNode* node, const aiScene* scene, ModelData& data)
 {
     // Process each mesh located at the current node
     for (unsigned int i = 0; i < node->mNumMeshes; i++)
@@ -52,27 +496,30 @@ void Model::processNode(aiNode* node, const aiScene* scene)
         // The node object only contains indices to index the actual objects in the scene. 
         // The scene contains all the data, node is just to keep stuff organized (like relations between nodes).
         aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(processMesh(mesh, scene));
+        data.meshes.push_back(processMesh(mesh, scene, data));
     }
     
     // After we've processed all of the meshes (if any) we then recursively process each of the children nodes
     for (unsigned int i = 0; i < node->mNumChildren; i++)
     {
-        processNode(node->mChildren[i], scene);
+        processNode(node->mChildren[i], scene, data);
     }
 }
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
+ModelData::MeshData Model::processMesh(aiMesh* mesh, const aiScene* scene, ModelData& data)
 {
     // Data to fill
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
+    ModelData::MeshData result;
+    std::vector<Vertex>& vertices = result.vertices;
+    std::vector<unsigned int>& indices = result.indices;
+    std::vector<MeshCache::TextureBinding>& textures = result.textures;
+    vertices.reserve(mesh->mNumVertices);
+    indices.reserve(mesh->mNumFaces * 3);
 
     // Walk through each of the mesh's vertices
     for (unsigned int i = 0; i < mesh->mNumVertices; i++)
     {
-        Vertex vertex;
+        Vertex vertex = {};   // Tangents stay zero without UVs
         glm::vec3 vector; // We declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
         
         // Positions
@@ -82,7 +529,8 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
         vertex.Position = vector;
         
         // Update bounding box
-        updateBoundingBox(vertex.Position);
+        data.boundingBoxMin = glm::min(data.boundingBoxMin, vertex.Position);
+        data.boundingBoxMax = glm::max(data.boundingBoxMax, vertex.Position);
         
         // Normals
         if (mesh->HasNormals())
@@ -140,65 +588,145 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
     // normal: texture_normalN
 
     // 1. diffuse maps
-    std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+    std::vector<MeshCache::TextureBinding> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
     textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
     
     // 2. specular maps
-    std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+    std::vector<MeshCache::TextureBinding> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
     textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
     
-    // 3. normal maps
-    std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
+    // 3. normal maps (OBJ-style files store them as height maps, glTF as real normal maps)
+    std::vector<MeshCache::TextureBinding> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
+    if (normalMaps.empty())
+        normalMaps = loadMaterialTextures(material, aiTextureType_NORMALS, "texture_normal");
     textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
     
     // 4. height maps
-    std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
+    std::vector<MeshCache::TextureBinding> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
     textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+    
+    // 5. glTF PBR maps: packed metallic/roughness, ambient occlusion and emission
+    std::vector<MeshCache::TextureBinding> metallicRoughnessMaps = loadMaterialTextures(material, aiTextureType_GLTF_METALLIC_ROUGHNESS, "texture_metallicRoughness");
+    if (metallicRoughnessMaps.empty())
+        metallicRoughnessMaps = loadMaterialTextures(material, aiTextureType_UNKNOWN, "texture_metallicRoughness");
+    textures.insert(textures.end(), metallicRoughnessMaps.begin(), metallicRoughnessMaps.end());
+    std::vector<MeshCache::TextureBinding> occlusionMaps = loadMaterialTextures(material, aiTextureType_LIGHTMAP, "texture_occlusion");
+    textures.insert(textures.end(), occlusionMaps.begin(), occlusionMaps.end());
+    std::vector<MeshCache::TextureBinding> emissiveMaps = loadMaterialTextures(material, aiTextureType_EMISSIVE, "texture_emissive");
+    textures.insert(textures.end(), emissiveMaps.begin(), emissiveMaps.end());
 
-    // Return a mesh object created from the extracted mesh data
-    return Mesh(vertices, indices, textures);
+    // The GL mesh is created later, on the GL thread
+    return result;
 }
 
-std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
+std::vector<MeshCache::TextureBinding> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
 {
-    std::vector<Texture> textures;
+    std::vector<MeshCache::TextureBinding> textures;
     for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
     {
         aiString str;
         mat->GetTexture(type, i, &str);
-        // Check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-        bool skip = false;
-        for (unsigned int j = 0; j < textures_loaded.size(); j++)
-        {
-            if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-            {
-                textures.push_back(textures_loaded[j]);
-                skip = true; // A texture with the same filepath has already been loaded, continue to next one. (optimization)
-                break;
-            }
+        textures.push_back({ typeName, str.C_Str() });
+    }
+    return textures;
+}
+
+std::vector<std::string> Model::texturePaths(const ModelData& data)
+{
+    // Every distinct path once, whether it came from Assimp or from the mesh cache
+    std::vector<std::string> paths;
+    std::unordered_map<std::string, bool> seen;
+    auto addPath = [&](const std::string& path) {
+        if (seen.emplace(path, true).second) paths.push_back(path);
+    };
+    for (const ModelData::MeshData& mesh : data.meshes) {
+        for (const MeshCache::TextureBinding& binding : mesh.textures) addPath(binding.path);
+    }
+    if (data.meshCache) {
+        for (size_t m = 0; m < data.meshCache->getMeshCount(); ++m) {
+            for (const MeshCache::TextureBinding& binding : data.meshCache->getTextures(m)) addPath(binding.path);
         }
-        if (!skip)
-        {   // If texture hasn't been loaded already, load it
-            Texture texture;
-            texture.id = TextureFromFile(str.C_Str(), this->directory);
-            texture.type = typeName;
-            texture.path = str.C_Str();
-            textures.push_back(texture);
-            textures_loaded.push_back(texture);  // Store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
+    }
+    return paths;
+}
+
+std::unordered_set<std::string> Model::normalMapPaths(const ModelData& data)
+{
+    std::unordered_set<std::string> paths;
+    auto addBindings = [&](const std::vector<MeshCache::TextureBinding>& bindings) {
+        for (const MeshCache::TextureBinding& binding : bindings) {
+            if (binding.type == "texture_normal") paths.insert(binding.path);
         }
+    };
+    for (const ModelData::MeshData& mesh : data.meshes) addBindings(mesh.textures);
+    if (data.meshCache) {
+        for (size_t m = 0; m < data.meshCache->getMeshCount(); ++m) addBindings(data.meshCache->getTextures(m));
     }
-    return textures;
+    return paths;
 }
 
-void Model::updateBoundingBox(const glm::vec3& position)
+bool Model::findEmbeddedImage(const aiScene* scene, const GlbLoader* glb, const ModelData& data, const std::string& path,
+                              MeshCache::EmbeddedImage& image)
 {
-    boundingBoxMin.x = std::min(boundingBoxMin.x, position.x);
-    boundingBoxMin.y = std::min(boundingBoxMin.y, position.y);
-    boundingBoxMin.z = std::min(boundingBoxMin.z, position.z);
-    
-    boundingBoxMax.x = std::max(boundingBoxMax.x, position.x);
-    boundingBoxMax.y = std::max(boundingBoxMax.y, position.y);
-    boundingBoxMax.z = std::max(boundingBoxMax.z, position.z);
+    if (glb && glb->findEmbeddedImage(path, image)) return true;
+
+    // Assimp resolves both "*N" references and file names matching an embedded texture
+    const aiTexture* texture = scene ? scene->GetEmbeddedTexture(path.c_str()) : nullptr;
+    if (texture) {
+        image.path = path;
+        image.data = reinterpret_cast<const unsigned char*>(texture->pcData);
+        image.width = texture->mWidth;
+        image.height = texture->mHeight;
+        // A height of 0 marks an encoded file whose byte size is stored in mWidth
+        image.size = texture->mHeight == 0 ? texture->mWidth : static_cast<size_t>(texture->mWidth) * texture->mHeight * 4;
+        return true;
+    }
+    return data.meshCache && data.meshCache->findEmbeddedImage(path, image);
+}
+
+void Model::decodeImages(ModelData& data, const aiScene* scene, const GlbLoader* glb)
+{
+    std::vector<std::string> paths = texturePaths(data);
+    std::unordered_set<std::string> normalMaps = normalMapPaths(data);
+    std::vector<TextureCache::Image> images(paths.size());
+    ThreadPool::shared().parallelFor(paths.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            bool normalMap = normalMaps.count(paths[i]) != 0;
+            // Embedded images are decoded straight from the scene, the mapped GLB or the mapped mesh cache
+            MeshCache::EmbeddedImage embedded;
+            if (!findEmbeddedImage(scene, glb, data, paths[i], embedded)) {
+                images[i] = TextureCache::shared().load(data.directory + '/' + paths[i], normalMap);
+            } else if (embedded.height == 0) {
+                images[i] = TextureCache::shared().loadFromMemory(data.path + ":" + paths[i], embedded.data, embedded.size,
+                                                                  normalMap);
+            } else {
+                images[i] = TextureCache::shared().loadFromTexels(data.path + ":" + paths[i], embedded.data,
+                                                                  static_cast<int>(embedded.width), static_cast<int>(embedded.height),
+                                                                  normalMap);
+            }
+        }
+    });
+    for (size_t i = 0; i < paths.size(); ++i) {
+        data.images[paths[i]] = std::move(images[i]);
+    }
+}
+
+Texture Model::findOrLoadTexture(const MeshCache::TextureBinding& binding, const ModelData& data)
+{
+    // Meshes of one model often share a texture; keep a single cache reference per path
+    auto loaded = textureIndexByPath.find(binding.path);
+    if (loaded != textureIndexByPath.end())
+        return textures_loaded[loaded->second];
+
+    // Identical images used by other models (under any path) share the same GL texture
+    auto image = data.images.find(binding.path);
+    Texture texture;
+    texture.id = TextureCache::shared().acquire(image != data.images.end() ? image->second : TextureCache::Image());
+    texture.type = binding.type;
+    texture.path = binding.path;
+    textureIndexByPath[binding.path] = textures_loaded.size();
+    textures_loaded.push_back(texture);
+    return texture;
 }
 
 unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma)
@@ -206,11 +734,21 @@ unsigned int TextureFromFile(const char* path, const std::string& directory, boo
     std::string filename = std::string(path);
     filename = directory + '/' + filename;
 
+    int width = 0, height = 0, nrComponents = 0;
+    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+    if (!data)
+        std::cout << "Texture failed to load at path: " << filename << std::endl;
+
+    unsigned int textureID = TextureFromImage(data, width, height, nrComponents);
+    stbi_image_free(data);
+    return textureID;
+}
+
+unsigned int TextureFromImage(const unsigned char* data, int width, int height, int nrComponents)
+{
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
     if (data)
     {
         GLenum format;
@@ -231,14 +769,9 @@ unsigned int TextureFromFile(const char* path, const std::string& directory, boo
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
     }
     else
     {
-        std::cout << "Texture failed to load at path: " << filename << std::endl;
-        stbi_image_free(data);
-        
         // Create a simple white texture as fallback
         unsigned char whiteTexture[] = {255, 255, 255};
         glBindTexture(GL_TEXTURE_2D, textureID);
@@ -10,30 +10,120 @@
 
 #include "Mesh.h"
 #include "Shader.h"
+#include "BVH.h"
+#include "MeshCache.h"
+#include "TextureCache.h"
+#include "Frustum.h"
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
+#include <mutex>
+#include <memory>
+#include <atomic>
+
+class GlbLoader;
 
 unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma = false);
 
+// Uploads decoded pixels as a mipmapped 2D texture; null data gives a 1x1 white texture
+unsigned int TextureFromImage(const unsigned char* data, int width, int height, int nrComponents);
+
+// CPU-side result of importing a model file. Produced by Model::import on any thread (Assimp,
+// vertex conversion, image decoding) and turned into GL objects by the Model constructor.
+struct ModelData {
+    struct MeshData {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;     // Every LOD level, coarsest first
+        std::vector<MeshCache::TextureBinding> textures;
+        std::vector<MeshLod> lods;
+    };
+
+    std::string path;
+    std::string directory;
+    std::vector<MeshData> meshes;
+    std::unique_ptr<MeshCache> meshCache; // Set on a cache hit; meshes then stay empty and the mapping is uploaded
+    std::unordered_map<std::string, TextureCache::Image> images; // Keyed by the path used in the materials
+    glm::vec3 boundingBoxMin = glm::vec3(FLT_MAX);
+    glm::vec3 boundingBoxMax = glm::vec3(-FLT_MAX);
+    std::vector<AABB> meshBounds;   // Per mesh in the order the Model creates them, for culling
+};
+
+// What an instance of Model::DrawInstanced is built from
+struct InstanceSource {
+    glm::mat4 transform;
+    glm::vec3 materialAmbient;
+    glm::vec3 materialDiffuse;
+    glm::vec3 materialSpecular;
+};
+
+// Per-instance draw data, read by shader.vert from a texture buffer as Model::INSTANCE_TEXELS
+// RGBA32F texels. The normal matrix is computed here once per object instead of per vertex.
+struct ModelInstance {
+    glm::vec4 modelRows[3];       // The model matrix is affine, so three rows describe it
+    glm::vec4 normalColumns[3];   // Inverse transpose of its upper 3x3; w holds the ambient colour
+    glm::vec4 materialDiffuse;    // w unused
+    glm::vec4 materialSpecular;   // w unused
+};
+
 class Model
 {
 public:
     // Model data
-    std::vector<Texture> textures_loaded; // Stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    std::vector<Texture> textures_loaded; // Textures referenced by this model; each holds one TextureCache reference
     std::vector<Mesh>    meshes;
     std::string directory;
     bool gammaCorrection;
 
-    // Constructor, expects a filepath to a 3D model.
+    // Constructor, expects a filepath to a 3D model. Imports and uploads on the calling (GL) thread.
     Model(std::string const& path, bool gamma = false);
 
-    // Draws the model, and thus all its meshes
-    void Draw(Shader& shader);
+    // Creates the GL objects for already imported data. Must run on the GL thread.
+    explicit Model(std::unique_ptr<ModelData> data, bool gamma = false);
+    ~Model();
+
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+
+    // Parses the model (or its mesh cache) and decodes its textures without touching GL, so it can
+    // run on a worker thread. Never returns null; a failed import has no meshes.
+    static std::unique_ptr<ModelData> import(const std::string& path);
+
+    // Draws the model, and thus all its meshes, each with the coarsest LOD whose error is at most
+    // maxError (model units). Returns the number of triangles drawn.
+    size_t Draw(Shader& shader, float maxError = 0.0f);
+
+    // Texels per ModelInstance, and the texture unit the instance buffer is bound to
+    static const int INSTANCE_TEXELS = sizeof(ModelInstance) / sizeof(glm::vec4);
+    static const int INSTANCE_TEXTURE_UNIT = 12;
+
+    // Builds the draw data of count instances, four at a time with SSE
+    static void PackInstances(const InstanceSource* sources, size_t count, ModelInstance* instances);
+
+    // Draws count instances of the model whose ModelInstance data is stored from firstInstance on
+    // in the texture buffer bound to INSTANCE_TEXTURE_UNIT, with one glDrawElementsInstancedBaseVertex
+    // per mesh and LOD. instances is the CPU copy of that data; with several meshes, each mesh is
+    // culled against the frustum per instance. maxErrors[i] is instance i's LOD bound as for Draw();
+    // it must not decrease with i so that instances sharing a level are contiguous. Returns the
+    // number of triangles drawn.
+    size_t DrawInstanced(Shader& shader, size_t firstInstance, const ModelInstance* instances, const float* maxErrors,
+                         size_t count, const Frustum& frustum);
+
+    // Models loaded from the mesh cache start with only their coarsest LOD on the GPU. This
+    // uploads the finer levels that draws since the last call needed, streaming them from the
+    // mapping, until at least maxBytes have been uploaded. Returns the bytes uploaded.
+    size_t Refine(size_t maxBytes);
+
+    // Whether every LOD level of every mesh is on the GPU
+    bool IsComplete() const;
+
+    // Triangles of the full-detail meshes
+    size_t GetTriangleCount() const;
 
     // Get model bounding box for positioning
     glm::vec3 GetBoundingBoxMin() const { return boundingBoxMin; }
@@ -41,23 +131,89 @@ public:
     glm::vec3 GetBoundingBoxCenter() const { return (boundingBoxMin + boundingBoxMax) * 0.5f; }
     glm::vec3 GetBoundingBoxSize() const { return boundingBoxMax - boundingBoxMin; }
 
+    // Memory the model keeps resident: CPU copies of its meshes (or the mapped mesh cache they
+    // came from) and its BVH once built, and its geometry in the GeometryPool plus its textures
+    // (shared textures are counted in full) on the GPU
+    struct MemoryUsage {
+        size_t cpuBytes = 0;
+        size_t gpuBytes = 0;
+    };
+    MemoryUsage GetMemoryUsage() const;
+
+    // Image files next to the model that its textures were loaded from (not embedded ones)
+    std::vector<std::string> GetExternalTextureFiles() const;
+
+    // Triangle BVH over all meshes in model space, built on first use (thread-safe)
+    const TriangleBVH& GetBVH() const;
+
 private:
     // Bounding box for the model
     glm::vec3 boundingBoxMin;
     glm::vec3 boundingBoxMax;
 
-    // Loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(std::string const& path);
+    // Meshes sharing textures and index width, submitted with one glMultiDrawElementsBaseVertex
+    struct DrawBatch {
+        bool shortIndices = false;
+        std::vector<size_t> meshes;
+    };
+    std::vector<DrawBatch> drawBatches;
+    std::vector<GLsizei> drawCounts;          // Scratch arrays for the multi-draw calls
+    std::vector<const void*> drawOffsets;
+    std::vector<GLint> drawBaseVertices;
+
+    // Model-space bounds of each mesh, and the per-instance visibility scratch of DrawInstanced
+    std::vector<AABB> meshBounds;
+    std::vector<uint8_t> meshVisibility;
+
+    // Lazily built ray query structure
+    mutable TriangleBVH bvh;
+    mutable std::once_flag bvhBuilt;
+    mutable std::atomic<bool> bvhReady{ false };
+
+    // Mapped mesh cache the meshes were loaded from (null after an Assimp import). Kept open so the
+    // meshes can be refined and the BVH built from it later; its pages are clean and can be dropped
+    // by the OS at any time.
+    std::unique_ptr<MeshCache> meshCache;
+
+    // Loads a model with supported ASSIMP extensions from file into data.meshes. The returned
+    // scene (null on failure) is owned by the importer.
+    static const aiScene* loadModel(const std::string& path, Assimp::Importer& importer, ModelData& data);
+
+    // Warm path: use a valid mesh cache file instead of running Assimp
+    static bool loadFromMeshCache(const std::string& cachePath, uint64_t sourceHash, ModelData& data);
 
     // Processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode* node, const aiScene* scene);
+    static void processNode(aiNode* node, const aiScene* scene, ModelData& data);
+
+    static ModelData::MeshData processMesh(aiMesh* mesh, const aiScene* scene, ModelData& data);
+
+    // Welds and reorders the imported meshes for the vertex cache (MeshOptimizer), builds their LOD
+    // chains (MeshSimplifier) and reports the ACMR gain. Runs before the mesh cache is written, so
+    // warm starts get the optimized buffers for free.
+    static void optimizeMeshes(ModelData& data);
+
+    // Fills data.meshBounds from the mesh cache's or the imported vertices
+    static void computeMeshBounds(ModelData& data);
+
+    // Lists the material's textures of a given type as (sampler prefix, path) bindings.
+    static std::vector<MeshCache::TextureBinding> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName);
+
+    // Distinct texture paths referenced by the meshes
+    static std::vector<std::string> texturePaths(const ModelData& data);
+
+    // Paths bound as texture_normal, which are compressed as two-channel normal maps
+    static std::unordered_set<std::string> normalMapPaths(const ModelData& data);
 
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene);
+    // Locates an image embedded in the model (e.g. GLB "*0") in the scene, the GLB or the mesh cache
+    static bool findEmbeddedImage(const aiScene* scene, const GlbLoader* glb, const ModelData& data, const std::string& path,
+                                  MeshCache::EmbeddedImage& image);
 
-    // Checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // The required info is returned as a Texture struct.
-    std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName);
+    // Decodes every distinct texture referenced by the meshes (in parallel on the worker pool),
+    // skipping images whose contents are already resident in the TextureCache. Embedded images
+    // are decoded in place from the scene or GLB (if given) or the mapped mesh cache.
+    static void decodeImages(ModelData& data, const aiScene* scene, const GlbLoader* glb);
 
-    // Update bounding box with vertex position
-    void updateBoundingBox(const glm::vec3& position);
+    // Returns the texture this model already uses for the path, or acquires it from the TextureCache
+    Texture findOrLoadTexture(const MeshCache::TextureBinding& binding, const ModelData& data);
+    std::unordered_map<std::string, size_t> textureIndexByPath; // Into textures_loaded
 };
@@ -2,6 +2,16 @@
 #include <iostream>
 #include <algorithm>
 #include <cmath>
+#include <chrono>
+#include <unordered_map>
+
+namespace {
+    // Edge length of the proxy box; matches autoScaleObject's default target size
+    const float PROXY_SIZE = 2.0f;
+
+    // An occlusion box closer than this to the camera could be cut by the near plane (0.1)
+    const float OCCLUSION_NEAR_MARGIN = 0.5f;
+}
 
 MuseumObjectManager::MuseumObjectManager()
 {
@@ -9,6 +19,21 @@ MuseumObjectManager::MuseumObjectManager()
 
 MuseumObjectManager::~MuseumObjectManager()
 {
+    if (proxyVAO) {
+        glDeleteVertexArrays(1, &proxyVAO);
+        glDeleteBuffers(1, &proxyVBO);
+    }
+    if (instanceBuffer) {
+        glDeleteTextures(1, &instanceTexture);
+        glDeleteBuffers(1, &instanceBuffer);
+    }
+    if (occlusionBoxVAO) {
+        glDeleteVertexArrays(1, &occlusionBoxVAO);
+        glDeleteBuffers(1, &occlusionBoxVBO);
+    }
+    for (const auto& query : occlusionQueries) {
+        if (query.second.id) glDeleteQueries(1, &query.second.id);
+    }
 }
 
 void MuseumObjectManager::addObject(const std::string& modelPath, const glm::vec3& position, 
@@ -17,14 +42,156 @@ void MuseumObjectManager::addObject(const std::string& modelPath, const glm::vec
 {
     auto obj = std::make_unique<MuseumObject>(modelPath, position, name, description, ambient, diffuse, specular);
     
+    // A file that is already resident is attached at once; otherwise update() attaches it
+    if (std::shared_ptr<Model> resident = assets.get(modelPath)) {
+        attachModel(obj.get(), resident);
+    } else if (streaming) {
+        obj->loadState = MuseumObject::LoadState::UNLOADED;
+    } else if (assets.request(modelPath) == AssetRegistry::State::LOADING) {
+        std::cout << "Streaming museum object: " << name << " from " << modelPath << std::endl;
+    } else {
+        attachModel(obj.get(), nullptr);
+    }
+    if (fileWatcher) watchModelFiles(modelPath);
+    objects.push_back(std::move(obj));
+    spatialIndexDirty = true;
+}
+
+void MuseumObjectManager::addObject(std::unique_ptr<ModelData> modelData, const glm::vec3& position, 
+                                   const std::string& name, const std::string& description,
+                                   const glm::vec3& ambient, const glm::vec3& diffuse, const glm::vec3& specular)
+{
+    auto obj = std::make_unique<MuseumObject>(modelData->path, position, name, description, ambient, diffuse, specular);
+    attachModel(obj.get(), assets.add(std::move(modelData)));
+    objects.push_back(std::move(obj));
+    spatialIndexDirty = true;
+}
+
+std::vector<size_t> MuseumObjectManager::update(size_t maxUploads)
+{
+    std::vector<size_t> finished;
+    for (const std::string& path : assets.update(maxUploads)) {
+        // Every object waiting for this file gets the same model; after a reload they all switch
+        // to the new one before the next frame is drawn
+        std::shared_ptr<Model> model = assets.get(path);
+        for (size_t i = 0; i < objects.size(); ++i) {
+            MuseumObject* obj = objects[i].get();
+            if (obj->modelPath != path || obj->loadState == MuseumObject::LoadState::UNLOADED) continue;
+            if (obj->loadState != MuseumObject::LoadState::LOADING && obj->model == model) continue;
+            
+            attachModel(obj, model);
+            finished.push_back(i);
+        }
+        if (fileWatcher) watchModelFiles(path);
+    }
+    if (!finished.empty()) spatialIndexDirty = true;
+    
+    // Models start coarse; bring in the detail they were drawn at, within the frame's budget.
+    // Shared models are visited once per object, but only the first visit has work left.
+    size_t refineBudget = refineBytesPerFrame;
+    for (const auto& obj : objects) {
+        if (!obj->model) continue;
+        size_t uploaded = obj->model->Refine(refineBudget);
+        refineBudget -= std::min(refineBudget, uploaded);
+        refinedBytes += uploaded;
+    }
+    
+    // Imports whose objects were removed while loading
+    assets.releaseUnused();
+    return finished;
+}
+
+size_t MuseumObjectManager::getLoadingCount() const
+{
+    size_t count = 0;
+    for (const auto& obj : objects) {
+        if (obj->loadState == MuseumObject::LoadState::LOADING) ++count;
+    }
+    return count;
+}
+
+void MuseumObjectManager::loadModel(const std::string& modelPath)
+{
+    AssetRegistry::State state = assets.request(modelPath);
+    std::shared_ptr<Model> model = assets.get(modelPath);
+    for (const auto& obj : objects) {
+        if (obj->modelPath != modelPath || obj->loadState != MuseumObject::LoadState::UNLOADED) continue;
+        if (state == AssetRegistry::State::LOADING) {
+            obj->loadState = MuseumObject::LoadState::LOADING;
+        } else {
+            attachModel(obj.get(), model);
+            spatialIndexDirty = true;
+        }
+    }
+    if (fileWatcher) watchModelFiles(modelPath);
+}
+
+bool MuseumObjectManager::unloadModel(const std::string& modelPath)
+{
+    std::shared_ptr<Model> model = assets.get(modelPath);
+    for (const auto& obj : objects) {
+        if (obj->modelPath != modelPath) continue;
+        obj->model.reset();
+        obj->loadState = MuseumObject::LoadState::UNLOADED;
+    }
+    
+    // A scan in progress may still hold the model; then the objects keep it for now
+    bool inUse = model && model.use_count() > 2;
+    if (inUse) {
+        for (const auto& obj : objects) {
+            if (obj->modelPath == modelPath) {
+                obj->model = model;
+                obj->loadState = MuseumObject::LoadState::READY;
+            }
+        }
+        return false;
+    }
+    model.reset();
+    assets.release(modelPath);
+    spatialIndexDirty = true;
+    return true;
+}
+
+void MuseumObjectManager::attachModel(MuseumObject* obj, std::shared_ptr<Model> model)
+{
+    obj->model = std::move(model);
+    obj->loadState = obj->model ? MuseumObject::LoadState::READY : MuseumObject::LoadState::FAILED;
+    finishLoading(obj);
+}
+
+void MuseumObjectManager::enableHotReload(FileWatcher& watcher)
+{
+    fileWatcher = &watcher;
+    for (const auto& obj : objects) {
+        watchModelFiles(obj->modelPath);
+    }
+}
+
+void MuseumObjectManager::watchModelFiles(const std::string& modelPath)
+{
+    // The model file itself, then the textures it loaded once it is resident
+    std::vector<std::string> files{ modelPath };
+    if (std::shared_ptr<Model> model = assets.get(modelPath)) {
+        std::vector<std::string> textures = model->GetExternalTextureFiles();
+        files.insert(files.end(), textures.begin(), textures.end());
+    }
+    
+    for (const std::string& file : files) {
+        if (!watchedFiles.emplace(file, modelPath).second) continue;
+        fileWatcher->watch(file, [this, modelPath](const std::string&) { assets.reload(modelPath); });
+    }
+}
+
+void MuseumObjectManager::finishLoading(MuseumObject* obj)
+{
     if (obj->model) {
         // Auto-scale the object to a reasonable size
-        autoScaleObject(obj.get());
-        objects.push_back(std::move(obj));
-        std::cout << "Added museum object: " << name << " at position (" 
-                  << position.x << ", " << position.y << ", " << position.z << ")" << std::endl;
+        autoScaleObject(obj);
+        calculateSpotlightPosition(obj);
+        std::cout << "Added museum object: " << obj->name << " at position (" 
+                  << obj->position.x << ", " << obj->position.y << ", " << obj->position.z << ")" << std::endl;
     } else {
-        std::cout << "Failed to add museum object: " << name << " (model loading failed)" << std::endl;
+        std::cout << "Failed to add museum object: " << obj->name << " (model loading failed, showing placeholder)" << std::endl;
     }
 }
 
@@ -32,6 +199,8 @@ void MuseumObjectManager::removeObject(size_t index)
 {
     if (index < objects.size()) {
         objects.erase(objects.begin() + index);
+        assets.releaseUnused();
+        spatialIndexDirty = true;
     }
 }
 
@@ -53,27 +222,262 @@ const MuseumObject* MuseumObjectManager::getObject(size_t index) const
 
 void MuseumObjectManager::drawAll(Shader& shader)
 {
-    for (auto& obj : objects) {
-        if (obj->model) {
-            // Set the model matrix uniform
-            glm::mat4 modelMatrix = obj->getModelMatrix();
-            shader.setMat4("model", modelMatrix);
+    drawnTriangles = 0;
+    fullDetailTriangles = 0;
+    culledObjects = 0;
+    occlusionTestedObjects = 0;
+    occlusionFrame++;
+    
+    // Group the objects by model, keeping the order in which the models first appear
+    std::vector<std::pair<Model*, std::vector<size_t>>> groups;
+    std::unordered_map<const Model*, size_t> groupByModel;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        const MuseumObject& obj = *objects[i];
+        if (!obj.model) {
+            drawProxy(shader, obj);
+            continue;
+        }
+        auto inserted = groupByModel.emplace(obj.model.get(), groups.size());
+        if (inserted.second) groups.emplace_back(obj.model.get(), std::vector<size_t>());
+        groups[inserted.first->second].second.push_back(i);
+    }
+    if (groups.empty()) return;
+    
+    // One instance per object; within a model, by increasing LOD error as DrawInstanced requires
+    instanceSources.clear();
+    instanceErrors.clear();
+    std::vector<float> errors(objects.size());
+    for (auto& group : groups) {
+        std::vector<size_t>& members = group.second;
+        for (size_t i : members) errors[i] = lodMaxError(*objects[i]);
+        std::stable_sort(members.begin(), members.end(), [&](size_t a, size_t b) { return errors[a] < errors[b]; });
+        
+        for (size_t i : members) {
+            const MuseumObject& obj = *objects[i];
+            instanceSources.push_back({ obj.getModelMatrix(), obj.materialAmbient, obj.materialDiffuse, obj.materialSpecular });
+            instanceErrors.push_back(errors[i]);
+        }
+    }
+    
+    // Transforms, normal matrices and materials for the whole frame in one batched pass
+    instances.resize(instanceSources.size());
+    Model::PackInstances(instanceSources.data(), instanceSources.size(), instances.data());
+    
+    // Frustum culling of each model's bounds under its instances. The visible instances are moved
+    // to the front in place, which keeps every group in LOD order.
+    size_t visibleInstances = 0, groupStart = 0;
+    for (auto& group : groups) {
+        std::vector<size_t>& members = group.second;
+        AABB bounds{ group.first->GetBoundingBoxMin(), group.first->GetBoundingBoxMax() };
+        instanceVisibility.resize(members.size());
+        viewFrustum.cullTransformedBox(bounds, instances[groupStart].modelRows, Model::INSTANCE_TEXELS, members.size(),
+                                       instanceVisibility.data());
+        size_t kept = 0;
+        for (size_t i = 0; i < members.size(); ++i) {
+            if (!instanceVisibility[i]) continue;
+            members[kept++] = members[i];
+            instances[visibleInstances] = instances[groupStart + i];
+            instanceErrors[visibleInstances] = instanceErrors[groupStart + i];
+            visibleInstances++;
+        }
+        groupStart += members.size();
+        culledObjects += members.size() - kept;
+        members.resize(kept);
+    }
+    instances.resize(visibleInstances);
+    instanceErrors.resize(visibleInstances);
+    
+    // Re-specified every frame; growing by doubling keeps reallocations rare
+    if (!instanceBuffer) {
+        glGenBuffers(1, &instanceBuffer);
+        glGenTextures(1, &instanceTexture);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, instanceBuffer);
+    if (instances.size() > instanceCapacity) {
+        instanceCapacity = std::max(instances.size(), instanceCapacity * 2);
+    }
+    glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(instanceCapacity, 1) * sizeof(ModelInstance), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, instances.size() * sizeof(ModelInstance), instances.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    
+    glActiveTexture(GL_TEXTURE0 + Model::INSTANCE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, instanceTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instanceBuffer);
+    glActiveTexture(GL_TEXTURE0);
+    shader.setInt("instanceData", Model::INSTANCE_TEXTURE_UNIT);
+    
+    size_t firstInstance = 0;
+    for (const auto& group : groups) {
+        Model* model = group.first;
+        const std::vector<size_t>& members = group.second;
+        size_t count = members.size();
+        fullDetailTriangles += model->GetTriangleCount() * count;
+        
+        if (occlusionMinTriangles == 0 || model->GetTriangleCount() < occlusionMinTriangles) {
+            drawnTriangles += model->DrawInstanced(shader, firstInstance, &instances[firstInstance],
+                                                   &instanceErrors[firstInstance], count, viewFrustum);
+            firstInstance += count;
+            continue;
+        }
+        
+        // Large exhibits: one draw each, skipped by the GPU if last frame's query saw no samples
+        AABB bounds{ model->GetBoundingBoxMin(), model->GetBoundingBoxMax() };
+        for (size_t i = 0; i < count; ++i, ++firstInstance) {
+            AABB world = bounds.transformed(objects[members[i]]->getModelMatrix());
+            bool cameraInside = !lodViewSet ||
+                glm::all(glm::lessThan(glm::abs(lodCameraPosition - world.center()), world.size() * 0.5f + OCCLUSION_NEAR_MARGIN));
             
-            // Set object-specific material properties
-            shader.setVec3("material.ambient", obj->materialAmbient);
-            shader.setVec3("material.diffuse", obj->materialDiffuse);
-            shader.setVec3("material.specular", obj->materialSpecular);
+            OcclusionQuery* query = nullptr;
+            if (!cameraInside) {
+                query = &occlusionQueries[objects[members[i]].get()];
+                query->frame = occlusionFrame;
+                pendingQueries.push_back({ query, world });
+                occlusionTestedObjects++;
+            }
             
-            // Draw the model
-            obj->model->Draw(shader);
+            if (query && query->issued) glBeginConditionalRender(query->id, GL_QUERY_NO_WAIT);
+            drawnTriangles += model->DrawInstanced(shader, firstInstance, &instances[firstInstance],
+                                                   &instanceErrors[firstInstance], 1, viewFrustum);
+            if (query && query->issued) glEndConditionalRender();
+        }
+    }
+    
+    issueOcclusionQueries(shader);
+}
+
+void MuseumObjectManager::issueOcclusionQueries(Shader& shader)
+{
+    if (!pendingQueries.empty()) {
+        if (!occlusionBoxVAO) {
+            // Solid cube over [0, 1]^3, outward facing
+            static const float corners[8][3] = { {0,0,0}, {1,0,0}, {1,1,0}, {0,1,0}, {0,0,1}, {1,0,1}, {1,1,1}, {0,1,1} };
+            static const int faces[6][4] = { {0,3,2,1}, {4,5,6,7}, {0,1,5,4}, {3,7,6,2}, {0,4,7,3}, {1,2,6,5} };
+            std::vector<float> triangles;
+            for (const auto& face : faces) {
+                for (int corner : { face[0], face[1], face[2], face[0], face[2], face[3] }) {
+                    triangles.insert(triangles.end(), corners[corner], corners[corner] + 3);
+                }
+            }
+            glGenVertexArrays(1, &occlusionBoxVAO);
+            glGenBuffers(1, &occlusionBoxVBO);
+            glBindVertexArray(occlusionBoxVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, occlusionBoxVBO);
+            glBufferData(GL_ARRAY_BUFFER, triangles.size() * sizeof(float), triangles.data(), GL_STATIC_DRAW);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        
+        // The boxes are tested against the depth of everything drawn so far and change nothing
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        shader.setFeatures({ { "HAS_TEXTURE", false }, { "HAS_SPECULAR_MAP", false }, { "HAS_NORMAL_MAP", false } });
+        glBindVertexArray(occlusionBoxVAO);
+        for (const auto& pending : pendingQueries) {
+            OcclusionQuery& query = *pending.first;
+            if (!query.id) glGenQueries(1, &query.id);
+            glm::mat4 boxMatrix = glm::translate(glm::mat4(1.0f), pending.second.min);
+            Mesh::setTransform(shader, glm::scale(boxMatrix, pending.second.size()));
+            glBeginQuery(GL_ANY_SAMPLES_PASSED, query.id);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+            glEndQuery(GL_ANY_SAMPLES_PASSED);
+            query.issued = true;
+        }
+        glBindVertexArray(0);
+        glDepthMask(GL_TRUE);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        pendingQueries.clear();
+    }
+    
+    // Objects that were culled, removed or came too close start over without a query
+    for (auto it = occlusionQueries.begin(); it != occlusionQueries.end();) {
+        if (it->second.frame != occlusionFrame) {
+            if (it->second.id) glDeleteQueries(1, &it->second.id);
+            it = occlusionQueries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void MuseumObjectManager::setLodView(const glm::vec3& cameraPosition, float fovY, float viewportHeight)
+{
+    lodViewSet = true;
+    lodCameraPosition = cameraPosition;
+    lodPixelsPerRadian = viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+}
+
+float MuseumObjectManager::lodMaxError(const MuseumObject& obj) const
+{
+    if (!lodViewSet || !obj.model || lodPixelError <= 0.0f) return 0.0f;
+
+    // Distance to the nearest point of the bounding sphere, so the whole model meets the bound
+    glm::mat4 modelMatrix = obj.getModelMatrix();
+    float scale = std::max(glm::length(glm::vec3(modelMatrix[0])),
+                           std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+    glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(obj.model->GetBoundingBoxCenter(), 1.0f));
+    float radius = glm::length(obj.model->GetBoundingBoxSize()) * 0.5f * scale;
+    float distance = glm::length(center - lodCameraPosition) - radius;
+    if (distance <= 0.0f || scale <= 0.0f) return 0.0f;
+
+    // A world-space error e at this distance covers e * pixelsPerRadian / distance pixels
+    float worldError = lodPixelError * distance / lodPixelsPerRadian;
+    return worldError / scale;
+}
+
+void MuseumObjectManager::drawProxy(Shader& shader, const MuseumObject& obj)
+{
+    if (!proxyVAO) {
+        // 12 edges of a unit cube, as position + normal pairs like the other line/point geometry
+        std::vector<float> lines;
+        for (int axis = 0; axis < 3; ++axis) {
+            for (int corner = 0; corner < 4; ++corner) {
+                glm::vec3 start, end;
+                start[axis] = -0.5f;
+                end[axis] = 0.5f;
+                start[(axis + 1) % 3] = end[(axis + 1) % 3] = (corner & 1) ? 0.5f : -0.5f;
+                start[(axis + 2) % 3] = end[(axis + 2) % 3] = (corner & 2) ? 0.5f : -0.5f;
+                for (const glm::vec3& point : { start, end }) {
+                    lines.insert(lines.end(), { point.x, point.y, point.z, 0.0f, 1.0f, 0.0f });
+                }
+            }
         }
+        
+        glGenVertexArrays(1, &proxyVAO);
+        glGenBuffers(1, &proxyVBO);
+        glBindVertexArray(proxyVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, proxyVBO);
+        glBufferData(GL_ARRAY_BUFFER, lines.size() * sizeof(float), lines.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
     }
+    
+    // The real bounds are unknown until the import finishes, so the box has the auto-scaled size
+    glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), obj.position + glm::vec3(0.0f, PROXY_SIZE * 0.5f, 0.0f));
+    modelMatrix = glm::scale(modelMatrix, glm::vec3(PROXY_SIZE));
+    Mesh::setTransform(shader, modelMatrix);
+    
+    // Loading and unloaded proxies take the exhibit's colour, failed ones are red
+    glm::vec3 color = obj.loadState == MuseumObject::LoadState::FAILED ? glm::vec3(1.0f, 0.15f, 0.1f) : obj.materialDiffuse;
+    shader.setVec3("material.ambient", color);
+    shader.setVec3("material.diffuse", color);
+    shader.setVec3("material.specular", glm::vec3(0.0f));
+    shader.setFeatures({ { "HAS_TEXTURE", false }, { "HAS_SPECULAR_MAP", false }, { "HAS_NORMAL_MAP", false } });
+    
+    glBindVertexArray(proxyVAO);
+    glDrawArrays(GL_LINES, 0, 24);
+    glBindVertexArray(0);
 }
 
 void MuseumObjectManager::loadDefaultObjects()
 {
     // Clear existing objects
     objects.clear();
+    assets.releaseUnused();
+    spatialIndexDirty = true;
     
     // Add different museum objects in strategic positions around the room
     // Assuming the room is roughly 20x20 units
@@ -83,6 +487,11 @@ void MuseumObjectManager::loadDefaultObjects()
               glm::vec3(0.70f, 0.45f, 0.20f),  // Bronze diffuse
               glm::vec3(0.8f, 0.6f, 0.4f));    // Bronze specular
     
+    // Polished bronze picks up reflections in the hybrid renderer
+    if (!objects.empty()) {
+        objects.back()->reflectivity = 0.35f;
+    }
+    
     // Object 2: Center-right - Tombstones with Figure (Stone color)
     addObject("models/kadın.glb", glm::vec3(6.0f, 0.0f, 0.0f), 
               "Figurlu Mezar Tasi | Tombstones with Figure", "Tas | Stone\nRoma Dönemi | Roman Period\nMS 2-3. Yüzyil | 2nd-3rd Century AD",
@@ -119,7 +528,27 @@ void MuseumObjectManager::loadDefaultObjects()
         calculateSpotlightPosition(obj.get());
     }
     
-    std::cout << "Loaded " << objects.size() << " different museum objects with realistic materials and spotlights" << std::endl;
+    std::cout << "Queued " << objects.size() << " different museum objects with realistic materials and spotlights" << std::endl;
+}
+
+void MuseumObjectManager::loadScene(const Scene& scene)
+{
+    objects.clear();
+    assets.releaseUnused();
+    spatialIndexDirty = true;
+    
+    for (const Scene::Exhibit& exhibit : scene.exhibits) {
+        addObject(exhibit.model, exhibit.position, exhibit.name, exhibit.description,
+                  exhibit.ambient, exhibit.diffuse, exhibit.specular);
+        MuseumObject* obj = objects.back().get();
+        obj->rotation = exhibit.rotation;
+        obj->reflectivity = exhibit.reflectivity;
+        obj->transparency = exhibit.transparency;
+        obj->refractiveIndex = exhibit.refractiveIndex;
+        calculateSpotlightPosition(obj);
+    }
+    
+    std::cout << "Placed " << objects.size() << " museum objects in " << scene.rooms.size() << " rooms" << std::endl;
 }
 
 std::vector<std::string> MuseumObjectManager::getObjectNames() const
@@ -128,6 +557,9 @@ std::vector<std::string> MuseumObjectManager::getObjectNames() const
     for (size_t i = 0; i < objects.size(); ++i) {
         const auto& obj = objects[i];
         std::string displayName = obj->name.empty() ? ("Object " + std::to_string(i + 1)) : obj->name;
+        if (obj->loadState == MuseumObject::LoadState::LOADING) displayName += " (loading)";
+        else if (obj->loadState == MuseumObject::LoadState::UNLOADED) displayName += " (not loaded)";
+        else if (obj->loadState == MuseumObject::LoadState::FAILED) displayName += " (failed to load)";
         names.push_back(displayName);
     }
     return names;
@@ -151,6 +583,59 @@ int MuseumObjectManager::findClosestObject(const glm::vec3& position, float maxD
     return closestIndex;
 }
 
+void MuseumObjectManager::rebuildSpatialIndex() const
+{
+    std::vector<AABB> worldBounds(objects.size());
+    inverseModelMatrices.resize(objects.size());
+    
+    for (size_t i = 0; i < objects.size(); ++i) {
+        const MuseumObject* obj = objects[i].get();
+        glm::mat4 modelMatrix = obj->getModelMatrix();
+        inverseModelMatrices[i] = glm::inverse(modelMatrix);
+        
+        if (obj->model) {
+            AABB localBounds{ obj->model->GetBoundingBoxMin(), obj->model->GetBoundingBoxMax() };
+            worldBounds[i] = localBounds.transformed(modelMatrix);
+        }
+    }
+    
+    // One object per leaf keeps the triangle-level tests to the objects the ray actually reaches
+    objectBVH.build(worldBounds, 1);
+    spatialIndexDirty = false;
+}
+
+int MuseumObjectManager::raycast(const glm::vec3& origin, const glm::vec3& direction, float& distance, float maxDistance) const
+{
+    if (spatialIndexDirty) {
+        rebuildSpatialIndex();
+    }
+    
+    int hitIndex = -1;
+    float closest = maxDistance;
+    const std::vector<unsigned int>& order = objectBVH.getPrimitiveIndices();
+    
+    objectBVH.traverse(origin, direction, 0.0f, closest, [&](unsigned int slot, float& tMax) {
+        unsigned int objectIndex = order[slot];
+        const MuseumObject* obj = objects[objectIndex].get();
+        if (!obj->model) return false;
+        
+        // Move the ray into model space; the direction is not renormalized so t stays comparable
+        const glm::mat4& toLocal = inverseModelMatrices[objectIndex];
+        glm::vec3 localOrigin = glm::vec3(toLocal * glm::vec4(origin, 1.0f));
+        glm::vec3 localDirection = glm::vec3(toLocal * glm::vec4(direction, 0.0f));
+        
+        TriangleHit hit;
+        if (!obj->model->GetBVH().intersect(localOrigin, localDirection, 0.0f, tMax, hit)) return false;
+        
+        tMax = hit.t;
+        hitIndex = static_cast<int>(objectIndex);
+        return true;
+    });
+    
+    distance = closest;
+    return hitIndex;
+}
+
 void MuseumObjectManager::autoScaleObject(MuseumObject* obj, float targetSize)
 {
     if (!obj || !obj->model) return;
@@ -3,13 +3,21 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <future>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include "Model.h"
 #include "Shader.h"
+#include "BVH.h"
+#include "AssetRegistry.h"
+#include "FileWatcher.h"
+#include "Scene.h"
+#include <set>
+#include <unordered_map>
 
 struct MuseumObject {
-    std::unique_ptr<Model> model;
+    std::shared_ptr<Model> model;   // Shared with every object placing the same file (AssetRegistry)
+    std::string modelPath;
     glm::vec3 position;
     glm::vec3 rotation; // Euler angles in degrees
     glm::vec3 scale;
@@ -21,20 +29,26 @@ struct MuseumObject {
     glm::vec3 materialDiffuse;
     glm::vec3 materialSpecular;
     
+    // Secondary ray properties used by the hybrid renderer (0 = purely diffuse, not traced)
+    float reflectivity = 0.0f;
+    float transparency = 0.0f;
+    float refractiveIndex = 1.5f;
+    
+    // Streaming state. Until the model's background import is uploaded, the object is drawn as a
+    // bounding-box proxy; a model that fails to load stays in the list as FAILED. UNLOADED objects
+    // have not been requested yet or were evicted (see MuseumObjectManager::setStreaming).
+    enum class LoadState { UNLOADED, LOADING, READY, FAILED };
+    LoadState loadState = LoadState::LOADING;
+    
     // Scanning state for automatic tour
     bool scanned;    MuseumObject(const std::string& modelPath, const glm::vec3& pos, 
                  const std::string& objName = "", const std::string& desc = "",
                  const glm::vec3& ambient = glm::vec3(0.2f, 0.15f, 0.1f),
                  const glm::vec3& diffuse = glm::vec3(0.8f, 0.7f, 0.6f),
                  const glm::vec3& specular = glm::vec3(0.3f, 0.3f, 0.3f))
-        : position(pos), rotation(0.0f), scale(1.0f), name(objName), description(desc),
+        : modelPath(modelPath), position(pos), rotation(0.0f), scale(1.0f), name(objName), description(desc),
           materialAmbient(ambient), materialDiffuse(diffuse), materialSpecular(specular), scanned(false)
     {
-        try {
-            model = std::make_unique<Model>(modelPath);
-        } catch (const std::exception& e) {
-            std::cout << "Failed to load model: " << modelPath << " - " << e.what() << std::endl;
-        }
     }
     
     glm::mat4 getModelMatrix() const {
@@ -65,13 +79,22 @@ class MuseumObjectManager {
 public:
     MuseumObjectManager();
     ~MuseumObjectManager();
-      // Add a museum object
+      // Add a museum object. Returns at once: the model is imported on the worker pool and swapped
+    // in by update(), and a bounding-box proxy is drawn in its place until then. Objects placing
+    // the same file share one import and one Model.
     void addObject(const std::string& modelPath, const glm::vec3& position, 
                    const std::string& name = "", const std::string& description = "",
                    const glm::vec3& ambient = glm::vec3(0.2f, 0.15f, 0.1f),
                    const glm::vec3& diffuse = glm::vec3(0.8f, 0.7f, 0.6f),
                    const glm::vec3& specular = glm::vec3(0.3f, 0.3f, 0.3f));
     
+    // Add a museum object from an already imported model; only the GL upload happens here
+    void addObject(std::unique_ptr<ModelData> modelData, const glm::vec3& position, 
+                   const std::string& name = "", const std::string& description = "",
+                   const glm::vec3& ambient = glm::vec3(0.2f, 0.15f, 0.1f),
+                   const glm::vec3& diffuse = glm::vec3(0.8f, 0.7f, 0.6f),
+                   const glm::vec3& specular = glm::vec3(0.3f, 0.3f, 0.3f));
+    
     // Remove an object by index
     void removeObject(size_t index);
     
@@ -82,8 +105,67 @@ public:
     MuseumObject* getObject(size_t index);
     const MuseumObject* getObject(size_t index) const;
     
-    // Draw all objects
+    // Swap in models whose import has finished, at most maxUploads per call to spread the GL
+    // uploads over several frames, and upload the finer LOD levels the last drawAll() needed
+    // (Model::Refine). Call once per frame on the GL thread.
+    // Returns the indices of the objects that became ready or failed.
+    std::vector<size_t> update(size_t maxUploads = 1);
+
+    // Geometry uploaded per update() for LOD refinement, and the total since start
+    size_t refineBytesPerFrame = size_t(4) << 20;
+    size_t getRefinedBytes() const { return refinedBytes; }
+    
+    // Objects still being imported
+    size_t getLoadingCount() const;
+
+    // With streaming on, objects added later start UNLOADED and their models are only imported
+    // by loadModel() (normally driven by a SceneStreamer) unless they are already resident
+    void setStreaming(bool enabled) { streaming = enabled; }
+    bool isStreaming() const { return streaming; }
+
+    // Requests the model of every object placing this file
+    void loadModel(const std::string& modelPath);
+
+    // Drops the objects' handles so the model and its textures are freed and the objects fall back
+    // to proxies. Returns false (and changes nothing) while something else, e.g. a scan, holds it.
+    bool unloadModel(const std::string& modelPath);
+
+    // Replaces the objects with the exhibits of a scene file
+    void loadScene(const Scene& scene);
+
+    // Re-imports an exhibit's model on the worker pool when the model file or one of its external
+    // textures changes, and swaps it in through update(). Covers objects added later as well.
+    void enableHotReload(FileWatcher& watcher);
+    
+    // Draw all objects (loading and failed ones as bounding-box proxies). Models use the coarsest
+    // LOD whose projected error stays below lodPixelError for the view given to setLodView().
+    // All objects sharing a model are drawn together as instances (Model::DrawInstanced); objects
+    // and meshes outside the frustum given to setFrustum() are skipped.
     void drawAll(Shader& shader);
+
+    // View frustum for culling. Without it nothing is culled.
+    void setFrustum(const Frustum& frustum) { viewFrustum = frustum; }
+
+    // Exhibits of at least this many full-detail triangles are drawn one by one, each under the
+    // occlusion query of its bounding box from the previous frame (conditional rendering), so
+    // large exhibits hidden behind others cost no GPU time. 0 disables the queries.
+    size_t occlusionMinTriangles = 20000;
+
+    // Objects the last drawAll() culled against the frustum, and objects it drew under a query
+    size_t getCulledObjects() const { return culledObjects; }
+    size_t getOcclusionTestedObjects() const { return occlusionTestedObjects; }
+
+    // Camera used for LOD selection: position, vertical field of view (radians) and viewport
+    // height in pixels. Without it every model is drawn at full detail.
+    void setLodView(const glm::vec3& cameraPosition, float fovY, float viewportHeight);
+    float lodPixelError = 1.0f;
+
+    // Triangles submitted by the last drawAll(), and what full detail would have cost
+    size_t getDrawnTriangles() const { return drawnTriangles; }
+    size_t getFullDetailTriangles() const { return fullDetailTriangles; }
+
+    // Models shared by the objects
+    const AssetRegistry& getAssets() const { return assets; }
     
     // Load default museum objects
     void loadDefaultObjects();
@@ -93,6 +175,13 @@ public:
     
     // Find closest object to a position (for robot interaction)
     int findClosestObject(const glm::vec3& position, float maxDistance = 5.0f) const;
+    
+    // Closest exhibit hit by a world-space ray, tested against real triangles through a two-level
+    // BVH (objects on top, per-model triangles below). Returns -1 if nothing is hit.
+    int raycast(const glm::vec3& origin, const glm::vec3& direction, float& distance, float maxDistance = FLT_MAX) const;
+    
+    // Must be called after moving, rotating or scaling objects so raycast() sees the new transforms
+    void invalidateSpatialIndex() { spatialIndexDirty = true; }
 
     // Museum object spotlight management
     void updateObjectSpotlights(const glm::vec3& robotPosition, float deltaTime);
@@ -114,6 +203,65 @@ public:
     
 private:
     std::vector<std::unique_ptr<MuseumObject>> objects;
+    AssetRegistry assets;
+    
+    // Top-level BVH over world-space object bounds, rebuilt lazily
+    mutable BVH objectBVH;
+    mutable std::vector<glm::mat4> inverseModelMatrices;
+    mutable bool spatialIndexDirty = true;
+    void rebuildSpatialIndex() const;
+    
+    // LOD selection state
+    bool lodViewSet = false;
+    glm::vec3 lodCameraPosition = glm::vec3(0.0f);
+    float lodPixelsPerRadian = 0.0f;   // Viewport height / (2 tan(fovY / 2))
+    size_t drawnTriangles = 0, fullDetailTriangles = 0;
+    size_t refinedBytes = 0;
+    float lodMaxError(const MuseumObject& obj) const;
+
+    bool streaming = false;
+
+    // Attaches the resident (or failed) model to an object that was waiting for it
+    void attachModel(MuseumObject* obj, std::shared_ptr<Model> model);
+
+    // Hot reload: (file, model path) pairs already registered with the watcher
+    FileWatcher* fileWatcher = nullptr;
+    std::set<std::pair<std::string, std::string>> watchedFiles;
+    void watchModelFiles(const std::string& modelPath);
+
+    // Per-frame instance data of drawAll(), grouped by model and sorted by LOD error within a group,
+    // uploaded to a texture buffer that shader.vert indexes by instance
+    unsigned int instanceBuffer = 0, instanceTexture = 0;
+    size_t instanceCapacity = 0;
+    std::vector<InstanceSource> instanceSources;
+    std::vector<ModelInstance> instances;
+    std::vector<float> instanceErrors;
+    std::vector<uint8_t> instanceVisibility;
+
+    // Culling state
+    Frustum viewFrustum;
+    size_t culledObjects = 0, occlusionTestedObjects = 0;
+
+    // Occlusion queries of the large exhibits, issued on their world bounding boxes at the end of
+    // drawAll() and tested by the next one; an object that was not a candidate in a frame loses its
+    // query. Objects whose box holds the camera are drawn without one (their box would be clipped).
+    struct OcclusionQuery {
+        unsigned int id = 0;
+        bool issued = false;
+        size_t frame = 0;
+    };
+    std::unordered_map<const MuseumObject*, OcclusionQuery> occlusionQueries;
+    std::vector<std::pair<OcclusionQuery*, AABB>> pendingQueries;   // Boxes to query this frame
+    size_t occlusionFrame = 0;
+    unsigned int occlusionBoxVAO = 0, occlusionBoxVBO = 0;   // Solid unit cube, created on first use
+    void issueOcclusionQueries(Shader& shader);
+
+    // Unit cube outline drawn for objects without a model, created on first use
+    unsigned int proxyVAO = 0, proxyVBO = 0;
+    void drawProxy(Shader& shader, const MuseumObject& obj);
+    
+    // Applies the placement that depends on the model's bounds once it has been swapped in
+    void finishLoading(MuseumObject* obj);
     
     // Helper function to auto-scale objects based on their bounding box
     void autoScaleObject(MuseumObject* obj, float targetSize = 2.0f);
@@ -1,6 +1,10 @@
 #include "MuseumRoom.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 
 MuseumRoom::MuseumRoom() {
+    rooms.push_back({ glm::vec3(0.0f), glm::vec3(20.0f, 8.0f, 20.0f) });
     setupRoom();
 }
 
@@ -9,6 +13,32 @@ MuseumRoom::~MuseumRoom() {
     glDeleteBuffers(1, &VBO);
 }
 
+void MuseumRoom::setRooms(const std::vector<Box>& newRooms) {
+    if (newRooms.empty()) return;
+    rooms = newRooms;
+    generateRoomGeometry();
+    
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizei>(vertices.size() * sizeof(float)), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+glm::vec3 MuseumRoom::getBoundsMin() const {
+    glm::vec3 result(FLT_MAX);
+    for (const Box& room : rooms) {
+        result = glm::min(result, room.center - glm::vec3(room.size.x * 0.5f, 0.0f, room.size.z * 0.5f));
+    }
+    return result;
+}
+
+glm::vec3 MuseumRoom::getBoundsMax() const {
+    glm::vec3 result(-FLT_MAX);
+    for (const Box& room : rooms) {
+        result = glm::max(result, room.center + glm::vec3(room.size.x * 0.5f, room.size.y, room.size.z * 0.5f));
+    }
+    return result;
+}
+
 void MuseumRoom::setupRoom() {
     generateRoomGeometry();
     
@@ -43,93 +73,96 @@ void MuseumRoom::render() {
 
 void MuseumRoom::generateRoomGeometry() {
     vertices.clear();
+    surfaces.clear();
     
-    // Room dimensions
-    float width = 20.0f;
-    float height = 8.0f;
-    float depth = 20.0f;
-    
-    // Floor (y = 0)
-    // Triangle 1
-    vertices.insert(vertices.end(), {
-        -width/2, 0.0f, -depth/2,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f,  // Bottom-left
-         width/2, 0.0f, -depth/2,  0.0f, 1.0f, 0.0f,  1.0f, 0.0f,  // Bottom-right
-         width/2, 0.0f,  depth/2,  0.0f, 1.0f, 0.0f,  1.0f, 1.0f   // Top-right
-    });
-    // Triangle 2
-    vertices.insert(vertices.end(), {
-         width/2, 0.0f,  depth/2,  0.0f, 1.0f, 0.0f,  1.0f, 1.0f,  // Top-right
-        -width/2, 0.0f,  depth/2,  0.0f, 1.0f, 0.0f,  0.0f, 1.0f,  // Top-left
-        -width/2, 0.0f, -depth/2,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f   // Bottom-left
-    });
-    
-    // Ceiling (y = height)
-    // Triangle 1
-    vertices.insert(vertices.end(), {
-        -width/2, height, -depth/2,  0.0f, -1.0f, 0.0f,  0.0f, 0.0f,  // Bottom-left
-         width/2, height,  depth/2,  0.0f, -1.0f, 0.0f,  1.0f, 1.0f,  // Top-right
-         width/2, height, -depth/2,  0.0f, -1.0f, 0.0f,  1.0f, 0.0f   // Bottom-right
-    });
-    // Triangle 2
-    vertices.insert(vertices.end(), {
-         width/2, height,  depth/2,  0.0f, -1.0f, 0.0f,  1.0f, 1.0f,  // Top-right
-        -width/2, height, -depth/2,  0.0f, -1.0f, 0.0f,  0.0f, 0.0f,  // Bottom-left
-        -width/2, height,  depth/2,  0.0f, -1.0f, 0.0f,  0.0f, 1.0f   // Top-left
-    });
-    
-    // Front wall (z = depth/2)
-    // Triangle 1
-    vertices.insert(vertices.end(), {
-        -width/2, 0.0f, depth/2,  0.0f, 0.0f, -1.0f,  0.0f, 0.0f,  // Bottom-left
-         width/2, 0.0f, depth/2,  0.0f, 0.0f, -1.0f,  1.0f, 0.0f,  // Bottom-right
-         width/2, height, depth/2,  0.0f, 0.0f, -1.0f,  1.0f, 1.0f   // Top-right
-    });
-    // Triangle 2
-    vertices.insert(vertices.end(), {
-         width/2, height, depth/2,  0.0f, 0.0f, -1.0f,  1.0f, 1.0f,  // Top-right
-        -width/2, height, depth/2,  0.0f, 0.0f, -1.0f,  0.0f, 1.0f,  // Top-left
-        -width/2, 0.0f, depth/2,  0.0f, 0.0f, -1.0f,  0.0f, 0.0f   // Bottom-left
-    });
+    // Openings cut into walls shared by two rooms
+    const float doorWidth = 3.0f;
+    const float doorHeight = 3.5f;
     
-    // Back wall (z = -depth/2)
-    // Triangle 1
-    vertices.insert(vertices.end(), {
-        -width/2, 0.0f, -depth/2,  0.0f, 0.0f, 1.0f,  1.0f, 0.0f,  // Bottom-left
-         width/2, height, -depth/2,  0.0f, 0.0f, 1.0f,  0.0f, 1.0f,  // Top-right
-         width/2, 0.0f, -depth/2,  0.0f, 0.0f, 1.0f,  0.0f, 0.0f   // Bottom-right
-    });
-    // Triangle 2
-    vertices.insert(vertices.end(), {
-         width/2, height, -depth/2,  0.0f, 0.0f, 1.0f,  0.0f, 1.0f,  // Top-right
-        -width/2, 0.0f, -depth/2,  0.0f, 0.0f, 1.0f,  1.0f, 0.0f,  // Bottom-left
-        -width/2, height, -depth/2,  0.0f, 0.0f, 1.0f,  1.0f, 1.0f   // Top-left
-    });
+    for (const Box& room : rooms) {
+        glm::vec3 roomMin = room.center - glm::vec3(room.size.x * 0.5f, 0.0f, room.size.z * 0.5f);
+        glm::vec3 roomMax = room.center + glm::vec3(room.size.x * 0.5f, room.size.y, room.size.z * 0.5f);
+        glm::vec2 floorExtent(room.size.x, room.size.z);
+        
+        // Floor (y = min) and ceiling (y = max)
+        addQuad(roomMin, glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+                glm::vec2(0.0f), floorExtent, floorExtent, glm::vec3(0.0f, 1.0f, 0.0f));
+        addQuad(glm::vec3(roomMin.x, roomMax.y, roomMin.z), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+                glm::vec2(0.0f), floorExtent, floorExtent, glm::vec3(0.0f, -1.0f, 0.0f));
+        
+        // Walls facing X (running along Z) and facing Z (running along X), on both sides
+        for (int axis : { 0, 2 }) {
+            int alongAxis = 2 - axis;
+            for (bool maxSide : { false, true }) {
+                float plane = maxSide ? roomMax[axis] : roomMin[axis];
+                
+                // A neighbour whose opposite wall lies in the same plane gets a doorway in the middle of the overlap
+                std::vector<glm::vec2> doorways;
+                for (const Box& other : rooms) {
+                    if (&other == &room) continue;
+                    float otherPlane = maxSide ? other.center[axis] - other.size[axis] * 0.5f
+                                               : other.center[axis] + other.size[axis] * 0.5f;
+                    if (std::abs(otherPlane - plane) > 1e-3f) continue;
+                    
+                    float overlapStart = std::max(roomMin[alongAxis], other.center[alongAxis] - other.size[alongAxis] * 0.5f);
+                    float overlapEnd = std::min(roomMax[alongAxis], other.center[alongAxis] + other.size[alongAxis] * 0.5f);
+                    float width = std::min(doorWidth, overlapEnd - overlapStart - 0.5f);
+                    if (width <= 0.0f) continue;
+                    
+                    float middle = (overlapStart + overlapEnd) * 0.5f - roomMin[alongAxis];
+                    doorways.push_back(glm::vec2(middle - width * 0.5f, middle + width * 0.5f));
+                }
+                
+                glm::vec3 origin = roomMin;
+                origin[axis] = plane;
+                glm::vec3 along(0.0f), normal(0.0f);
+                along[alongAxis] = 1.0f;
+                normal[axis] = maxSide ? -1.0f : 1.0f;   // Facing into the room
+                addWall(origin, along, glm::vec3(0.0f, 1.0f, 0.0f), room.size[alongAxis], room.size.y,
+                        normal, doorways, std::min(doorHeight, room.size.y - 0.5f));
+            }
+        }
+    }
+}
+
+void MuseumRoom::addWall(const glm::vec3& origin, const glm::vec3& along, const glm::vec3& up, float length, float height,
+                         const glm::vec3& normal, const std::vector<glm::vec2>& doorways, float doorHeight) {
+    std::vector<glm::vec2> openings = doorways;
+    std::sort(openings.begin(), openings.end(), [](const glm::vec2& a, const glm::vec2& b) { return a.x < b.x; });
     
-    // Left wall (x = -width/2)
-    // Triangle 1
-    vertices.insert(vertices.end(), {
-        -width/2, 0.0f, -depth/2,  1.0f, 0.0f, 0.0f,  0.0f, 0.0f,  // Bottom-left
-        -width/2, 0.0f,  depth/2,  1.0f, 0.0f, 0.0f,  1.0f, 0.0f,  // Bottom-right
-        -width/2, height,  depth/2,  1.0f, 0.0f, 0.0f,  1.0f, 1.0f   // Top-right
-    });
-    // Triangle 2
-    vertices.insert(vertices.end(), {
-        -width/2, height,  depth/2,  1.0f, 0.0f, 0.0f,  1.0f, 1.0f,  // Top-right
-        -width/2, height, -depth/2,  1.0f, 0.0f, 0.0f,  0.0f, 1.0f,  // Top-left
-        -width/2, 0.0f, -depth/2,  1.0f, 0.0f, 0.0f,  0.0f, 0.0f   // Bottom-left
-    });
+    glm::vec2 extent(length, height);
+    float cursor = 0.0f;
+    for (glm::vec2 opening : openings) {
+        opening.x = std::max(opening.x, cursor);
+        opening.y = std::min(opening.y, length);
+        if (opening.y <= opening.x) continue;
+        
+        // Solid wall up to the doorway, then the lintel above it
+        if (opening.x > cursor) {
+            addQuad(origin, along, up, glm::vec2(cursor, 0.0f), glm::vec2(opening.x, height), extent, normal);
+        }
+        addQuad(origin, along, up, glm::vec2(opening.x, doorHeight), glm::vec2(opening.y, height), extent, normal);
+        cursor = opening.y;
+    }
+    if (cursor < length) {
+        addQuad(origin, along, up, glm::vec2(cursor, 0.0f), glm::vec2(length, height), extent, normal);
+    }
+}
+
+void MuseumRoom::addQuad(const glm::vec3& origin, const glm::vec3& along, const glm::vec3& up,
+                         glm::vec2 from, glm::vec2 to, const glm::vec2& extent, const glm::vec3& normal) {
+    surfaces.push_back({ origin + along * from.x + up * from.y, along * (to.x - from.x), up * (to.y - from.y), normal });
     
-    // Right wall (x = width/2)
-    // Triangle 1
-    vertices.insert(vertices.end(), {
-         width/2, 0.0f, -depth/2,  -1.0f, 0.0f, 0.0f,  1.0f, 0.0f,  // Bottom-left
-         width/2, height,  depth/2,  -1.0f, 0.0f, 0.0f,  0.0f, 1.0f,  // Top-right
-         width/2, 0.0f,  depth/2,  -1.0f, 0.0f, 0.0f,  0.0f, 0.0f   // Bottom-right
-    });
-    // Triangle 2
-    vertices.insert(vertices.end(), {
-         width/2, height,  depth/2,  -1.0f, 0.0f, 0.0f,  0.0f, 1.0f,  // Top-right
-         width/2, 0.0f, -depth/2,  -1.0f, 0.0f, 0.0f,  1.0f, 0.0f,  // Bottom-left
-         width/2, height, -depth/2,  -1.0f, 0.0f, 0.0f,  1.0f, 1.0f   // Top-left
-    });
+    // Texture coordinates span the whole floor or wall, like the single-room layout did
+    glm::vec2 corners[6] = {
+        glm::vec2(from.x, from.y), glm::vec2(to.x, from.y), glm::vec2(to.x, to.y),
+        glm::vec2(to.x, to.y), glm::vec2(from.x, to.y), glm::vec2(from.x, from.y)
+    };
+    for (const glm::vec2& corner : corners) {
+        glm::vec3 position = origin + along * corner.x + up * corner.y;
+        glm::vec2 texCoord = corner / extent;
+        vertices.insert(vertices.end(), {
+            position.x, position.y, position.z,  normal.x, normal.y, normal.z,  texCoord.x, texCoord.y
+        });
+    }
 }
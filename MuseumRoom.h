@@ -7,17 +7,49 @@
 
 class MuseumRoom {
 public:
+    // An axis-aligned room: floor centre and width x height x depth
+    struct Box {
+        glm::vec3 center;
+        glm::vec3 size;
+    };
+    
+    // Starts as the single 20x8x20 hall centred at the origin
     MuseumRoom();
     ~MuseumRoom();
     
+    // Replaces the rooms. Walls shared by two rooms get a doorway where the rooms overlap.
+    void setRooms(const std::vector<Box>& rooms);
+    const std::vector<Box>& getRooms() const { return rooms; }
+    
+    // One rectangle of the generated floors, ceilings and walls (doorways already left out)
+    struct Surface {
+        glm::vec3 origin;
+        glm::vec3 edgeU, edgeV;
+        glm::vec3 normal;   // Facing into the room
+    };
+    const std::vector<Surface>& getSurfaces() const { return surfaces; }
+    
+    // Bounds of all rooms together
+    glm::vec3 getBoundsMin() const;
+    glm::vec3 getBoundsMax() const;
+    
     void setupRoom();
     void render();
     
 private:
-    unsigned int VAO, VBO;
+    unsigned int VAO = 0, VBO = 0;
     std::vector<float> vertices;
+    std::vector<Box> rooms;
+    std::vector<Surface> surfaces;
     
     void generateRoomGeometry();
+    
+    // Appends a wall rectangle spanning [0, length] along `along` and [0, height] along `up` from
+    // origin, leaving out the given doorway intervals (along the wall) up to doorHeight
+    void addWall(const glm::vec3& origin, const glm::vec3& along, const glm::vec3& up, float length, float height,
+                 const glm::vec3& normal, const std::vector<glm::vec2>& doorways, float doorHeight);
+    void addQuad(const glm::vec3& origin, const glm::vec3& along, const glm::vec3& up,
+                 glm::vec2 from, glm::vec2 to, const glm::vec2& extent, const glm::vec3& normal);
 };
 
 #endif
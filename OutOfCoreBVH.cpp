@@ -0,0 +1,481 @@
+#include "OutOfCoreBVH.h"
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <fstream>
+#include <iostream>
+#include <atomic>
+#include <functional>
+#include <cstring>
+#include <cstdio>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+namespace {
+    // Treelet blocks start on a page boundary so each one maps without touching its neighbours
+    const uint64_t TREELET_ALIGNMENT = 4096;
+
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t triangleCount;
+        uint32_t topNodeCount;
+        uint32_t treeletCount;
+        uint32_t reserved;
+        uint64_t sourceSize;          // Size and modification time of the converted model,
+        int64_t sourceModifiedTime;   // used to detect a stale file
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+
+    static_assert(sizeof(BVH::Node) == 32, "BVH::Node is written to disk as-is");
+    static_assert(sizeof(TriangleBVH::Triangle) == 40, "TriangleBVH::Triangle is written to disk as-is");
+    static_assert(sizeof(glm::vec3) == 12, "glm::vec3 must be tightly packed");
+
+    bool readSourceStamp(const std::string& path, uint64_t& size, int64_t& modifiedTime)
+    {
+#ifdef _WIN32
+        struct _stat64 info;
+        if (_stat64(path.c_str(), &info) != 0) return false;
+#else
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) return false;
+#endif
+        size = static_cast<uint64_t>(info.st_size);
+        modifiedTime = static_cast<int64_t>(info.st_mtime);
+        return true;
+    }
+
+    void padTo(std::ofstream& out, uint64_t alignment)
+    {
+        static const char zeros[TREELET_ALIGNMENT] = {};
+        uint64_t position = static_cast<uint64_t>(out.tellp());
+        uint64_t padding = (alignment - position % alignment) % alignment;
+        out.write(zeros, static_cast<std::streamsize>(padding));
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// TreeletCache
+
+TreeletCache& TreeletCache::shared()
+{
+    static TreeletCache cache;
+    return cache;
+}
+
+std::shared_ptr<const MappedView> TreeletCache::acquire(const OutOfCoreBVH& mesh, unsigned int treelet)
+{
+    uint64_t key = (static_cast<uint64_t>(mesh.meshId) << 32) | treelet;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto found = entries.find(key);
+    if (found != entries.end()) {
+        lru.splice(lru.begin(), lru, found->second.lruPosition);
+        stats.hits++;
+        return found->second.view;
+    }
+
+    size_t bytes = mesh.treeletBytes(treelet);
+    evictUntil(budget > bytes ? budget - bytes : 0);
+
+    std::shared_ptr<const MappedView> view(mesh.mapTreelet(treelet));
+    if (!view) {
+        // Most likely out of address space: give everything back and try once more
+        evictUntil(0);
+        view = std::shared_ptr<const MappedView>(mesh.mapTreelet(treelet));
+        if (!view) {
+            stats.failedMaps++;
+            return nullptr;
+        }
+    }
+
+    lru.push_front(key);
+    entries[key] = Entry{ view, lru.begin() };
+    stats.residentBytes += view->size();
+    stats.residentTreelets++;
+    stats.pageIns++;
+    return view;
+}
+
+void TreeletCache::setBudget(size_t budgetBytes)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    budget = budgetBytes;
+    evictUntil(budget);
+}
+
+void TreeletCache::release(uint32_t meshId)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    for (auto it = lru.begin(); it != lru.end();) {
+        if ((*it >> 32) != meshId) {
+            ++it;
+            continue;
+        }
+        auto entry = entries.find(*it);
+        stats.residentBytes -= entry->second.view->size();
+        stats.residentTreelets--;
+        entries.erase(entry);
+        it = lru.erase(it);
+    }
+}
+
+TreeletCache::Stats TreeletCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return stats;
+}
+
+void TreeletCache::evictUntil(size_t targetBytes)
+{
+    while (stats.residentBytes > targetBytes && !lru.empty()) {
+        auto entry = entries.find(lru.back());
+        stats.residentBytes -= entry->second.view->size();
+        stats.residentTreelets--;
+        stats.evictions++;
+        entries.erase(entry);
+        lru.pop_back();
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// OutOfCoreBVH
+
+OutOfCoreBVH::~OutOfCoreBVH()
+{
+    if (cache) cache->release(meshId);
+}
+
+bool OutOfCoreBVH::build(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices,
+                         const std::string& outputPath, unsigned int trianglesPerTreelet)
+{
+    return writeTreeletFile(positions, indices, outputPath, trianglesPerTreelet, 0, 0);
+}
+
+bool OutOfCoreBVH::convertModel(const std::string& modelPath, const std::string& outputPath)
+{
+    uint64_t sourceSize = 0;
+    int64_t sourceModifiedTime = 0;
+    if (!readSourceStamp(modelPath, sourceSize, sourceModifiedTime)) {
+        std::cout << "ERROR::OUT_OF_CORE:: Model file not found: " << modelPath << std::endl;
+        return false;
+    }
+
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    {
+        // Only positions are needed, so strip everything else during import to keep the peak low
+        Assimp::Importer importer;
+        importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS,
+            aiComponent_NORMALS | aiComponent_TANGENTS_AND_BITANGENTS | aiComponent_COLORS |
+            aiComponent_TEXCOORDS | aiComponent_BONEWEIGHTS | aiComponent_ANIMATIONS |
+            aiComponent_TEXTURES | aiComponent_LIGHTS | aiComponent_CAMERAS | aiComponent_MATERIALS);
+        const aiScene* scene = importer.ReadFile(modelPath,
+            aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_RemoveComponent);
+        if (!scene || !scene->mRootNode) {
+            std::cout << "ERROR::OUT_OF_CORE:: " << importer.GetErrorString() << std::endl;
+            return false;
+        }
+
+        // Node transforms are ignored, matching Model::processNode
+        for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
+            const aiMesh* mesh = scene->mMeshes[m];
+            unsigned int base = static_cast<unsigned int>(positions.size());
+            for (unsigned int v = 0; v < mesh->mNumVertices; ++v) {
+                positions.push_back(glm::vec3(mesh->mVertices[v].x, mesh->mVertices[v].y, mesh->mVertices[v].z));
+            }
+            for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+                const aiFace& face = mesh->mFaces[f];
+                if (face.mNumIndices != 3) continue; // Points and lines
+                indices.push_back(base + face.mIndices[0]);
+                indices.push_back(base + face.mIndices[1]);
+                indices.push_back(base + face.mIndices[2]);
+            }
+        }
+    }
+
+    return writeTreeletFile(positions, indices, outputPath, 4096, sourceSize, sourceModifiedTime);
+}
+
+std::shared_ptr<OutOfCoreBVH> OutOfCoreBVH::loadOrConvert(const std::string& modelPath, TreeletCache* cache)
+{
+    std::string cachePath = modelPath + ".oocbvh";
+
+    uint64_t sourceSize = 0;
+    int64_t sourceModifiedTime = 0;
+    bool haveSource = readSourceStamp(modelPath, sourceSize, sourceModifiedTime);
+
+    // Reuse the existing file if it was made from this exact model file
+    {
+        MappedFile existing;
+        if (existing.open(cachePath)) {
+            std::unique_ptr<MappedView> headerView = existing.map(0, sizeof(FileHeader));
+            if (headerView) {
+                FileHeader header;
+                std::memcpy(&header, headerView->data(), sizeof(header));
+                bool current = !haveSource || (header.sourceSize == sourceSize && header.sourceModifiedTime == sourceModifiedTime);
+                if (current) {
+                    auto mesh = std::make_shared<OutOfCoreBVH>();
+                    existing.close();
+                    if (mesh->open(cachePath, cache)) return mesh;
+                }
+            }
+        }
+    }
+
+    if (!haveSource) return nullptr;
+
+    std::cout << "Building out-of-core BVH for " << modelPath << "..." << std::endl;
+    if (!convertModel(modelPath, cachePath)) return nullptr;
+
+    auto mesh = std::make_shared<OutOfCoreBVH>();
+    if (!mesh->open(cachePath, cache)) return nullptr;
+    return mesh;
+}
+
+bool OutOfCoreBVH::open(const std::string& path, TreeletCache* treeletCache)
+{
+    static std::atomic<uint32_t> nextMeshId(1);
+
+    if (cache) cache->release(meshId);
+    topNodes.clear();
+    treelets.clear();
+    triangleCount = 0;
+
+    if (!file.open(path)) {
+        std::cout << "ERROR::OUT_OF_CORE:: Failed to open " << path << std::endl;
+        return false;
+    }
+
+    std::unique_ptr<MappedView> headerView = file.map(0, sizeof(FileHeader));
+    if (!headerView) {
+        std::cout << "ERROR::OUT_OF_CORE:: File too small: " << path << std::endl;
+        file.close();
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, headerView->data(), sizeof(header));
+    headerView.reset();
+
+    uint64_t directoryBytes = static_cast<uint64_t>(header.topNodeCount) * sizeof(BVH::Node) +
+                              static_cast<uint64_t>(header.treeletCount) * sizeof(TreeletEntry);
+    if (std::memcmp(header.magic, "OOCB", 4) != 0 || header.version != FILE_VERSION ||
+        header.topNodeCount == 0 || sizeof(FileHeader) + directoryBytes > file.size()) {
+        std::cout << "ERROR::OUT_OF_CORE:: Invalid or outdated file: " << path << std::endl;
+        file.close();
+        return false;
+    }
+
+    // The top-level tree and treelet directory are small and stay resident
+    std::unique_ptr<MappedView> directory = file.map(sizeof(FileHeader), static_cast<size_t>(directoryBytes));
+    if (!directory) {
+        file.close();
+        return false;
+    }
+    topNodes.resize(header.topNodeCount);
+    treelets.resize(header.treeletCount);
+    std::memcpy(topNodes.data(), directory->data(), topNodes.size() * sizeof(BVH::Node));
+    std::memcpy(treelets.data(), directory->data() + topNodes.size() * sizeof(BVH::Node), treelets.size() * sizeof(TreeletEntry));
+
+    for (const TreeletEntry& entry : treelets) {
+        if (entry.offset + treeletBytes(static_cast<unsigned int>(&entry - treelets.data())) > file.size()) {
+            std::cout << "ERROR::OUT_OF_CORE:: Truncated file: " << path << std::endl;
+            topNodes.clear();
+            treelets.clear();
+            file.close();
+            return false;
+        }
+    }
+
+    triangleCount = header.triangleCount;
+    bounds.min = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    bounds.max = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    cache = treeletCache ? treeletCache : &TreeletCache::shared();
+    meshId = nextMeshId++;
+    return true;
+}
+
+size_t OutOfCoreBVH::treeletBytes(unsigned int treelet) const
+{
+    const TreeletEntry& entry = treelets[treelet];
+    return entry.nodeCount * sizeof(BVH::Node) + entry.triangleCount * sizeof(TriangleBVH::Triangle);
+}
+
+std::unique_ptr<MappedView> OutOfCoreBVH::mapTreelet(unsigned int treelet) const
+{
+    return file.map(treelets[treelet].offset, treeletBytes(treelet));
+}
+
+bool OutOfCoreBVH::intersect(const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax, TriangleHit& hit) const
+{
+    if (topNodes.empty()) return false;
+
+    // Top-level leaves are treelets; each one is mapped (or found in the cache) only when reached,
+    // and front-to-back order means treelets behind the closest hit are never paged in
+    return BVH::traverseNodes(topNodes.data(), origin, direction, tMin, tMax, [&](unsigned int treelet, float& closest) {
+        std::shared_ptr<const MappedView> view = cache->acquire(*this, treelet);
+        if (!view) return false;
+
+        const TreeletEntry& entry = treelets[treelet];
+        const BVH::Node* nodes = reinterpret_cast<const BVH::Node*>(view->data());
+        const TriangleBVH::Triangle* triangles =
+            reinterpret_cast<const TriangleBVH::Triangle*>(view->data() + entry.nodeCount * sizeof(BVH::Node));
+
+        return BVH::traverseNodes(nodes, origin, direction, tMin, closest, [&](unsigned int slot, float& nearest) {
+            const TriangleBVH::Triangle& triangle = triangles[slot];
+            float t, u, v;
+            if (!intersectTriangle(origin, direction, triangle.v0, triangle.v1, triangle.v2, tMin, nearest, t, u, v)) {
+                return false;
+            }
+            nearest = t;
+            hit.t = t;
+            hit.triangle = triangle.originalIndex;
+            hit.u = u;
+            hit.v = v;
+            hit.normal = glm::normalize(glm::cross(triangle.v1 - triangle.v0, triangle.v2 - triangle.v0));
+            return true;
+        });
+    });
+}
+
+bool OutOfCoreBVH::writeTreeletFile(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices,
+                                const std::string& outputPath, unsigned int trianglesPerTreelet,
+                                uint64_t sourceSize, int64_t sourceModifiedTime)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        std::cout << "ERROR::OUT_OF_CORE:: Mesh has no triangles: " << outputPath << std::endl;
+        return false;
+    }
+
+    std::vector<TriangleBVH::Triangle> triangles(triangleCount);
+    std::vector<AABB> triangleBounds(triangleCount);
+    for (size_t i = 0; i < triangleCount; ++i) {
+        TriangleBVH::Triangle& triangle = triangles[i];
+        triangle.v0 = positions[indices[i * 3 + 0]];
+        triangle.v1 = positions[indices[i * 3 + 1]];
+        triangle.v2 = positions[indices[i * 3 + 2]];
+        triangle.originalIndex = static_cast<unsigned int>(i);
+        triangleBounds[i].grow(triangle.v0);
+        triangleBounds[i].grow(triangle.v1);
+        triangleBounds[i].grow(triangle.v2);
+    }
+
+    BVH bvh;
+    bvh.build(triangleBounds, 4);
+    triangleBounds.clear();
+    triangleBounds.shrink_to_fit();
+
+    const std::vector<BVH::Node>& nodes = bvh.getNodes();
+    const std::vector<unsigned int>& primitives = bvh.getPrimitiveIndices();
+
+    // Triangles below every node
+    std::vector<uint32_t> subtreeTriangles(nodes.size(), 0);
+    std::function<uint32_t(unsigned int)> countTriangles = [&](unsigned int node) -> uint32_t {
+        const BVH::Node& n = nodes[node];
+        subtreeTriangles[node] = n.isLeaf() ? n.count : countTriangles(n.leftFirst) + countTriangles(n.leftFirst + 1);
+        return subtreeTriangles[node];
+    };
+    countTriangles(0);
+
+    // Cut the tree: the first node on each path whose subtree fits the budget becomes a treelet
+    std::vector<BVH::Node> topNodes(1);
+    std::vector<unsigned int> treeletRoots;
+    std::function<void(size_t, unsigned int)> cut = [&](size_t slot, unsigned int node) {
+        const BVH::Node& n = nodes[node];
+        if (n.isLeaf() || subtreeTriangles[node] <= trianglesPerTreelet) {
+            topNodes[slot] = BVH::Node{ n.boundsMin, static_cast<unsigned int>(treeletRoots.size()), n.boundsMax, 1 };
+            treeletRoots.push_back(node);
+            return;
+        }
+        unsigned int child = static_cast<unsigned int>(topNodes.size());
+        topNodes.resize(topNodes.size() + 2);
+        topNodes[slot] = BVH::Node{ n.boundsMin, child, n.boundsMax, 0 };
+        cut(child, n.leftFirst);
+        cut(child + 1, n.leftFirst + 1);
+    };
+    cut(0, 0);
+
+    // Write to a temporary file and swap it in, so an interrupted conversion never leaves a
+    // truncated file that loadOrConvert would accept as current
+    std::string tempPath = outputPath + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cout << "ERROR::OUT_OF_CORE:: Cannot write " << tempPath << std::endl;
+        return false;
+    }
+
+    AABB bounds = bvh.getBounds();
+    FileHeader header = {};
+    std::memcpy(header.magic, "OOCB", 4);
+    header.version = FILE_VERSION;
+    header.triangleCount = static_cast<uint32_t>(triangleCount);
+    header.topNodeCount = static_cast<uint32_t>(topNodes.size());
+    header.treeletCount = static_cast<uint32_t>(treeletRoots.size());
+    header.sourceSize = sourceSize;
+    header.sourceModifiedTime = sourceModifiedTime;
+    std::memcpy(header.boundsMin, &bounds.min[0], sizeof(header.boundsMin));
+    std::memcpy(header.boundsMax, &bounds.max[0], sizeof(header.boundsMax));
+
+    // Directory entries are rewritten once the treelet offsets are known
+    std::vector<TreeletEntry> directory(treeletRoots.size());
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(topNodes.data()), topNodes.size() * sizeof(BVH::Node));
+    std::streampos directoryPosition = out.tellp();
+    out.write(reinterpret_cast<const char*>(directory.data()), directory.size() * sizeof(TreeletEntry));
+
+    // Each treelet is re-rooted at local node 0 with its triangles in leaf order right after its nodes
+    std::vector<BVH::Node> localNodes;
+    std::vector<TriangleBVH::Triangle> localTriangles;
+    std::function<void(size_t, unsigned int)> copySubtree = [&](size_t slot, unsigned int node) {
+        const BVH::Node& n = nodes[node];
+        if (n.isLeaf()) {
+            localNodes[slot] = BVH::Node{ n.boundsMin, static_cast<unsigned int>(localTriangles.size()), n.boundsMax, n.count };
+            for (unsigned int i = 0; i < n.count; ++i) {
+                localTriangles.push_back(triangles[primitives[n.leftFirst + i]]);
+            }
+            return;
+        }
+        unsigned int child = static_cast<unsigned int>(localNodes.size());
+        localNodes.resize(localNodes.size() + 2);
+        localNodes[slot] = BVH::Node{ n.boundsMin, child, n.boundsMax, 0 };
+        copySubtree(child, n.leftFirst);
+        copySubtree(child + 1, n.leftFirst + 1);
+    };
+
+    for (size_t t = 0; t < treeletRoots.size(); ++t) {
+        localNodes.assign(1, BVH::Node());
+        localTriangles.clear();
+        copySubtree(0, treeletRoots[t]);
+
+        padTo(out, TREELET_ALIGNMENT);
+        directory[t].offset = static_cast<uint64_t>(out.tellp());
+        directory[t].nodeCount = static_cast<uint32_t>(localNodes.size());
+        directory[t].triangleCount = static_cast<uint32_t>(localTriangles.size());
+        out.write(reinterpret_cast<const char*>(localNodes.data()), localNodes.size() * sizeof(BVH::Node));
+        out.write(reinterpret_cast<const char*>(localTriangles.data()), localTriangles.size() * sizeof(TriangleBVH::Triangle));
+    }
+
+    out.seekp(directoryPosition);
+    out.write(reinterpret_cast<const char*>(directory.data()), directory.size() * sizeof(TreeletEntry));
+    out.close();
+    if (!out) {
+        std::cout << "ERROR::OUT_OF_CORE:: Write failed: " << tempPath << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    std::remove(outputPath.c_str());
+    if (std::rename(tempPath.c_str(), outputPath.c_str()) != 0) {
+        std::cout << "ERROR::OUT_OF_CORE:: Cannot replace " << outputPath << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    std::cout << "Out-of-core BVH: " << triangleCount << " triangles in " << treeletRoots.size()
+              << " treelets -> " << outputPath << std::endl;
+    return true;
+}
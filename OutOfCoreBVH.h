@@ -0,0 +1,116 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+#include "BVH.h"
+#include "MappedFile.h"
+
+class OutOfCoreBVH;
+
+// Bounded cache of memory-mapped treelets shared by all out-of-core meshes.
+// Treelets are mapped on first use and the least recently used ones are unmapped once the
+// mapped bytes exceed the budget. Views are reference counted, so a treelet evicted while a
+// worker is still traversing it stays valid until that worker lets go.
+class TreeletCache {
+public:
+    explicit TreeletCache(size_t budgetBytes = 256u * 1024u * 1024u) : budget(budgetBytes) {}
+
+    std::shared_ptr<const MappedView> acquire(const OutOfCoreBVH& mesh, unsigned int treelet);
+
+    // Drop every treelet of a mesh (called when the mesh is closed)
+    void release(uint32_t meshId);
+
+    void setBudget(size_t budgetBytes);
+    size_t getBudget() const { return budget; }
+
+    struct Stats {
+        size_t residentBytes = 0;
+        size_t residentTreelets = 0;
+        size_t hits = 0;
+        size_t pageIns = 0;
+        size_t evictions = 0;
+        size_t failedMaps = 0;     // Mapping refused by the OS; the treelet is treated as empty
+    };
+    Stats getStats() const;
+
+    // Process-wide cache used by meshes opened without an explicit one
+    static TreeletCache& shared();
+
+private:
+    struct Entry {
+        std::shared_ptr<const MappedView> view;
+        std::list<uint64_t>::iterator lruPosition;
+    };
+
+    size_t budget;
+    mutable std::mutex cacheMutex;
+    std::unordered_map<uint64_t, Entry> entries;
+    std::list<uint64_t> lru;   // Front = most recently used
+    Stats stats;
+
+    void evictUntil(size_t targetBytes);
+};
+
+// Triangle mesh traced straight from a treelet-clustered file on disk.
+// The file holds a small top-level BVH that stays in memory; its leaves are treelets, i.e.
+// subtrees of at most a few thousand triangles whose nodes and triangles are stored together in
+// one page-aligned block. Tracing a ray only maps the treelets the ray actually reaches, so the
+// resident set is bounded by the TreeletCache no matter how large the scan is.
+class OutOfCoreBVH {
+public:
+    static const uint32_t FILE_VERSION = 1;
+
+    OutOfCoreBVH() = default;
+    ~OutOfCoreBVH();
+
+    // Write a treelet file for a triangle mesh
+    static bool build(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices,
+                      const std::string& outputPath, unsigned int trianglesPerTreelet = 4096);
+
+    // Import a model file with Assimp (positions only, 12 bytes per vertex) and write its treelet file
+    static bool convertModel(const std::string& modelPath, const std::string& outputPath);
+
+    // Open "<modelPath>.oocbvh", converting the model first if the file is missing or stale.
+    // Returns nullptr if neither works.
+    static std::shared_ptr<OutOfCoreBVH> loadOrConvert(const std::string& modelPath, TreeletCache* cache = nullptr);
+
+    bool open(const std::string& path, TreeletCache* cache = nullptr);
+
+    bool intersect(const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax, TriangleHit& hit) const;
+
+    AABB getBounds() const { return bounds; }
+    uint32_t getTriangleCount() const { return triangleCount; }
+    size_t getTreeletCount() const { return treelets.size(); }
+    uint64_t getFileSize() const { return file.size(); }
+
+private:
+    friend class TreeletCache;
+
+    // On-disk treelet directory entry. A treelet block is Node[nodeCount] followed by
+    // TriangleBVH::Triangle[triangleCount]; leaf nodes index the block's triangles.
+    struct TreeletEntry {
+        uint64_t offset;
+        uint32_t nodeCount;
+        uint32_t triangleCount;
+    };
+
+    MappedFile file;
+    TreeletCache* cache = nullptr;
+    uint32_t meshId = 0;
+    uint32_t triangleCount = 0;
+    AABB bounds;
+    std::vector<BVH::Node> topNodes;   // Leaves have count == 1 and leftFirst = treelet index
+    std::vector<TreeletEntry> treelets;
+
+    static bool writeTreeletFile(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices,
+                                 const std::string& outputPath, unsigned int trianglesPerTreelet,
+                                 uint64_t sourceSize, int64_t sourceModifiedTime);
+    size_t treeletBytes(unsigned int treelet) const;
+    std::unique_ptr<MappedView> mapTreelet(unsigned int treelet) const;
+};
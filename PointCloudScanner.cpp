@@ -0,0 +1,239 @@
+#include "PointCloudScanner.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Rays per worker task; large enough to amortize the queue, small enough to spread over workers
+    const size_t RAYS_PER_CHUNK = 4096;
+
+    // Stateless per-ray random numbers so chunks need no shared generator
+    float hashToUnit(unsigned int x)
+    {
+        x ^= x >> 16; x *= 0x7feb352dU;
+        x ^= x >> 15; x *= 0x846ca68bU;
+        x ^= x >> 16;
+        return (x >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // 21 bits per axis, biased so negative cells stay positive
+    uint64_t voxelKey(const glm::vec3& position, float voxelSize)
+    {
+        glm::ivec3 cell = glm::ivec3(glm::floor(position / voxelSize));
+        return (static_cast<uint64_t>(cell.x + (1 << 20)) & 0x1FFFFF) |
+               ((static_cast<uint64_t>(cell.y + (1 << 20)) & 0x1FFFFF) << 21) |
+               ((static_cast<uint64_t>(cell.z + (1 << 20)) & 0x1FFFFF) << 42);
+    }
+}
+
+PointCloudScanner::PointCloudScanner(float voxelSize) : voxelSize(voxelSize)
+{
+}
+
+PointCloudScanner::~PointCloudScanner()
+{
+    // Running tasks own their batch results and model, so nothing has to wait here
+}
+
+void PointCloudScanner::begin(std::shared_ptr<const Model> targetModel, const glm::mat4& matrix, int objectIndex)
+{
+    if (active) cancel();
+
+    model = std::move(targetModel);
+    modelMatrix = matrix;
+    inverseModelMatrix = glm::inverse(matrix);
+    normalMatrix = glm::transpose(glm::mat3(inverseModelMatrix));
+    targetIndex = objectIndex;
+
+    // Bounding sphere of the exhibit in world space decides how wide the fan must open
+    AABB localBounds{ model->GetBoundingBoxMin(), model->GetBoundingBoxMax() };
+    AABB worldBounds = localBounds.isValid() ? localBounds.transformed(matrix) : AABB{ glm::vec3(matrix[3]), glm::vec3(matrix[3]) };
+    targetCenter = worldBounds.center();
+    targetRadius = std::max(glm::length(worldBounds.size()) * 0.5f, 0.05f);
+
+    points.clear();
+    occupiedVoxels.clear();
+    raysCast = 0;
+    rayHits = 0;
+    measuredRaysPerSecond = 0.0f;
+    pendingRays = 0.0f;
+    sweptProgress = 0.0f;
+    active = true;
+    finishing = false;
+    completed = false;
+}
+
+void PointCloudScanner::update(const glm::vec3& sensorOrigin, const glm::vec3& sensorDirection, float progress, float deltaTime)
+{
+    if (!active) return;
+
+    if (finishing) {
+        collect();
+        if (batch) return;
+
+        // The arm stops before the last slice was submitted; trace it now so the sweep is complete
+        if (sweptProgress < 1.0f) {
+            size_t rayCount = std::max<size_t>(static_cast<size_t>(pendingRays), RAYS_PER_CHUNK);
+            submitSlice(lastSensorOrigin, lastSensorDirection, 1.0f, rayCount);
+            if (batch) return;
+        }
+
+        pendingRays = 0.0f;
+        model = nullptr;
+        active = false;
+        finishing = false;
+        completed = true;
+        return;
+    }
+
+    lastSensorOrigin = sensorOrigin;
+    lastSensorDirection = sensorDirection;
+
+    // Rays owed since the last batch. Capped so a long stall cannot produce a huge catch-up batch.
+    pendingRays = std::min(pendingRays + rayRate * deltaTime, rayRate * 0.25f);
+
+    collect();
+    if (batch || pendingRays < 1.0f) return;
+
+    size_t rayCount = static_cast<size_t>(pendingRays);
+    pendingRays -= static_cast<float>(rayCount);
+    submitSlice(sensorOrigin, sensorDirection, progress, rayCount);
+}
+
+void PointCloudScanner::submitSlice(const glm::vec3& sensorOrigin, const glm::vec3& sensorDirection, float progress, size_t rayCount)
+{
+    progress = glm::clamp(progress, sweptProgress, 1.0f);
+    if (rayCount == 0) return;
+
+    // Sensor frame: fan axis plus the horizontal/vertical directions the fan spreads along
+    glm::vec3 forward = glm::normalize(sensorDirection);
+    glm::vec3 right = glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f));
+    if (glm::dot(right, right) < 1e-6f) right = glm::vec3(1.0f, 0.0f, 0.0f);
+    right = glm::normalize(right);
+    glm::vec3 up = glm::cross(right, forward);
+
+    // Half-angle that covers the exhibit's bounding sphere even if the axis is a bit off-center
+    glm::vec3 toCenter = targetCenter - sensorOrigin;
+    float distance = glm::length(toCenter);
+    float halfAngle = glm::radians(60.0f);
+    if (distance > targetRadius) {
+        float axisOffset = std::acos(glm::clamp(glm::dot(toCenter / distance, forward), -1.0f, 1.0f));
+        halfAngle = std::min(std::asin(targetRadius / distance) + axisOffset, halfAngle);
+    }
+
+    // The fan is a vertical line whose azimuth moves left to right over the scan; this batch
+    // covers the slice between the last submitted progress and now
+    float azimuthBegin = -halfAngle + 2.0f * halfAngle * sweptProgress;
+    float azimuthEnd = -halfAngle + 2.0f * halfAngle * progress;
+    sweptProgress = progress;
+
+    auto newBatch = std::make_unique<Batch>();
+    newBatch->rayCount = rayCount;
+    newBatch->results = std::make_shared<BatchResults>();
+    newBatch->results->model = model;
+    newBatch->results->chunks.resize((rayCount + RAYS_PER_CHUNK - 1) / RAYS_PER_CHUNK);
+    newBatch->startTime = std::chrono::high_resolution_clock::now();
+    std::shared_ptr<BatchResults> target = newBatch->results;
+
+    glm::mat4 toWorld = modelMatrix;
+    glm::mat4 toLocal = inverseModelMatrix;
+    glm::mat3 normalToWorld = normalMatrix;
+    float cellSize = voxelSize;
+    unsigned int seed = batchSeed++ * 0x9e3779b9U;
+
+    newBatch->futures = ThreadPool::shared().dispatch(rayCount, RAYS_PER_CHUNK,
+        [=](size_t begin, size_t end) {
+            const TriangleBVH& bvh = target->model->GetBVH();
+            ChunkResult& result = target->chunks[begin / RAYS_PER_CHUNK];
+            std::unordered_set<uint64_t> chunkVoxels;
+
+            glm::vec3 localOrigin = glm::vec3(toLocal * glm::vec4(sensorOrigin, 1.0f));
+            float tanHalf = std::tan(halfAngle);
+
+            for (size_t i = begin; i < end; ++i) {
+                // Stratified in elevation along the fan, jittered within the azimuth slice
+                unsigned int rayId = seed + static_cast<unsigned int>(i);
+                float azimuth = azimuthBegin + (azimuthEnd - azimuthBegin) * hashToUnit(rayId * 2u + 1u);
+                float elevation = (((i + hashToUnit(rayId * 2u)) / rayCount) * 2.0f - 1.0f) * tanHalf;
+                glm::vec3 direction = forward + right * std::tan(azimuth) + up * elevation;
+
+                // Trace in object space so the model's BVH is used as-is
+                glm::vec3 localDirection = glm::vec3(toLocal * glm::vec4(direction, 0.0f));
+                TriangleHit hit;
+                if (!bvh.intersect(localOrigin, localDirection, 0.0f, FLT_MAX, hit)) continue;
+                result.hits++;
+
+                glm::vec3 worldPoint = glm::vec3(toWorld * glm::vec4(localOrigin + localDirection * hit.t, 1.0f));
+                if (!chunkVoxels.insert(voxelKey(worldPoint, cellSize)).second) continue;
+
+                glm::vec3 normal = glm::normalize(normalToWorld * hit.normal);
+                if (glm::dot(normal, direction) > 0.0f) normal = -normal;
+                result.points.push_back({ worldPoint, normal });
+            }
+        });
+
+    batch = std::move(newBatch);
+}
+
+bool PointCloudScanner::isBatchReady() const
+{
+    for (const auto& future : batch->futures) {
+        if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+    }
+    return true;
+}
+
+bool PointCloudScanner::collect()
+{
+    if (!batch || !isBatchReady()) return false;
+
+    size_t before = points.size();
+    mergeBatch();
+    return points.size() > before;
+}
+
+void PointCloudScanner::finish()
+{
+    if (!active || finishing) return;
+    finishing = true;
+}
+
+void PointCloudScanner::cancel()
+{
+    if (!active) return;
+
+    // Dropping the futures does not wait; the tasks hold the results until they end
+    batch.reset();
+    pendingRays = 0.0f;
+    model = nullptr;
+    active = false;
+    finishing = false;
+}
+
+bool PointCloudScanner::takeCompleted()
+{
+    bool result = completed;
+    completed = false;
+    return result;
+}
+
+void PointCloudScanner::mergeBatch()
+{
+    for (auto& future : batch->futures) future.get();
+
+    // Chunks only deduplicate against themselves; the first point per voxel wins globally
+    for (const ChunkResult& chunk : batch->results->chunks) {
+        rayHits += chunk.hits;
+        for (const ScanPoint& point : chunk.points) {
+            if (occupiedVoxels.insert(voxelKey(point.position, voxelSize)).second) {
+                points.push_back(point);
+            }
+        }
+    }
+    raysCast += batch->rayCount;
+
+    float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - batch->startTime).count();
+    if (seconds > 0.0f) measuredRaysPerSecond = batch->rayCount / seconds;
+
+    batch.reset();
+}
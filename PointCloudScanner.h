@@ -0,0 +1,117 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <future>
+#include <chrono>
+#include <memory>
+#include <unordered_set>
+#include <cstdint>
+#include "Model.h"
+
+// A surface sample captured by the scanner (world space)
+struct ScanPoint {
+    glm::vec3 position;
+    glm::vec3 normal;
+};
+
+// Simulated 3D scanner on the robot arm tip.
+// The sensor sweeps a vertical fan of rays across the exhibit as the scan progresses. Each frame
+// the rays for the newly swept slice are traced against the exhibit's triangle BVH on the shared
+// worker pool and merged into a voxel-downsampled point cloud once they finish, so the render
+// loop never waits on the scanner.
+class PointCloudScanner {
+public:
+    explicit PointCloudScanner(float voxelSize = 0.02f);
+    ~PointCloudScanner();
+
+    // Start a new scan of an exhibit. Clears the previous cloud and cancels a scan still running.
+    // Batches in flight keep the model alive, so a hot reload of the exhibit cannot free it under the workers.
+    void begin(std::shared_ptr<const Model> targetModel, const glm::mat4& modelMatrix, int objectIndex);
+
+    // Queue rays for the slice swept since the last submitted batch. If the previous batch is
+    // still running nothing is queued and the slice simply grows until the next call. While
+    // finishing, only merges finished batches and queues the rest of the sweep.
+    void update(const glm::vec3& sensorOrigin, const glm::vec3& sensorDirection, float progress, float deltaTime);
+
+    // Merge a finished batch into the cloud. Returns true if new points were added.
+    bool collect();
+
+    // Stop sweeping without waiting. The running batch and the part of the sweep not submitted yet
+    // (the arm finishes before the last slice is queued) are still traced on the pool; update()
+    // keeps merging them and the scan ends once the last batch is in.
+    void finish();
+
+    // Stop scanning now. A batch still running is abandoned and its points are dropped.
+    void cancel();
+
+    // Whether the scan finished since the last call; true once, after the final batch was merged
+    bool takeCompleted();
+
+    bool isActive() const { return active; }
+    bool isFinishing() const { return finishing; }
+    int getTargetObjectIndex() const { return targetIndex; }
+    const std::vector<ScanPoint>& getPoints() const { return points; }
+    size_t getRaysCast() const { return raysCast; }
+    size_t getRayHits() const { return rayHits; }
+    float getRaysPerSecond() const { return measuredRaysPerSecond; }
+
+    void setRayRate(float raysPerSecond) { rayRate = raysPerSecond; }
+    float getRayRate() const { return rayRate; }
+    void setVoxelSize(float size) { voxelSize = size; }
+    float getVoxelSize() const { return voxelSize; }
+
+private:
+    // Output of one worker chunk; chunks never share memory
+    struct ChunkResult {
+        std::vector<ScanPoint> points;
+        size_t hits = 0;
+    };
+
+    // What the workers write to. Shared with the tasks so an abandoned batch stays valid until they end.
+    struct BatchResults {
+        std::shared_ptr<const Model> model;
+        std::vector<ChunkResult> chunks;
+    };
+
+    // A batch in flight on the worker pool
+    struct Batch {
+        std::shared_ptr<BatchResults> results;
+        std::vector<std::future<void>> futures;
+        size_t rayCount = 0;
+        std::chrono::high_resolution_clock::time_point startTime;
+    };
+
+    // Scan target
+    std::shared_ptr<const Model> model;
+    glm::mat4 modelMatrix = glm::mat4(1.0f);
+    glm::mat4 inverseModelMatrix = glm::mat4(1.0f);
+    glm::mat3 normalMatrix = glm::mat3(1.0f);
+    glm::vec3 targetCenter = glm::vec3(0.0f);
+    float targetRadius = 1.0f;
+    int targetIndex = -1;
+    bool active = false;
+    bool finishing = false;
+    bool completed = false;
+
+    // Sweep state
+    float rayRate = 400000.0f;
+    float pendingRays = 0.0f;
+    float sweptProgress = 0.0f;
+    glm::vec3 lastSensorOrigin = glm::vec3(0.0f);
+    glm::vec3 lastSensorDirection = glm::vec3(0.0f, 0.0f, -1.0f);
+    unsigned int batchSeed = 0;
+    std::unique_ptr<Batch> batch;
+
+    // Voxel-downsampled cloud
+    float voxelSize;
+    std::vector<ScanPoint> points;
+    std::unordered_set<uint64_t> occupiedVoxels;
+    size_t raysCast = 0;
+    size_t rayHits = 0;
+    float measuredRaysPerSecond = 0.0f;
+
+    void submitSlice(const glm::vec3& sensorOrigin, const glm::vec3& sensorDirection, float progress, size_t rayCount);
+    bool isBatchReady() const;
+    void mergeBatch();
+};
@@ -80,9 +80,29 @@ bool RayTracer::hit(const Ray& ray, HitRecord& record) const {
         }
     }
     
-    // Check museum objects (simplified as bounding spheres)
+    // Check quads
+    for (const auto& quad : quads) {
+        if (hitQuad(quad, ray, tempRecord) && tempRecord.t < closestSoFar) {
+            hitAnything = true;
+            closestSoFar = tempRecord.t;
+            record = tempRecord;
+        }
+    }
+    
+    // Check triangle meshes (paged in from disk as needed)
+    for (const auto& instance : meshes) {
+        if (hitMesh(instance, ray, closestSoFar, tempRecord)) {
+            hitAnything = true;
+            closestSoFar = tempRecord.t;
+            record = tempRecord;
+            record.objectIndex = instance.objectIndex;
+        }
+    }
+    
+    // Check museum objects (simplified as bounding spheres unless they have a mesh)
     if (scene) {
         for (size_t i = 0; i < scene->getObjectCount(); ++i) {
+            if (i < objectHasMesh.size() && objectHasMesh[i]) continue;
             const MuseumObject* obj = scene->getObject(i);
             if (obj && hitMuseumObject(obj, ray, tempRecord) && tempRecord.t < closestSoFar) {
                 hitAnything = true;
@@ -108,6 +128,29 @@ void RayTracer::addPlane(const glm::vec3& point, const glm::vec3& normal, const
     planes.push_back({point, glm::normalize(normal), material});
 }
 
+void RayTracer::addQuad(const glm::vec3& origin, const glm::vec3& edgeU, const glm::vec3& edgeV, const RayTracingMaterial& material) {
+    quads.push_back({origin, edgeU, edgeV, glm::normalize(glm::cross(edgeU, edgeV)), material});
+}
+
+void RayTracer::addMesh(std::shared_ptr<const OutOfCoreBVH> mesh, const glm::mat4& modelMatrix,
+                        const RayTracingMaterial& material, int objectIndex) {
+    if (!mesh) return;
+    
+    MeshInstance instance;
+    instance.worldToLocal = glm::inverse(modelMatrix);
+    instance.normalMatrix = glm::transpose(glm::mat3(instance.worldToLocal));
+    instance.worldBounds = mesh->getBounds().transformed(modelMatrix);
+    instance.material = material;
+    instance.objectIndex = objectIndex;
+    instance.mesh = std::move(mesh);
+    meshes.push_back(std::move(instance));
+    
+    if (objectIndex >= 0) {
+        if (objectHasMesh.size() <= static_cast<size_t>(objectIndex)) objectHasMesh.resize(objectIndex + 1, false);
+        objectHasMesh[objectIndex] = true;
+    }
+}
+
 void RayTracer::addLight(const glm::vec3& position, const glm::vec3& color, float intensity) {
     lights.push_back({position, color, intensity});
 }
@@ -232,6 +275,29 @@ bool RayTracer::hitPlane(const Plane& plane, const Ray& ray, HitRecord& record)
     return true;
 }
 
+bool RayTracer::hitQuad(const Quad& quad, const Ray& ray, HitRecord& record) const {
+    float denom = glm::dot(quad.normal, ray.direction);
+    if (std::abs(denom) < 1e-6f) return false; // Ray parallel to quad
+    
+    float t = glm::dot(quad.origin - ray.origin, quad.normal) / denom;
+    if (t < ray.tMin || t > ray.tMax) return false;
+    
+    // The edges are perpendicular, so the hit point projects onto each edge independently
+    glm::vec3 offset = ray.at(t) - quad.origin;
+    float u = glm::dot(offset, quad.edgeU) / glm::dot(quad.edgeU, quad.edgeU);
+    float v = glm::dot(offset, quad.edgeV) / glm::dot(quad.edgeV, quad.edgeV);
+    if (u < 0.0f || u > 1.0f || v < 0.0f || v > 1.0f) return false;
+    
+    record.t = t;
+    record.point = ray.at(t);
+    record.setFaceNormal(ray, quad.normal);
+    record.color = quad.material.albedo;
+    record.reflectance = quad.material.metallic;
+    record.transparency = quad.material.transparency;
+    
+    return true;
+}
+
 bool RayTracer::hitMuseumObject(const MuseumObject* obj, const Ray& ray, HitRecord& record) const {
     // Simplified collision as bounding sphere
     float radius = 1.5f; // Approximate object size
@@ -264,6 +330,28 @@ bool RayTracer::hitMuseumObject(const MuseumObject* obj, const Ray& ray, HitReco
     return true;
 }
 
+bool RayTracer::hitMesh(const MeshInstance& instance, const Ray& ray, float tMax, HitRecord& record) const {
+    // Cheap reject against the world bounds before touching the mesh (and its pages on disk)
+    glm::vec3 invDirection = 1.0f / ray.direction;
+    float tNear;
+    if (!instance.worldBounds.intersectRay(ray.origin, invDirection, ray.tMin, tMax, tNear)) return false;
+    
+    // The direction is not renormalized, so t is the same in both spaces
+    glm::vec3 localOrigin = glm::vec3(instance.worldToLocal * glm::vec4(ray.origin, 1.0f));
+    glm::vec3 localDirection = glm::vec3(instance.worldToLocal * glm::vec4(ray.direction, 0.0f));
+    TriangleHit hit;
+    if (!instance.mesh->intersect(localOrigin, localDirection, ray.tMin, tMax, hit)) return false;
+    
+    record.t = hit.t;
+    record.point = ray.at(hit.t);
+    record.setFaceNormal(ray, glm::normalize(instance.normalMatrix * hit.normal));
+    record.color = instance.material.albedo;
+    record.reflectance = instance.material.metallic;
+    record.transparency = instance.material.transparency;
+    
+    return true;
+}
+
 glm::vec3 RayTracer::calculateLighting(const HitRecord& hit) const {
     glm::vec3 color = hit.color * 0.1f; // Ambient
     
@@ -288,9 +376,10 @@ glm::vec3 RayTracer::calculateLighting(const HitRecord& hit) const {
 }
 
 glm::vec3 RayTracer::randomInUnitSphere() const {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    // Per-thread generators so secondary rays can be traced from worker threads
+    static thread_local std::random_device rd;
+    static thread_local std::mt19937 gen(rd());
+    static thread_local std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
     
     glm::vec3 p;
     do {
@@ -305,8 +394,8 @@ glm::vec3 RayTracer::randomUnitVector() const {
 }
 
 float RayTracer::random01() const {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    static thread_local std::random_device rd;
+    static thread_local std::mt19937 gen(rd());
+    static thread_local std::uniform_real_distribution<float> dis(0.0f, 1.0f);
     return dis(gen);
 }
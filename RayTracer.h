@@ -5,6 +5,7 @@
 #include <vector>
 #include <memory>
 #include "MuseumObjectManager.h"
+#include "OutOfCoreBVH.h"
 
 struct Ray {
     glm::vec3 origin;
@@ -57,9 +58,18 @@ public:
     void setScene(const MuseumObjectManager* objectManager);
     void addSphere(const glm::vec3& center, float radius, const RayTracingMaterial& material);
     void addPlane(const glm::vec3& point, const glm::vec3& normal, const RayTracingMaterial& material);
+    // Bounded rectangle spanning origin + u * edgeU + v * edgeV for u, v in [0, 1]
+    void addQuad(const glm::vec3& origin, const glm::vec3& edgeU, const glm::vec3& edgeV, const RayTracingMaterial& material);
+    
+    // Triangle mesh traced straight from its out-of-core BVH file. If objectIndex refers to a
+    // museum object, the mesh replaces that object's bounding-sphere approximation.
+    void addMesh(std::shared_ptr<const OutOfCoreBVH> mesh, const glm::mat4& modelMatrix,
+                 const RayTracingMaterial& material, int objectIndex = -1);
+    size_t getMeshCount() const { return meshes.size(); }
     
     // Ray tracing settings
     void setMaxDepth(int depth) { maxDepth = depth; }
+    int getMaxDepth() const { return maxDepth; }
     void setBackgroundColor(const glm::vec3& color) { backgroundColor = color; }
     void enableGlobalIllumination(bool enable) { globalIllumination = enable; }
     void setSampleCount(int samples) { sampleCount = samples; }
@@ -90,6 +100,22 @@ private:
         RayTracingMaterial material;
     };
     
+    struct Quad {
+        glm::vec3 origin;
+        glm::vec3 edgeU, edgeV;
+        glm::vec3 normal;
+        RayTracingMaterial material;
+    };
+    
+    struct MeshInstance {
+        std::shared_ptr<const OutOfCoreBVH> mesh;
+        glm::mat4 worldToLocal;
+        glm::mat3 normalMatrix;
+        AABB worldBounds;
+        RayTracingMaterial material;
+        int objectIndex;
+    };
+    
     struct Light {
         glm::vec3 position;
         glm::vec3 color;
@@ -99,6 +125,9 @@ private:
     // Scene objects
     std::vector<Sphere> spheres;
     std::vector<Plane> planes;
+    std::vector<Quad> quads;
+    std::vector<MeshInstance> meshes;
+    std::vector<bool> objectHasMesh;
     std::vector<Light> lights;
     const MuseumObjectManager* scene = nullptr;
     
@@ -111,7 +140,9 @@ private:
     // Helper functions
     bool hitSphere(const Sphere& sphere, const Ray& ray, HitRecord& record) const;
     bool hitPlane(const Plane& plane, const Ray& ray, HitRecord& record) const;
+    bool hitQuad(const Quad& quad, const Ray& ray, HitRecord& record) const;
     bool hitMuseumObject(const MuseumObject* obj, const Ray& ray, HitRecord& record) const;
+    bool hitMesh(const MeshInstance& instance, const Ray& ray, float tMax, HitRecord& record) const;
     glm::vec3 calculateLighting(const HitRecord& hit) const;
     glm::vec3 randomInUnitSphere() const;
     glm::vec3 randomUnitVector() const;
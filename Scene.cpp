@@ -0,0 +1,119 @@
+#include "Scene.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+namespace {
+    std::string trim(const std::string& text)
+    {
+        size_t begin = text.find_first_not_of(" \t\r");
+        if (begin == std::string::npos) return std::string();
+        size_t end = text.find_last_not_of(" \t\r");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    std::string unescape(const std::string& text)
+    {
+        std::string result;
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (text[i] == '\\' && i + 1 < text.size() && text[i + 1] == 'n') {
+                result += '\n';
+                ++i;
+            } else {
+                result += text[i];
+            }
+        }
+        return result;
+    }
+
+    bool parseVec3(const std::string& text, glm::vec3& value)
+    {
+        std::istringstream stream(text);
+        std::string rest;
+        return (stream >> value.x >> value.y >> value.z) && !(stream >> rest);
+    }
+
+    bool parseFloat(const std::string& text, float& value)
+    {
+        std::istringstream stream(text);
+        std::string rest;
+        return (stream >> value) && !(stream >> rest);
+    }
+}
+
+bool Scene::load(const std::string& path, Scene& scene)
+{
+    std::ifstream file(path);
+    if (!file) {
+        std::cout << "ERROR::SCENE:: Could not open " << path << std::endl;
+        return false;
+    }
+
+    Scene parsed;
+    enum class Section { NONE, ROOM, EXHIBIT } section = Section::NONE;
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') continue;
+
+        if (line == "[room]") {
+            parsed.rooms.emplace_back();
+            section = Section::ROOM;
+            continue;
+        }
+        if (line == "[exhibit]") {
+            parsed.exhibits.emplace_back();
+            section = Section::EXHIBIT;
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos || section == Section::NONE) {
+            std::cout << "ERROR::SCENE:: " << path << ":" << lineNumber << ": expected a section or key = value" << std::endl;
+            return false;
+        }
+        std::string key = trim(line.substr(0, equals));
+        std::string value = trim(line.substr(equals + 1));
+
+        bool valid = true;
+        if (section == Section::ROOM) {
+            Room& room = parsed.rooms.back();
+            if (key == "name") room.name = value;
+            else if (key == "center") valid = parseVec3(value, room.center);
+            else if (key == "size") valid = parseVec3(value, room.size) && room.size.x > 0.0f && room.size.y > 0.0f && room.size.z > 0.0f;
+            else valid = false;
+        } else {
+            Exhibit& exhibit = parsed.exhibits.back();
+            if (key == "model") exhibit.model = value;
+            else if (key == "name") exhibit.name = unescape(value);
+            else if (key == "description") exhibit.description = unescape(value);
+            else if (key == "position") valid = parseVec3(value, exhibit.position);
+            else if (key == "rotation") valid = parseVec3(value, exhibit.rotation);
+            else if (key == "ambient") valid = parseVec3(value, exhibit.ambient);
+            else if (key == "diffuse") valid = parseVec3(value, exhibit.diffuse);
+            else if (key == "specular") valid = parseVec3(value, exhibit.specular);
+            else if (key == "reflectivity") valid = parseFloat(value, exhibit.reflectivity);
+            else if (key == "transparency") valid = parseFloat(value, exhibit.transparency);
+            else if (key == "refractiveIndex") valid = parseFloat(value, exhibit.refractiveIndex);
+            else valid = false;
+        }
+        if (!valid) {
+            std::cout << "ERROR::SCENE:: " << path << ":" << lineNumber << ": unknown key or bad value for '" << key << "'" << std::endl;
+            return false;
+        }
+    }
+
+    for (const Exhibit& exhibit : parsed.exhibits) {
+        if (exhibit.model.empty()) {
+            std::cout << "ERROR::SCENE:: " << path << ": exhibit '" << exhibit.name << "' has no model" << std::endl;
+            return false;
+        }
+    }
+    if (parsed.rooms.empty()) {
+        std::cout << "ERROR::SCENE:: " << path << ": no [room] section" << std::endl;
+        return false;
+    }
+
+    scene = std::move(parsed);
+    return true;
+}
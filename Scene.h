@@ -0,0 +1,38 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// Museum layout read from a scene file (see museum.scene): the rooms and the exhibits placed in
+// them. The file is a list of [room] and [exhibit] sections with one "key = value" per line;
+// vectors are three numbers separated by spaces, "\n" in text is a line break and lines starting
+// with '#' are comments.
+struct Scene {
+    struct Room {
+        std::string name;
+        glm::vec3 center = glm::vec3(0.0f);   // Floor centre
+        glm::vec3 size = glm::vec3(20.0f, 8.0f, 20.0f);
+    };
+
+    struct Exhibit {
+        std::string model;
+        std::string name;
+        std::string description;
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 rotation = glm::vec3(0.0f);  // Euler angles in degrees
+        glm::vec3 ambient = glm::vec3(0.2f, 0.15f, 0.1f);
+        glm::vec3 diffuse = glm::vec3(0.8f, 0.7f, 0.6f);
+        glm::vec3 specular = glm::vec3(0.3f, 0.3f, 0.3f);
+        float reflectivity = 0.0f;
+        float transparency = 0.0f;
+        float refractiveIndex = 1.5f;
+    };
+
+    std::vector<Room> rooms;
+    std::vector<Exhibit> exhibits;
+
+    // Parses the file into scene. Returns false (and reports the line) if it cannot be read or
+    // is malformed, or describes no room.
+    static bool load(const std::string& path, Scene& scene);
+};
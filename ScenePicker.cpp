@@ -0,0 +1,51 @@
+#include "ScenePicker.h"
+#include <chrono>
+#include <cfloat>
+
+void ScenePicker::cursorRay(double cursorX, double cursorY, int windowWidth, int windowHeight,
+                            const glm::mat4& view, const glm::mat4& projection,
+                            glm::vec3& origin, glm::vec3& direction)
+{
+    // Cursor to normalized device coordinates (window y points down)
+    float ndcX = static_cast<float>(2.0 * cursorX / windowWidth - 1.0);
+    float ndcY = static_cast<float>(1.0 - 2.0 * cursorY / windowHeight);
+
+    glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+    glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+    nearPoint /= nearPoint.w;
+    farPoint /= farPoint.w;
+
+    origin = glm::vec3(nearPoint);
+    direction = glm::normalize(glm::vec3(farPoint - nearPoint));
+}
+
+PickResult ScenePicker::pick(const glm::vec3& origin, const glm::vec3& direction,
+                             const MuseumObjectManager& objectManager, const MobileRobot& robot)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    PickResult result;
+
+    float exhibitDistance = FLT_MAX;
+    int exhibitIndex = objectManager.raycast(origin, direction, exhibitDistance);
+
+    float robotDistance = FLT_MAX;
+    bool robotHit = robot.intersectRay(origin, direction, robotDistance);
+
+    if (robotHit && robotDistance < exhibitDistance) {
+        result.target = PickTarget::ROBOT;
+        result.distance = robotDistance;
+    } else if (exhibitIndex >= 0) {
+        result.target = PickTarget::EXHIBIT;
+        result.objectIndex = exhibitIndex;
+        result.distance = exhibitDistance;
+    }
+
+    if (result.target != PickTarget::NONE) {
+        result.point = origin + direction * result.distance;
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    result.pickTimeMicroseconds = std::chrono::duration<float, std::micro>(end - start).count();
+    return result;
+}
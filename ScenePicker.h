@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "MuseumObjectManager.h"
+#include "MobileRobot.h"
+
+enum class PickTarget {
+    NONE,
+    EXHIBIT,
+    ROBOT
+};
+
+struct PickResult {
+    PickTarget target = PickTarget::NONE;
+    int objectIndex = -1;       // Valid when target == EXHIBIT
+    float distance = 0.0f;
+    glm::vec3 point = glm::vec3(0.0f);
+    float pickTimeMicroseconds = 0.0f;
+};
+
+// CPU mouse picking: casts a ray from the cursor through the camera into the exhibit BVH and the
+// robot. No GPU readback is involved, so picking never stalls the pipeline.
+class ScenePicker {
+public:
+    // World-space ray through a cursor position given in window coordinates (origin top-left)
+    static void cursorRay(double cursorX, double cursorY, int windowWidth, int windowHeight,
+                          const glm::mat4& view, const glm::mat4& projection,
+                          glm::vec3& origin, glm::vec3& direction);
+
+    static PickResult pick(const glm::vec3& origin, const glm::vec3& direction,
+                           const MuseumObjectManager& objectManager, const MobileRobot& robot);
+};
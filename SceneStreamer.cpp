@@ -0,0 +1,128 @@
+#include "SceneStreamer.h"
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include <cfloat>
+
+namespace {
+    // Faster camera moves are treated as teleports and reset the velocity estimate
+    const float MAX_TRACKED_SPEED = 50.0f;
+}
+
+void SceneStreamer::update(MuseumObjectManager& objectManager, const glm::vec3& cameraPosition,
+                           const glm::vec3& robotPosition, float deltaTime)
+{
+    // Where the camera is heading, from its smoothed velocity
+    if (hasLastCamera && deltaTime > 0.0f) {
+        glm::vec3 velocity = (cameraPosition - lastCameraPosition) / deltaTime;
+        cameraVelocity = glm::length(velocity) > MAX_TRACKED_SPEED ? glm::vec3(0.0f) : glm::mix(cameraVelocity, velocity, 0.2f);
+    }
+    hasLastCamera = true;
+    lastCameraPosition = cameraPosition;
+    glm::vec3 predictedPosition = cameraPosition + cameraVelocity * prefetchSeconds;
+
+    // One candidate per model, as near as its nearest placement
+    struct Candidate {
+        const std::string* path;
+        float distance;
+        Model::MemoryUsage size;
+        AssetRegistry::State state;
+        bool known;            // Requested or resident
+    };
+    std::vector<Candidate> candidates;
+    std::unordered_map<std::string, size_t> candidateByPath;
+    const AssetRegistry& assets = objectManager.getAssets();
+    for (size_t i = 0; i < objectManager.getObjectCount(); ++i) {
+        const MuseumObject* obj = objectManager.getObject(i);
+        float distance = std::min(glm::length(obj->position - cameraPosition),
+                                  std::min(glm::length(obj->position - predictedPosition), glm::length(obj->position - robotPosition)));
+
+        auto inserted = candidateByPath.emplace(obj->modelPath, candidates.size());
+        if (inserted.second) {
+            candidates.push_back({ &inserted.first->first, distance, Model::MemoryUsage(), AssetRegistry::State::FAILED, false });
+        } else {
+            Candidate& candidate = candidates[inserted.first->second];
+            candidate.distance = std::min(candidate.distance, distance);
+        }
+    }
+
+    size_t cpuUsed = 0, gpuUsed = 0, loading = 0;
+    stats.residentModels = 0;
+    for (Candidate& candidate : candidates) {
+        const std::string& path = *candidate.path;
+        candidate.known = assets.contains(path);
+        candidate.state = candidate.known ? assets.getState(path) : AssetRegistry::State::FAILED;
+
+        Size& size = sizes[path];
+        if (std::shared_ptr<Model> model = assets.get(path)) {
+            size.usage = model->GetMemoryUsage();
+            size.measured = true;
+            stats.residentModels++;
+        } else if (!size.measured && !size.estimated) {
+            size.usage = estimateSize(path);
+            size.estimated = true;
+        }
+        candidate.size = size.usage;
+
+        if (candidate.known && candidate.state != AssetRegistry::State::FAILED) {
+            cpuUsed += candidate.size.cpuBytes;
+            gpuUsed += candidate.size.gpuBytes;
+            if (candidate.state == AssetRegistry::State::LOADING) loading++;
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.distance < b.distance; });
+
+    // The nearest models that fit the budgets together should be resident
+    std::vector<bool> wanted(candidates.size(), false);
+    size_t cpuWanted = 0, gpuWanted = 0;
+    for (size_t i = 0; i < candidates.size() && candidates[i].distance <= loadDistance; ++i) {
+        const Candidate& candidate = candidates[i];
+        if (candidate.known && candidate.state == AssetRegistry::State::FAILED) continue;   // Not retried
+        if (cpuWanted + candidate.size.cpuBytes > cpuBudget || gpuWanted + candidate.size.gpuBytes > gpuBudget) continue;
+        cpuWanted += candidate.size.cpuBytes;
+        gpuWanted += candidate.size.gpuBytes;
+        wanted[i] = true;
+    }
+
+    // Evict the farthest unwanted models first: those out of range, then more while over budget
+    for (size_t i = candidates.size(); i-- > 0;) {
+        const Candidate& candidate = candidates[i];
+        if (wanted[i] || !candidate.known || candidate.state == AssetRegistry::State::FAILED) continue;
+        bool overBudget = cpuUsed > cpuBudget || gpuUsed > gpuBudget;
+        if (candidate.distance <= unloadDistance && !overBudget) continue;
+
+        if (!objectManager.unloadModel(*candidate.path)) continue;
+        cpuUsed -= std::min(cpuUsed, candidate.size.cpuBytes);
+        gpuUsed -= std::min(gpuUsed, candidate.size.gpuBytes);
+        if (candidate.state == AssetRegistry::State::LOADING) loading--;
+        stats.evictions++;
+    }
+
+    // Then request the nearest wanted models, a few at a time so uploads stay spread over frames
+    for (size_t i = 0; i < candidates.size() && loading < maxConcurrentLoads; ++i) {
+        const Candidate& candidate = candidates[i];
+        if (!wanted[i] || candidate.known) continue;
+        if (cpuUsed + candidate.size.cpuBytes > cpuBudget || gpuUsed + candidate.size.gpuBytes > gpuBudget) break;
+
+        objectManager.loadModel(*candidate.path);
+        cpuUsed += candidate.size.cpuBytes;
+        gpuUsed += candidate.size.gpuBytes;
+        loading++;
+        stats.loads++;
+    }
+
+    stats.loadingModels = loading;
+    stats.cpuBytes = cpuUsed;
+    stats.gpuBytes = gpuUsed;
+}
+
+Model::MemoryUsage SceneStreamer::estimateSize(const std::string& path)
+{
+    Model::MemoryUsage usage;
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (file) {
+        std::streamoff size = file.tellg();
+        usage.cpuBytes = usage.gpuBytes = size > 0 ? static_cast<size_t>(size) : 0;
+    }
+    return usage;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <unordered_map>
+#include "MuseumObjectManager.h"
+
+// Decides which exhibit models are resident so a collection larger than memory can be browsed.
+// Every update ranks the models by the distance from their nearest placement to the camera, to
+// where the camera will be prefetchSeconds from now at its current velocity, and to the robot.
+// The nearest models within loadDistance that fit the CPU and GPU budgets are loaded (a few at a
+// time); the others are evicted once they are beyond unloadDistance or the budgets are exceeded.
+// A model's size is measured once it is resident and estimated from its file size before that.
+class SceneStreamer {
+public:
+    size_t cpuBudget = size_t(512) << 20;
+    size_t gpuBudget = size_t(1024) << 20;
+    float loadDistance = 30.0f;
+    float unloadDistance = 40.0f;    // Larger than loadDistance so models do not flicker in and out
+    float prefetchSeconds = 1.5f;
+    size_t maxConcurrentLoads = 2;
+
+    // Call once per frame on the GL thread, before MuseumObjectManager::update()
+    void update(MuseumObjectManager& objectManager, const glm::vec3& cameraPosition,
+                const glm::vec3& robotPosition, float deltaTime);
+
+    struct Stats {
+        size_t residentModels = 0;
+        size_t loadingModels = 0;
+        size_t cpuBytes = 0;          // Resident models plus the estimates of those loading
+        size_t gpuBytes = 0;
+        size_t loads = 0;             // Totals since start
+        size_t evictions = 0;
+    };
+    const Stats& getStats() const { return stats; }
+
+private:
+    struct Size {
+        Model::MemoryUsage usage;
+        bool measured = false;
+        bool estimated = false;
+    };
+    std::unordered_map<std::string, Size> sizes;   // By model path
+
+    bool hasLastCamera = false;
+    glm::vec3 lastCameraPosition = glm::vec3(0.0f);
+    glm::vec3 cameraVelocity = glm::vec3(0.0f);    // Smoothed
+    Stats stats;
+
+    // The file size stands in for both footprints until the model has been loaded
+    static Model::MemoryUsage estimateSize(const std::string& path);
+};
@@ -1,6 +1,54 @@
 #include "Shader.h"
+#include <algorithm>
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
+namespace {
+    // The #version line must stay first, so the defines go right after it
+    void insertDefines(std::string& code, const std::string& defines)
+    {
+        size_t version = code.find("#version");
+        if (version == std::string::npos) {
+            code.insert(0, defines);
+            return;
+        }
+        size_t lineEnd = code.find('\n', version);
+        if (lineEnd == std::string::npos) code += "\n" + defines;
+        else code.insert(lineEnd + 1, defines);
+    }
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, std::vector<std::string> features)
+    : vertexPath(vertexPath), fragmentPath(fragmentPath), features(std::move(features))
+{
+    selectVariant(0);
+}
+
+bool Shader::reload() {
+    // All variants are rebuilt before any is replaced, so a failure leaves a consistent set
+    std::vector<std::pair<Variant*, unsigned int>> programs;
+    for (auto& entry : variants) {
+        bool linked;
+        unsigned int program = build(entry.first, linked);
+        programs.push_back({ &entry.second, program });
+        if (!linked) {
+            for (const auto& built : programs) glDeleteProgram(built.second);
+            std::cout << "ERROR::SHADER::RELOAD_FAILED: keeping the previous program for " << vertexPath << " + " << fragmentPath << std::endl;
+            return false;
+        }
+    }
+    
+    for (const auto& built : programs) {
+        Variant& variant = *built.first;
+        glDeleteProgram(variant.program);
+        variant.program = built.second;
+        variant.syncedSerial = 0;   // The new programs start from default values
+        resolveUniforms(variant);
+    }
+    ID = current->program;
+    std::cout << "Reloaded shader " << vertexPath << " + " << fragmentPath << std::endl;
+    return true;
+}
+
+unsigned int Shader::build(unsigned int mask, bool& linked) {
     // 1. retrieve the vertex/fragment source code from filePath
     std::string vertexCode;
     std::string fragmentCode;
@@ -13,8 +61,8 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
     
     try {
         // open files
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
+        vShaderFile.open(vertexPath.c_str());
+        fShaderFile.open(fragmentPath.c_str());
         std::stringstream vShaderStream, fShaderStream;
         
         // read file's buffer contents into streams
@@ -33,6 +81,15 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
     }
     
+    std::string defines;
+    for (size_t i = 0; i < features.size(); ++i) {
+        if (mask & (1u << i)) defines += "#define " + features[i] + "\n";
+    }
+    if (!defines.empty()) {
+        insertDefines(vertexCode, defines);
+        insertDefines(fragmentCode, defines);
+    }
+    
     const char* vShaderCode = vertexCode.c_str();
     const char* fShaderCode = fragmentCode.c_str();
     
@@ -43,55 +100,186 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
     vertex = glCreateShader(GL_VERTEX_SHADER);
     glShaderSource(vertex, 1, &vShaderCode, NULL);
     glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
+    bool compiled = checkCompileErrors(vertex, "VERTEX");
     
     // fragment shader
     fragment = glCreateShader(GL_FRAGMENT_SHADER);
     glShaderSource(fragment, 1, &fShaderCode, NULL);
     glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
+    compiled = checkCompileErrors(fragment, "FRAGMENT") && compiled;
     
     // shader Program
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    glLinkProgram(program);
+    linked = checkCompileErrors(program, "PROGRAM") && compiled;
     
     // delete the shaders as they're linked into our program now and no longer necessary
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+    return program;
+}
+
+void Shader::resolveUniforms(Variant& variant) {
+    unsigned int program = variant.program;
+    std::unordered_map<std::string, int>& uniformLocations = variant.uniformLocations;
+    uniformLocations.clear();
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> name(std::max(maxLength, 1));
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()), &length, &size, &type, name.data());
+        std::string uniform(name.data(), length);
+        GLint location = glGetUniformLocation(program, uniform.c_str());
+        if (location < 0) continue;   // Member of a uniform block
+        uniformLocations[uniform] = location;
+        // Arrays are reported as "name[0]" but are also set through their plain name
+        if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0) {
+            uniformLocations[uniform.substr(0, uniform.size() - 3)] = location;
+        }
+    }
+
+    for (const auto& binding : blockBindings) {
+        GLuint block = glGetUniformBlockIndex(program, binding.first.c_str());
+        if (block != GL_INVALID_INDEX) glUniformBlockBinding(program, block, binding.second);
+    }
+}
+
+void Shader::selectVariant(unsigned int mask) {
+    auto found = variants.find(mask);
+    if (found == variants.end()) {
+        bool linked;
+        Variant variant;
+        variant.program = build(mask, linked);
+        if (!linked && mask != 0) {
+            std::cout << "ERROR::SHADER::VARIANT_FAILED: " << fragmentPath << " with";
+            for (size_t i = 0; i < features.size(); ++i) {
+                if (mask & (1u << i)) std::cout << " " << features[i];
+            }
+            std::cout << std::endl;
+        }
+        resolveUniforms(variant);
+        found = variants.emplace(mask, std::move(variant)).first;
+    }
+    current = &found->second;
+    featureMask = mask;
+    ID = current->program;
 }
 
 void Shader::use() {
     glUseProgram(ID);
+    syncUniforms();
+}
+
+void Shader::setFeature(const std::string &name, bool enabled) {
+    setFeatures({ { name.c_str(), enabled } });
+}
+
+void Shader::setFeatures(std::initializer_list<std::pair<const char*, bool>> values) {
+    unsigned int mask = featureMask;
+    for (const auto& value : values) {
+        auto feature = std::find(features.begin(), features.end(), value.first);
+        if (feature == features.end()) continue;
+        unsigned int bit = 1u << (feature - features.begin());
+        mask = value.second ? mask | bit : mask & ~bit;
+    }
+    if (mask == featureMask) return;
+    selectVariant(mask);
+    use();
+}
+
+void Shader::syncUniforms() {
+    if (current->syncedSerial == uniformSerial) return;
+    for (const auto& entry : shadowedUniforms) {
+        const ShadowedUniform& value = entry.second;
+        if (value.serial <= current->syncedSerial) continue;
+        int location = getUniformLocation(entry.first);
+        switch (value.type) {
+        case UniformType::INT: glUniform1i(location, value.intValue); break;
+        case UniformType::FLOAT: glUniform1f(location, value.values[0]); break;
+        case UniformType::VEC2: glUniform2fv(location, 1, value.values); break;
+        case UniformType::VEC3: glUniform3fv(location, 1, value.values); break;
+        case UniformType::MAT3: glUniformMatrix3fv(location, 1, GL_FALSE, value.values); break;
+        case UniformType::MAT4: glUniformMatrix4fv(location, 1, GL_FALSE, value.values); break;
+        }
+    }
+    current->syncedSerial = uniformSerial;
+}
+
+void Shader::shadow(const std::string &name, UniformType type, int intValue, const float* values, int count) const {
+    if (features.empty()) return;
+    ShadowedUniform& value = shadowedUniforms[name];
+    value.type = type;
+    value.intValue = intValue;
+    std::copy(values, values + count, value.values);
+    // The current program already has the value, so it stays up to date if it was before
+    bool synced = current->syncedSerial == uniformSerial;
+    value.serial = ++uniformSerial;
+    if (synced) current->syncedSerial = uniformSerial;
+}
+
+void Shader::bindUniformBlock(const char* blockName, unsigned int binding) {
+    blockBindings.push_back({ blockName, binding });
+    for (const auto& entry : variants) {
+        GLuint block = glGetUniformBlockIndex(entry.second.program, blockName);
+        if (block != GL_INVALID_INDEX) glUniformBlockBinding(entry.second.program, block, binding);
+    }
+}
+
+int Shader::getUniformLocation(const std::string &name) const {
+    std::unordered_map<std::string, int>& uniformLocations = current->uniformLocations;
+    auto found = uniformLocations.find(name);
+    if (found != uniformLocations.end()) return found->second;
+    int location = glGetUniformLocation(ID, name.c_str());
+    uniformLocations[name] = location;
+    return location;
 }
 
 void Shader::setBool(const std::string &name, bool value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    glUniform1i(getUniformLocation(name), (int)value);
+    shadow(name, UniformType::INT, (int)value, nullptr, 0);
 }
 
 void Shader::setInt(const std::string &name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1i(getUniformLocation(name), value);
+    shadow(name, UniformType::INT, value, nullptr, 0);
 }
 
 void Shader::setFloat(const std::string &name, float value) const {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1f(getUniformLocation(name), value);
+    shadow(name, UniformType::FLOAT, 0, &value, 1);
+}
+
+void Shader::setVec2(const std::string &name, const glm::vec2 &value) const {
+    glUniform2fv(getUniformLocation(name), 1, &value[0]);
+    shadow(name, UniformType::VEC2, 0, &value[0], 2);
 }
 
 void Shader::setVec3(const std::string &name, const glm::vec3 &value) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform3fv(getUniformLocation(name), 1, &value[0]);
+    shadow(name, UniformType::VEC3, 0, &value[0], 3);
 }
 
 void Shader::setVec3(const std::string &name, float x, float y, float z) const {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    setVec3(name, glm::vec3(x, y, z));
+}
+
+void Shader::setMat3(const std::string &name, const glm::mat3 &mat) const {
+    glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+    shadow(name, UniformType::MAT3, 0, &mat[0][0], 9);
 }
 
 void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+    shadow(name, UniformType::MAT4, 0, &mat[0][0], 16);
 }
 
-void Shader::checkCompileErrors(unsigned int shader, std::string type) {
+bool Shader::checkCompileErrors(unsigned int shader, std::string type) {
     int success;
     char infoLog[1024];
     if (type != "PROGRAM") {
@@ -108,4 +296,5 @@ void Shader::checkCompileErrors(unsigned int shader, std::string type) {
             std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
         }
     }
+    return success != 0;
 }
@@ -6,31 +6,105 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include <initializer_list>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 class Shader {
 public:
-    unsigned int ID;
+    unsigned int ID;   // Program of the current variant
     
-    // Constructor generates the shader on the fly
-    Shader(const char* vertexPath, const char* fragmentPath);
+    // Constructor generates the shader on the fly. The optional features are #define names the
+    // sources test with #ifdef; every combination of them is a separate variant, compiled the
+    // first time setFeature(s) selects it.
+    Shader(const char* vertexPath, const char* fragmentPath, std::vector<std::string> features = std::vector<std::string>());
+    
+    // Recompiles every compiled variant from the same files. On a compile or link error the
+    // previous programs are kept and false is returned. The program IDs change, so use() it again.
+    bool reload();
+
+    const std::string& getVertexPath() const { return vertexPath; }
+    const std::string& getFragmentPath() const { return fragmentPath; }
     
     // Activate the shader
     void use();
+
+    // Turn features on or off and switch to the matching variant, which becomes the current
+    // program. Uniforms set on the shader carry over to every variant, so the values set before
+    // the switch still apply. Names the shader was not given are ignored.
+    void setFeature(const std::string &name, bool enabled);
+    void setFeatures(std::initializer_list<std::pair<const char*, bool>> values);
+    size_t getVariantCount() const { return variants.size(); }
+
+    // Connects the named uniform block to a binding point (see FrameUniforms). Kept across
+    // reload(); ignored if the program has no such block.
+    void bindUniformBlock(const char* blockName, unsigned int binding);
+
+    // Location of a uniform, resolved when the program is linked; -1 if it is not active
+    int getUniformLocation(const std::string &name) const;
     
-    // Utility uniform functions
+    // Utility uniform functions (use the cached locations)
     void setBool(const std::string &name, bool value) const;
     void setInt(const std::string &name, int value) const;
     void setFloat(const std::string &name, float value) const;
+    void setVec2(const std::string &name, const glm::vec2 &value) const;
     void setVec3(const std::string &name, const glm::vec3 &value) const;
     void setVec3(const std::string &name, float x, float y, float z) const;
+    void setMat3(const std::string &name, const glm::mat3 &mat) const;
     void setMat4(const std::string &name, const glm::mat4 &mat) const;
 
 private:
-    // Utility function for checking shader compilation/linking errors
-    void checkCompileErrors(unsigned int shader, std::string type);
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::vector<std::string> features;   // Bit i of a feature mask defines features[i]
+
+    struct Variant {
+        unsigned int program = 0;
+        // Uniform locations by name. Filled with every active uniform after linking; names not
+        // listed there (e.g. "lights[2]" of a plain array) are looked up once on first use.
+        std::unordered_map<std::string, int> uniformLocations;
+        uint64_t syncedSerial = 0;   // Shadowed values up to this serial are set in the program
+    };
+    std::unordered_map<unsigned int, Variant> variants;   // By feature mask
+    Variant* current = nullptr;
+    unsigned int featureMask = 0;
+    std::vector<std::pair<std::string, unsigned int>> blockBindings;
+
+    // Last value set for each uniform, kept only by shaders with features so that a variant
+    // switched to can be brought up to date. Values are stamped with an increasing serial.
+    enum class UniformType { INT, FLOAT, VEC2, VEC3, MAT3, MAT4 };
+    struct ShadowedUniform {
+        UniformType type;
+        uint64_t serial;
+        int intValue;
+        float values[16];
+    };
+    mutable std::unordered_map<std::string, ShadowedUniform> shadowedUniforms;
+    mutable uint64_t uniformSerial = 0;
+
+    // Reads, compiles and links the two files with the features of the mask defined. The program
+    // is returned even if it failed to link.
+    unsigned int build(unsigned int mask, bool& linked);
+
+    // Rebuilds the location cache and reapplies the block bindings for a variant's program
+    void resolveUniforms(Variant& variant);
+
+    // Makes the variant of the mask current, compiling it if needed
+    void selectVariant(unsigned int mask);
+
+    // Sets the shadowed values the current program has not seen yet; it must be in use
+    void syncUniforms();
+
+    // Records a value for the other variants, if there are any
+    void shadow(const std::string &name, UniformType type, int intValue, const float* values, int count) const;
+
+    // Utility function for checking shader compilation/linking errors. Returns true on success.
+    bool checkCompileErrors(unsigned int shader, std::string type);
 };
 
 #endif
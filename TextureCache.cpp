@@ -0,0 +1,248 @@
+#include "TextureCache.h"
+#include "MeshCache.h"
+#include "Model.h"
+#include "stb_image.h"
+#include <iostream>
+#include <cstdio>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+    const char* COMPRESSED_CACHE_DIRECTORY = "texture_cache";
+
+    std::string compressedPathFor(const TextureCache::Image& image)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), image.normalMap ? "%016llx_n.ktx2" : "%016llx.ktx2",
+                      static_cast<unsigned long long>(image.contentHash));
+        return std::string(COMPRESSED_CACHE_DIRECTORY) + "/" + name;
+    }
+
+    void createCacheDirectory()
+    {
+#ifdef _WIN32
+        _mkdir(COMPRESSED_CACHE_DIRECTORY);
+#else
+        mkdir(COMPRESSED_CACHE_DIRECTORY, 0755);
+#endif
+    }
+
+    void decodeInto(TextureCache::Image& image)
+    {
+        unsigned char* pixels = stbi_load(image.filename.c_str(), &image.width, &image.height, &image.components, 0);
+        if (pixels) {
+            image.pixels.reset(pixels, stbi_image_free);
+        } else {
+            std::cout << "Texture failed to load at path: " << image.filename << std::endl;
+        }
+    }
+}
+
+TextureCache::Image TextureCache::load(const std::string& filename, bool normalMap) const
+{
+    Image image;
+    image.filename = filename;
+    image.normalMap = normalMap;
+    if (!MeshCache::hashFile(filename, image.contentHash)) {
+        std::cout << "Texture failed to load at path: " << filename << std::endl;
+        image.contentHash = 0;
+        return image;
+    }
+
+    return prepare(image, decodeInto);
+}
+
+TextureCache::Image TextureCache::loadFromMemory(const std::string& name, const unsigned char* bytes, size_t size,
+                                                 bool normalMap) const
+{
+    Image image;
+    image.filename = name;
+    image.normalMap = normalMap;
+    image.contentHash = MeshCache::hashBytes(bytes, size);
+    return prepare(image, [&](Image& decoded) {
+        unsigned char* pixels = stbi_load_from_memory(bytes, static_cast<int>(size), &decoded.width, &decoded.height,
+                                                      &decoded.components, 0);
+        if (pixels) {
+            decoded.pixels.reset(pixels, stbi_image_free);
+        } else {
+            std::cout << "Texture failed to decode: " << name << " (" << stbi_failure_reason() << ")" << std::endl;
+        }
+    });
+}
+
+TextureCache::Image TextureCache::loadFromTexels(const std::string& name, const unsigned char* bgra, int width, int height,
+                                                 bool normalMap) const
+{
+    size_t texelCount = static_cast<size_t>(width) * height;
+    Image image;
+    image.filename = name;
+    image.normalMap = normalMap;
+    image.contentHash = MeshCache::hashBytes(bgra, texelCount * 4);
+    return prepare(image, [&](Image& decoded) {
+        // GL 3.3 core has no BGRA internal format, so swizzle into a new buffer
+        std::shared_ptr<unsigned char> rgba(new unsigned char[texelCount * 4], std::default_delete<unsigned char[]>());
+        unsigned char* out = rgba.get();
+        for (size_t i = 0; i < texelCount; ++i) {
+            out[i * 4 + 0] = bgra[i * 4 + 2];
+            out[i * 4 + 1] = bgra[i * 4 + 1];
+            out[i * 4 + 2] = bgra[i * 4 + 0];
+            out[i * 4 + 3] = bgra[i * 4 + 3];
+        }
+        decoded.width = width;
+        decoded.height = height;
+        decoded.components = 4;
+        decoded.pixels = rgba;
+    });
+}
+
+TextureCache::Image TextureCache::prepare(Image image, const std::function<void(Image&)>& decode) const
+{
+    std::shared_ptr<PendingImage> decoding;
+    {
+        std::unique_lock<std::mutex> lock(cacheMutex);
+        uint64_t key = entryKey(image);
+
+        // Same bytes already on the GPU: skip the decode, acquire() will share the texture
+        if (entries.count(key) != 0) return image;
+
+        // Another import is decoding the same image: wait and share its pixels or compressed form
+        auto inFlight = pending.find(key);
+        if (inFlight != pending.end()) {
+            std::shared_ptr<PendingImage> first = inFlight->second;
+            decodeFinished.wait(lock, [&] { return first->done; });
+            Image shared = first->image;
+            shared.filename = image.filename;
+            return shared;
+        }
+        decoding = std::make_shared<PendingImage>();
+        pending[key] = decoding;
+    }
+
+    if (!loadCompressed(image)) {
+        decode(image);
+        compress(image);
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    decoding->image = image;
+    decoding->done = true;
+    pending.erase(entryKey(image));
+    decodeFinished.notify_all();
+    return image;
+}
+
+unsigned int TextureCache::acquire(const Image& image)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    uint64_t key = entryKey(image);
+    auto found = entries.find(key);
+    if (found != entries.end()) {
+        found->second.references++;
+        stats.hits++;
+        return found->second.textureId;
+    }
+
+    // The texture prepare() saw as resident may have been released since; reload it here instead
+    // (embedded images cannot be re-read by name and fall back to white in that rare case)
+    Image decoded = image;
+    if (!decoded.pixels && !decoded.compressed && decoded.contentHash != 0 && !loadCompressed(decoded)) {
+        decodeInto(decoded);
+    }
+
+    Entry entry;
+    entry.references = 1;
+    if (decoded.compressed) {
+        entry.textureId = decoded.compressed->upload();
+        entry.gpuBytes = decoded.compressed->getByteSize();
+    } else {
+        entry.textureId = TextureFromImage(decoded.pixels.get(), decoded.width, decoded.height, decoded.components);
+        if (decoded.pixels) {
+            // Drivers store 3-channel images as 4; the full mip chain adds a third
+            size_t texelBytes = decoded.components == 1 ? 1 : 4;
+            entry.gpuBytes = static_cast<size_t>(decoded.width) * decoded.height * texelBytes * 4 / 3;
+        } else {
+            entry.gpuBytes = 4;   // 1x1 white fallback
+        }
+    }
+
+    entries[key] = entry;
+    hashById[entry.textureId] = key;
+    stats.textures++;
+    stats.gpuBytes += entry.gpuBytes;
+    stats.uploads++;
+    return entry.textureId;
+}
+
+void TextureCache::release(unsigned int textureId)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    auto hash = hashById.find(textureId);
+    if (hash == hashById.end()) return;
+
+    auto found = entries.find(hash->second);
+    if (--found->second.references > 0) return;
+
+    glDeleteTextures(1, &found->second.textureId);
+    stats.textures--;
+    stats.gpuBytes -= found->second.gpuBytes;
+    entries.erase(found);
+    hashById.erase(hash);
+}
+
+size_t TextureCache::getTextureBytes(unsigned int textureId) const
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto hash = hashById.find(textureId);
+    return hash != hashById.end() ? entries.at(hash->second).gpuBytes : 0;
+}
+
+TextureCache::Stats TextureCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return stats;
+}
+
+uint64_t TextureCache::entryKey(const Image& image)
+{
+    // Unreadable images keep key 0 and share the white fallback whatever their use
+    if (image.contentHash == 0 || !image.normalMap) return image.contentHash;
+    return image.contentHash ^ 0x9e3779b97f4a7c15ULL;
+}
+
+bool TextureCache::loadCompressed(Image& image)
+{
+    if (image.contentHash == 0) return false;
+
+    std::shared_ptr<CompressedTexture> compressed = CompressedTexture::load(compressedPathFor(image));
+    if (!compressed) return false;
+
+    image.width = compressed->getWidth();
+    image.height = compressed->getHeight();
+    image.compressed = compressed;
+    return true;
+}
+
+void TextureCache::compress(Image& image)
+{
+    if (!image.pixels || image.contentHash == 0) return;
+
+    std::shared_ptr<CompressedTexture> compressed =
+        CompressedTexture::encode(image.pixels.get(), image.width, image.height, image.components, image.normalMap);
+    if (!compressed) return;
+
+    createCacheDirectory();
+    compressed->save(compressedPathFor(image));
+    image.compressed = compressed;
+    image.pixels.reset();
+}
+
+TextureCache& TextureCache::shared()
+{
+    static TextureCache cache;
+    return cache;
+}
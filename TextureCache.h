@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+#include "CompressedTexture.h"
+
+// Process-wide registry of GL textures keyed by a hash of the image file's contents (and by whether
+// it is sampled as a normal map, which is stored in a different format).
+// Every distinct image is decoded and uploaded once no matter how many models (or paths) use
+// it; users hold references and the texture is deleted when the last one is released.
+// Decoded images are also block-compressed once and kept under texture_cache/, so later runs
+// map the compressed mip chain instead of decoding PNG/JPEG again.
+class TextureCache {
+public:
+    // An image file prepared for upload. Produced by load() on any thread.
+    struct Image {
+        std::string filename;
+        uint64_t contentHash = 0;              // FNV-1a of the file's bytes, 0 if it could not be read
+        bool normalMap = false;                // Tangent-space normals: only X and Y are kept (BC5)
+        int width = 0, height = 0, components = 0;
+        std::shared_ptr<unsigned char> pixels; // Null if not decoded (already resident, compressed, or decoding failed)
+        std::shared_ptr<const CompressedTexture> compressed;   // Set instead of pixels when available
+    };
+
+    // Hashes the file and decodes it unless a texture with the same contents is already resident
+    // or its compressed form is on disk. Freshly decoded images are compressed and saved.
+    // Thread-safe and GL-free, so loaders call it from worker threads; concurrent loads of the
+    // same contents decode once and share the result.
+    Image load(const std::string& filename, bool normalMap = false) const;
+
+    // Same for an encoded image (PNG, JPEG, ...) already in memory, e.g. embedded in a GLB.
+    // Decodes straight from the given bytes; name is only used for messages.
+    Image loadFromMemory(const std::string& name, const unsigned char* bytes, size_t size, bool normalMap = false) const;
+
+    // Same for raw 8-bit BGRA texels, as Assimp stores uncompressed embedded textures
+    Image loadFromTexels(const std::string& name, const unsigned char* bgra, int width, int height,
+                         bool normalMap = false) const;
+
+    // Returns the texture for the image, uploading it if this is its first user. Each call adds a
+    // reference. Unreadable images share a 1x1 white texture. Must run on the GL thread.
+    unsigned int acquire(const Image& image);
+
+    // Drops a reference taken by acquire(); the texture is deleted when none are left
+    void release(unsigned int textureId);
+
+    // Estimated GPU size of a texture returned by acquire(), including its mip chain; 0 if unknown
+    size_t getTextureBytes(unsigned int textureId) const;
+
+    struct Stats {
+        size_t textures = 0;
+        size_t gpuBytes = 0;       // Estimated, including the mip chain
+        size_t hits = 0;           // acquire() calls served by an existing texture
+        size_t uploads = 0;
+    };
+    Stats getStats() const;
+
+    static TextureCache& shared();
+
+private:
+    struct Entry {
+        unsigned int textureId = 0;
+        size_t gpuBytes = 0;
+        unsigned int references = 0;
+    };
+
+    mutable std::mutex cacheMutex;
+    std::unordered_map<uint64_t, Entry> entries;           // By entryKey()
+    std::unordered_map<unsigned int, uint64_t> hashById;   // For release()
+    Stats stats;
+
+    // An image being decoded by one load*() call, which later callers for the same key wait on
+    struct PendingImage {
+        bool done = false;
+        Image image;
+    };
+    mutable std::unordered_map<uint64_t, std::shared_ptr<PendingImage>> pending;   // By entryKey(), while decoding
+    mutable std::condition_variable decodeFinished;
+
+    // Shared tail of the load*() calls: returns at once if the image is resident, maps its
+    // compressed form or runs decode and compress() otherwise. Decodes each key only once.
+    Image prepare(Image image, const std::function<void(Image&)>& decode) const;
+
+    // Content hash with the normal-map usage mixed in, so both uses of one image get their own texture
+    static uint64_t entryKey(const Image& image);
+
+    // Maps texture_cache/<hash>.ktx2 (<hash>_n.ktx2 for normal maps) if an earlier run wrote it
+    static bool loadCompressed(Image& image);
+
+    // Encodes decoded pixels, saves the result and releases the pixels. Keeps the pixels when
+    // the format is unsupported on this GPU.
+    static void compress(Image& image);
+};
@@ -0,0 +1,133 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <exception>
+
+namespace {
+    thread_local bool onWorkerThread = false;
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    if (threadCount == 0) {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    workers.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void ThreadPool::workerLoop()
+{
+    onWorkerThread = true;
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+            // Drain the queue before exiting so pending futures are always satisfied
+            if (stopping && tasks.empty()) {
+                return;
+            }
+
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+std::vector<std::future<void>> ThreadPool::dispatch(size_t count, size_t grainSize,
+                                                    const std::function<void(size_t, size_t)>& body)
+{
+    std::vector<std::future<void>> futures;
+    if (count == 0) return futures;
+
+    grainSize = std::max<size_t>(1, grainSize);
+    futures.reserve((count + grainSize - 1) / grainSize);
+
+    for (size_t begin = 0; begin < count; begin += grainSize) {
+        size_t end = std::min(count, begin + grainSize);
+        futures.push_back(enqueue([body, begin, end]() { body(begin, end); }));
+    }
+    return futures;
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grainSize,
+                             const std::function<void(size_t, size_t)>& body)
+{
+    if (count == 0) return;
+    grainSize = std::max<size_t>(1, grainSize);
+
+    // Chunks are claimed from a shared counter so the caller can work alongside the pool
+    // instead of sleeping until the workers finish. The caller waits for the claimed chunks
+    // to complete, not for the helper tasks: when parallelFor is reached from a pool task and
+    // every worker is busy, the helpers never start, the caller runs every chunk itself and
+    // the helpers later find nothing left to do.
+    struct State {
+        std::atomic<size_t> nextChunk{ 0 };
+        size_t finishedChunks = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto state = std::make_shared<State>();
+    size_t chunkCount = (count + grainSize - 1) / grainSize;
+
+    auto runChunks = [state, chunkCount, count, grainSize, body]() {
+        size_t chunk;
+        while ((chunk = state->nextChunk.fetch_add(1)) < chunkCount) {
+            size_t begin = chunk * grainSize;
+            std::exception_ptr error;
+            try {
+                body(begin, std::min(count, begin + grainSize));
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (error && !state->error) state->error = error;
+            if (++state->finishedChunks == chunkCount) state->finished.notify_all();
+        }
+    };
+
+    size_t helperCount = std::min(workers.size(), chunkCount - 1);
+    for (size_t i = 0; i < helperCount; ++i) {
+        enqueue(runChunks);
+    }
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&]() { return state->finishedChunks == chunkCount; });
+    if (state->error) std::rethrow_exception(state->error);
+}
+
+bool ThreadPool::isWorkerThread()
+{
+    return onWorkerThread;
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+
+// Fixed-size pool of worker threads used for CPU-side work that must not block the GL thread
+// (secondary rays, scanning, asset import). Tasks are plain callables; results come back as futures.
+class ThreadPool {
+public:
+    // Creates the pool. A thread count of 0 picks hardware_concurrency() - 1 (at least one worker).
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task and get a future for its result
+    template<class F>
+    auto enqueue(F&& task) -> std::future<decltype(task())>
+    {
+        using ResultType = decltype(task());
+        auto packaged = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(task));
+        std::future<ResultType> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            tasks.emplace([packaged]() { (*packaged)(); });
+        }
+        queueCondition.notify_one();
+        return result;
+    }
+
+    // Split [0, count) into chunks of at most grainSize and queue one task per chunk.
+    // Returns immediately; wait on the returned futures to join.
+    std::vector<std::future<void>> dispatch(size_t count, size_t grainSize,
+                                            const std::function<void(size_t begin, size_t end)>& body);
+
+    // Same as dispatch() but blocks until every chunk is done. The calling thread helps with the work
+    // and only waits on chunks another thread has already started, so it is safe to call from a pool task.
+    void parallelFor(size_t count, size_t grainSize,
+                     const std::function<void(size_t begin, size_t end)>& body);
+
+    size_t getThreadCount() const { return workers.size(); }
+
+    // True on threads owned by any ThreadPool
+    static bool isWorkerThread();
+
+    // Process-wide pool shared by the renderer, robot and loaders
+    static ThreadPool& shared();
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping = false;
+
+    void workerLoop();
+};
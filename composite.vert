@@ -0,0 +1,15 @@
+#version 330 core
+layout (location = 0) in vec2 aPixel;
+layout (location = 1) in vec4 aColor;
+
+out vec4 Color;
+
+uniform vec2 viewportSize;
+
+void main()
+{
+    // One point per traced pixel, placed exactly on its pixel center
+    vec2 ndc = (aPixel + 0.5) / viewportSize * 2.0 - 1.0;
+    gl_Position = vec4(ndc, 0.0, 1.0);
+    Color = aColor;
+}
@@ -0,0 +1,87 @@
+#version 330 core
+// Geometry pass of the deferred path (DeferredRenderer), drawn with shader.vert. Writes the
+// surface shader.frag would light instead of lighting it.
+layout (location = 0) out vec2 gNormal;    // Octahedral world normal
+layout (location = 1) out vec4 gAlbedo;    // Diffuse colour; ambient / diffuse ratio halved in alpha
+layout (location = 2) out vec2 gSpecular;  // Specular intensity, log2(shininess) / 8
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoord;
+in vec3 Tangent;
+in vec3 Bitangent;
+flat in vec3 InstanceAmbient;
+flat in vec3 InstanceDiffuse;
+flat in vec3 InstanceSpecular;
+
+struct Material {
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float shininess;
+};
+
+uniform sampler2D texture_diffuse1;
+uniform sampler2D texture_specular1;
+uniform sampler2D texture_normal1;
+
+// Compiled with the HAS_TEXTURE, HAS_SPECULAR_MAP and HAS_NORMAL_MAP features of shader.frag
+uniform bool instanced;
+uniform Material material;
+
+vec2 OctWrap(vec2 v)
+{
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 EncodeOctahedral(vec3 n)
+{
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+    n.xy = n.z >= 0.0 ? n.xy : OctWrap(n.xy);
+    return n.xy;
+}
+
+#ifdef HAS_NORMAL_MAP
+// Tangent-space normal from texture_normal1, which keeps only X and Y (BC5); Z is rebuilt from
+// the unit length. Vertices without a tangent frame keep the interpolated normal.
+vec3 FetchNormal()
+{
+    vec3 normal = normalize(Normal);
+    if (dot(Tangent, Tangent) < 1e-8 || dot(Bitangent, Bitangent) < 1e-8) return normal;
+    vec2 xy = texture(texture_normal1, TexCoord).rg * 2.0 - 1.0;
+    vec3 tangentNormal = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+    return normalize(mat3(normalize(Tangent), normalize(Bitangent), normal) * tangentNormal);
+}
+#endif
+
+float Luminance(vec3 color)
+{
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+void main()
+{
+    // Same material selection as shader.frag
+    vec3 ambient_color = instanced ? InstanceAmbient : material.ambient;
+    vec3 diffuse_color = instanced ? InstanceDiffuse : material.diffuse;
+    vec3 specular_color = instanced ? InstanceSpecular : material.specular;
+#ifdef HAS_TEXTURE
+    diffuse_color = texture(texture_diffuse1, TexCoord).rgb;
+    ambient_color = diffuse_color;
+#endif
+#ifdef HAS_SPECULAR_MAP
+    specular_color = texture(texture_specular1, TexCoord).rgb;
+#endif
+
+    // Ambient is stored relative to the diffuse colour and specular as one intensity, which
+    // keeps the G-buffer at 14 bytes per pixel
+    float ambientRatio = Luminance(ambient_color) / max(Luminance(diffuse_color), 1e-4);
+#ifdef HAS_NORMAL_MAP
+    gNormal = EncodeOctahedral(FetchNormal());
+#else
+    gNormal = EncodeOctahedral(normalize(Normal));
+#endif
+    gAlbedo = vec4(diffuse_color, clamp(ambientRatio * 0.5, 0.0, 1.0));
+    gSpecular = vec2(max(specular_color.r, max(specular_color.g, specular_color.b)),
+                     clamp(log2(max(material.shininess, 1.0)) / 8.0, 0.0, 1.0));
+}
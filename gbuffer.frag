@@ -0,0 +1,27 @@
+#version 330 core
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out uint gMaterial;
+
+in vec3 Normal;
+
+// 0 = diffuse surface, anything else indexes the hybrid renderer's material table
+uniform int materialId;
+
+vec2 OctWrap(vec2 v)
+{
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Octahedral encoding keeps a unit normal in two channels
+vec2 EncodeOctahedral(vec3 n)
+{
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+    n.xy = n.z >= 0.0 ? n.xy : OctWrap(n.xy);
+    return n.xy;
+}
+
+void main()
+{
+    gNormal = EncodeOctahedral(normalize(Normal));
+    gMaterial = uint(materialId);
+}
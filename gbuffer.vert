@@ -0,0 +1,37 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+
+out vec3 Normal;
+
+uniform mat4 model;
+uniform mat3 normalMatrix;   // Inverse transpose of model (Mesh::setTransform)
+
+// Written once per frame by FrameUniforms
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
+
+// Set by Mesh::Draw for the packed exhibit vertices (see shader.vert)
+uniform bool packedVertex;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main()
+{
+    vec3 position = packedVertex ? positionOffset + aPos * positionScale : aPos;
+    vec3 normal = packedVertex ? decodeOctahedral(aNormal.xy) : aNormal;
+    Normal = normalMatrix * normal;
+    gl_Position = projection * view * model * vec4(position, 1.0);
+}
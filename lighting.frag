@@ -0,0 +1,153 @@
+#version 330 core
+// Lighting pass of the deferred path (DeferredRenderer): shades every visible pixel once from the
+// G-buffer, with the directional light and the lights of the pixel's cluster as in shader.frag.
+out vec4 FragColor;
+
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedo;
+uniform sampler2D gSpecular;
+uniform sampler2D gDepth;
+
+uniform mat4 inverseViewProjection;
+
+struct DirLight {
+    vec3 direction;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct SpotLight {
+    vec3 position;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+    float range;
+    float linear;
+    float quadratic;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// Surface read back from the G-buffer
+struct Surface {
+    vec3 position;
+    vec3 normal;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float shininess;
+};
+
+// Written once per frame by FrameUniforms
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
+
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    vec4 clusterScale;
+    ivec4 clusterCount;
+};
+
+// Light clusters (LightClusters)
+uniform samplerBuffer clusterLights;
+uniform usamplerBuffer clusterRanges;
+uniform usamplerBuffer clusterLightIndices;
+
+vec3 DecodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+// Unpacks a light from the five texels LightClusters::update writes
+SpotLight FetchLight(int index)
+{
+    vec4 t0 = texelFetch(clusterLights, index * 5);
+    vec4 t1 = texelFetch(clusterLights, index * 5 + 1);
+    vec4 t2 = texelFetch(clusterLights, index * 5 + 2);
+    vec4 t3 = texelFetch(clusterLights, index * 5 + 3);
+    vec4 t4 = texelFetch(clusterLights, index * 5 + 4);
+
+    SpotLight light;
+    light.position = t0.xyz;
+    light.range = t0.w;
+    light.direction = t1.xyz;
+    light.cutOff = t1.w;
+    light.ambient = t2.rgb;
+    light.outerCutOff = t2.w;
+    light.diffuse = t3.rgb;
+    light.linear = t3.w;
+    light.specular = t4.rgb;
+    light.quadratic = t4.w;
+    return light;
+}
+
+vec3 CalcDirLight(DirLight light, Surface surface, vec3 viewDir)
+{
+    vec3 lightDir = normalize(-light.direction);
+    float diff = max(dot(surface.normal, lightDir), 0.0);
+    vec3 reflectDir = reflect(-lightDir, surface.normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), surface.shininess);
+    return light.ambient * surface.ambient + light.diffuse * diff * surface.diffuse + light.specular * spec * surface.specular;
+}
+
+vec3 CalcSpotLight(SpotLight light, Surface surface, vec3 viewDir)
+{
+    vec3 lightDir = normalize(light.position - surface.position);
+    float diff = max(dot(surface.normal, lightDir), 0.0);
+    vec3 reflectDir = reflect(-lightDir, surface.normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), surface.shininess);
+    float distance = length(light.position - surface.position);
+    float attenuation = 1.0 / (1.0 + light.linear * distance + light.quadratic * (distance * distance));
+    float window = clamp(1.0 - pow(distance / light.range, 4.0), 0.0, 1.0);
+    attenuation *= window * window;
+    float theta = dot(lightDir, normalize(-light.direction));
+    float epsilon = light.cutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+
+    vec3 color = light.ambient * surface.ambient + light.diffuse * diff * surface.diffuse + light.specular * spec * surface.specular;
+    return color * attenuation * intensity;
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    if (depth >= 1.0) discard;   // Background keeps the clear colour
+
+    vec2 uv = gl_FragCoord.xy / vec2(textureSize(gDepth, 0));
+    vec4 world = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    vec4 albedo = texelFetch(gAlbedo, pixel, 0);
+    vec2 specular = texelFetch(gSpecular, pixel, 0).rg;
+
+    Surface surface;
+    surface.position = world.xyz / world.w;
+    surface.normal = DecodeOctahedral(texelFetch(gNormal, pixel, 0).rg);
+    surface.diffuse = albedo.rgb;
+    surface.ambient = albedo.rgb * albedo.a * 2.0;
+    surface.specular = vec3(specular.r);
+    surface.shininess = exp2(specular.g * 8.0);
+
+    vec3 viewDir = normalize(viewPos - surface.position);
+    vec3 result = CalcDirLight(dirLight, surface, viewDir);
+
+    float viewDepth = -(view * vec4(surface.position, 1.0)).z;
+    ivec2 tile = min(ivec2(gl_FragCoord.xy * clusterScale.xy), clusterCount.xy - 1);
+    int slice = clamp(int(log(max(viewDepth, 1e-4)) * clusterScale.z + clusterScale.w), 0, clusterCount.z - 1);
+    int cluster = (slice * clusterCount.y + tile.y) * clusterCount.x + tile.x;
+    uvec2 lightRange = texelFetch(clusterRanges, cluster).xy;
+    for (uint i = 0u; i < lightRange.y; i++) {
+        int light = int(texelFetch(clusterLightIndices, int(lightRange.x + i)).r);
+        result += CalcSpotLight(FetchLight(light), surface, viewDir);
+    }
+
+    FragColor = vec4(result, 1.0);
+}
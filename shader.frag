@@ -6,6 +6,9 @@ in vec3 Normal;
 in vec2 TexCoord;
 in vec3 Tangent;
 in vec3 Bitangent;
+flat in vec3 InstanceAmbient;
+flat in vec3 InstanceDiffuse;
+flat in vec3 InstanceSpecular;
 
 struct Material {
     vec3 ambient;
@@ -20,37 +23,29 @@ uniform sampler2D texture_specular1;
 uniform sampler2D texture_normal1;
 uniform sampler2D texture_height1;
 
-// Material flags
-uniform bool hasTexture;
+// Compiled as variants (Shader features): HAS_TEXTURE takes the ambient and diffuse colours from
+// texture_diffuse1, HAS_SPECULAR_MAP the specular colour from texture_specular1, HAS_NORMAL_MAP
+// the normal from texture_normal1, and ADVANCED_SHADING adds the PBR-like effects
+uniform bool instanced;     // Material colours come per instance instead of from material
 
+// Laid out for std140 (FrameUniforms)
 struct DirLight {
     vec3 direction;
-    
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct PointLight {
-    vec3 position;
-    
-    float constant;
-    float linear;
-    float quadratic;
-    
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
 };
 
+// Point and spot lights come from LightClusters; a point light is a spot light whose cone
+// covers the whole sphere
 struct SpotLight {
     vec3 position;
     vec3 direction;
     float cutOff;
     float outerCutOff;
+    float range;        // Contribution fades to zero here
   
-    float constant;
-    float linear;
+    float linear;       // The constant term is folded into the colours
     float quadratic;
   
     vec3 ambient;
@@ -58,55 +53,114 @@ struct SpotLight {
     vec3 specular;       
 };
 
-#define NR_POINT_LIGHTS 4
-#define NR_SPOT_LIGHTS 4
-
 // Advanced shading parameters
 uniform float time;
-uniform bool enableAdvancedShading;
 uniform float ambientOcclusion;
 uniform float roughness;
 uniform float metallic;
 
-uniform vec3 viewPos;
 uniform Material material;
-uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
-uniform SpotLight spotLights[NR_SPOT_LIGHTS];
+
+// The fragment's material colours, fetched once and shared by all lights
+struct SurfaceColors {
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// Written once per frame by FrameUniforms
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
+
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    vec4 clusterScale;    // Tiles per pixel (x, y), depth slice scale and bias (z, w)
+    ivec4 clusterCount;   // Tiles in x and y, depth slices
+};
+
+// Light clusters (LightClusters): packed lights, (first index, count) per cluster, and the
+// light indices of every cluster
+uniform samplerBuffer clusterLights;
+uniform usamplerBuffer clusterRanges;
+uniform usamplerBuffer clusterLightIndices;
 
 // Function prototypes
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+SurfaceColors FetchSurfaceColors();
+vec3 FetchNormal();
+vec3 CalcDirLight(DirLight light, SurfaceColors surface, vec3 normal, vec3 viewDir);
+SpotLight FetchLight(int index);
+vec3 CalcSpotLight(SpotLight light, SurfaceColors surface, vec3 normal, vec3 fragPos, vec3 viewDir);
 vec3 CalcAdvancedShading(vec3 baseColor, vec3 normal, vec3 viewDir, vec3 fragPos);
 float CalcShadowFactor(vec3 fragPos, vec3 lightPos);
 
 void main()
 {    
     // Properties
+#ifdef HAS_NORMAL_MAP
+    vec3 norm = FetchNormal();
+#else
     vec3 norm = normalize(Normal);
+#endif
     vec3 viewDir = normalize(viewPos - FragPos);
+    SurfaceColors surface = FetchSurfaceColors();
     
     // Phase 1: directional lighting
-    vec3 result = CalcDirLight(dirLight, norm, viewDir);
-      // Phase 2: point lights
-    for(int i = 0; i < NR_POINT_LIGHTS; i++)
-        result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);    
-    
-    // Phase 3: spot lights (now supports 4 spotlights)
-    for(int i = 0; i < NR_SPOT_LIGHTS; i++)
-        result += CalcSpotLight(spotLights[i], norm, FragPos, viewDir);    
+    vec3 result = CalcDirLight(dirLight, surface, norm, viewDir);
     
-    // Phase 4: Advanced shading effects
-    if (enableAdvancedShading) {
-        result = CalcAdvancedShading(result, norm, viewDir, FragPos);
+    // Phase 2: point and spot lights, only those binned into this fragment's cluster
+    float viewDepth = -(view * vec4(FragPos, 1.0)).z;
+    ivec2 tile = min(ivec2(gl_FragCoord.xy * clusterScale.xy), clusterCount.xy - 1);
+    int slice = clamp(int(log(max(viewDepth, 1e-4)) * clusterScale.z + clusterScale.w), 0, clusterCount.z - 1);
+    int cluster = (slice * clusterCount.y + tile.y) * clusterCount.x + tile.x;
+    uvec2 lightRange = texelFetch(clusterRanges, cluster).xy;
+    for (uint i = 0u; i < lightRange.y; i++) {
+        int light = int(texelFetch(clusterLightIndices, int(lightRange.x + i)).r);
+        result += CalcSpotLight(FetchLight(light), surface, norm, FragPos, viewDir);
     }
     
+    // Phase 3: Advanced shading effects
+#ifdef ADVANCED_SHADING
+    result = CalcAdvancedShading(result, norm, viewDir, FragPos);
+#endif
+    
     FragColor = vec4(result, 1.0);
 }
 
+// Material colours, from the textures the variant samples or the material properties
+SurfaceColors FetchSurfaceColors()
+{
+    SurfaceColors surface;
+    surface.ambient = instanced ? InstanceAmbient : material.ambient;
+    surface.diffuse = instanced ? InstanceDiffuse : material.diffuse;
+    surface.specular = instanced ? InstanceSpecular : material.specular;
+#ifdef HAS_TEXTURE
+    surface.diffuse = texture(texture_diffuse1, TexCoord).rgb;
+    surface.ambient = surface.diffuse;
+#endif
+#ifdef HAS_SPECULAR_MAP
+    surface.specular = texture(texture_specular1, TexCoord).rgb;
+#endif
+    return surface;
+}
+
+#ifdef HAS_NORMAL_MAP
+// Tangent-space normal from texture_normal1, which keeps only X and Y (BC5); Z is rebuilt from
+// the unit length. Vertices without a tangent frame keep the interpolated normal.
+vec3 FetchNormal()
+{
+    vec3 normal = normalize(Normal);
+    if (dot(Tangent, Tangent) < 1e-8 || dot(Bitangent, Bitangent) < 1e-8) return normal;
+    vec2 xy = texture(texture_normal1, TexCoord).rg * 2.0 - 1.0;
+    vec3 tangentNormal = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+    return normalize(mat3(normalize(Tangent), normalize(Bitangent), normal) * tangentNormal);
+}
+#endif
+
 // Calculates the color when using a directional light.
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
+vec3 CalcDirLight(DirLight light, SurfaceColors surface, vec3 normal, vec3 viewDir)
 {
     vec3 lightDir = normalize(-light.direction);
     // Diffuse shading
@@ -115,68 +169,38 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     
-    // Get material colors (either from texture or material properties)
-    vec3 ambient_color = material.ambient;
-    vec3 diffuse_color = material.diffuse;
-    vec3 specular_color = material.specular;
-    
-    if (hasTexture) {
-        vec3 textureColor = texture(texture_diffuse1, TexCoord).rgb;
-        ambient_color = textureColor;
-        diffuse_color = textureColor;
-        // Use texture for specular if available, otherwise use material
-        if (textureSize(texture_specular1, 0).x > 1) {
-            specular_color = texture(texture_specular1, TexCoord).rgb;
-        }
-    }
-    
     // Combine results
-    vec3 ambient = light.ambient * ambient_color;
-    vec3 diffuse = light.diffuse * diff * diffuse_color;
-    vec3 specular = light.specular * spec * specular_color;
+    vec3 ambient = light.ambient * surface.ambient;
+    vec3 diffuse = light.diffuse * diff * surface.diffuse;
+    vec3 specular = light.specular * spec * surface.specular;
     return (ambient + diffuse + specular);
 }
 
-// Calculates the color when using a point light.
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+// Unpacks a light from the five texels LightClusters::update writes
+SpotLight FetchLight(int index)
 {
-    vec3 lightDir = normalize(light.position - fragPos);
-    // Diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // Specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    // Attenuation
-    float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
-    
-    // Get material colors (either from texture or material properties)
-    vec3 ambient_color = material.ambient;
-    vec3 diffuse_color = material.diffuse;
-    vec3 specular_color = material.specular;
-    
-    if (hasTexture) {
-        vec3 textureColor = texture(texture_diffuse1, TexCoord).rgb;
-        ambient_color = textureColor;
-        diffuse_color = textureColor;
-        // Use texture for specular if available, otherwise use material
-        if (textureSize(texture_specular1, 0).x > 1) {
-            specular_color = texture(texture_specular1, TexCoord).rgb;
-        }
-    }
-    
-    // Combine results
-    vec3 ambient = light.ambient * ambient_color;
-    vec3 diffuse = light.diffuse * diff * diffuse_color;
-    vec3 specular = light.specular * spec * specular_color;
-    ambient *= attenuation;
-    diffuse *= attenuation;
-    specular *= attenuation;
-    return (ambient + diffuse + specular);
+    vec4 t0 = texelFetch(clusterLights, index * 5);
+    vec4 t1 = texelFetch(clusterLights, index * 5 + 1);
+    vec4 t2 = texelFetch(clusterLights, index * 5 + 2);
+    vec4 t3 = texelFetch(clusterLights, index * 5 + 3);
+    vec4 t4 = texelFetch(clusterLights, index * 5 + 4);
+
+    SpotLight light;
+    light.position = t0.xyz;
+    light.range = t0.w;
+    light.direction = t1.xyz;
+    light.cutOff = t1.w;
+    light.ambient = t2.rgb;
+    light.outerCutOff = t2.w;
+    light.diffuse = t3.rgb;
+    light.linear = t3.w;
+    light.specular = t4.rgb;
+    light.quadratic = t4.w;
+    return light;
 }
 
 // Calculates the color when using a spot light.
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 CalcSpotLight(SpotLight light, SurfaceColors surface, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
     vec3 lightDir = normalize(light.position - fragPos);
     // Diffuse shading
@@ -186,31 +210,19 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     // Attenuation
     float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
+    float attenuation = 1.0 / (1.0 + light.linear * distance + light.quadratic * (distance * distance));    
+    // Fade out at the range the light was binned with, so cluster edges never show
+    float window = clamp(1.0 - pow(distance / light.range, 4.0), 0.0, 1.0);
+    attenuation *= window * window;
     // Spotlight intensity
     float theta = dot(lightDir, normalize(-light.direction)); 
     float epsilon = light.cutOff - light.outerCutOff;
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
     
-    // Get material colors (either from texture or material properties)
-    vec3 ambient_color = material.ambient;
-    vec3 diffuse_color = material.diffuse;
-    vec3 specular_color = material.specular;
-    
-    if (hasTexture) {
-        vec3 textureColor = texture(texture_diffuse1, TexCoord).rgb;
-        ambient_color = textureColor;
-        diffuse_color = textureColor;
-        // Use texture for specular if available, otherwise use material
-        if (textureSize(texture_specular1, 0).x > 1) {
-            specular_color = texture(texture_specular1, TexCoord).rgb;
-        }
-    }
-    
     // Combine results
-    vec3 ambient = light.ambient * ambient_color;
-    vec3 diffuse = light.diffuse * diff * diffuse_color;
-    vec3 specular = light.specular * spec * specular_color;
+    vec3 ambient = light.ambient * surface.ambient;
+    vec3 diffuse = light.diffuse * diff * surface.diffuse;
+    vec3 specular = light.specular * spec * surface.specular;
     ambient *= attenuation * intensity;
     diffuse *= attenuation * intensity;
     specular *= attenuation * intensity;
@@ -1,26 +1,90 @@
 #version 330 core
+// Exhibit meshes use the packed layout from Mesh::setupMesh (PackedVertex); the room and robot
+// supply plain floats in locations 0-2. Instanced draws (Model::DrawInstanced) read their transform
+// and material from instanceData.
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
-layout (location = 3) in vec3 aTangent;
-layout (location = 4) in vec3 aBitangent;
+layout (location = 3) in vec4 aTangentFrame;
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoord;
 out vec3 Tangent;
 out vec3 Bitangent;
+flat out vec3 InstanceAmbient;
+flat out vec3 InstanceDiffuse;
+flat out vec3 InstanceSpecular;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat3 normalMatrix;   // Inverse transpose of model (Mesh::setTransform)
+
+// Written once per frame by FrameUniforms
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
+
+uniform bool instanced;
+uniform samplerBuffer instanceData;   // ModelInstance, eight texels each
+uniform int instanceBase;             // Instance of the draw's gl_InstanceID 0
+
+uniform bool packedVertex;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    Tangent = mat3(transpose(inverse(model))) * aTangent;
-    Bitangent = mat3(transpose(inverse(model))) * aBitangent;
+    vec3 position = aPos;
+    vec3 normal = aNormal;
+    vec3 tangent = vec3(0.0);
+    vec3 bitangent = vec3(0.0);
+    if (packedVertex) {
+        position = positionOffset + aPos * positionScale;
+        normal = decodeOctahedral(aNormal.xy);
+        vec4 frame = normalize(aTangentFrame);
+        tangent = rotate(frame, vec3(1.0, 0.0, 0.0));
+        bitangent = rotate(frame, vec3(0.0, 1.0, 0.0)) * (frame.w < 0.0 ? -1.0 : 1.0);
+    }
+
+    mat3 normalTransform = normalMatrix;
+    if (instanced) {
+        int texel = (instanceBase + gl_InstanceID) * 8;
+        vec4 worldPosition = vec4(position, 1.0);
+        FragPos = vec3(dot(texelFetch(instanceData, texel), worldPosition),
+                       dot(texelFetch(instanceData, texel + 1), worldPosition),
+                       dot(texelFetch(instanceData, texel + 2), worldPosition));
+        vec4 n0 = texelFetch(instanceData, texel + 3);
+        vec4 n1 = texelFetch(instanceData, texel + 4);
+        vec4 n2 = texelFetch(instanceData, texel + 5);
+        normalTransform = mat3(n0.xyz, n1.xyz, n2.xyz);
+        InstanceAmbient = vec3(n0.w, n1.w, n2.w);
+        InstanceDiffuse = texelFetch(instanceData, texel + 6).rgb;
+        InstanceSpecular = texelFetch(instanceData, texel + 7).rgb;
+    } else {
+        FragPos = vec3(model * vec4(position, 1.0));
+        InstanceAmbient = vec3(0.0);
+        InstanceDiffuse = vec3(0.0);
+        InstanceSpecular = vec3(0.0);
+    }
+    Normal = normalTransform * normal;
+    Tangent = normalTransform * tangent;
+    Bitangent = normalTransform * bitangent;
     TexCoord = aTexCoord;
     
     gl_Position = projection * view * vec4(FragPos, 1.0);